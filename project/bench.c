@@ -0,0 +1,608 @@
+/**
+ * @file bench.c
+ * @brief Microbenchmarks of the kernels of the program
+ *
+ * Every benchmark is run once to warm up and then repeats times; the time
+ * per operation of every repeat is collected and summarized as min, median,
+ * mean and standard deviation in ns/op. The results are written as JSON on
+ * stdout, or in the file given with --out.
+ *
+ * Usage: bench.out [--repeats N] [--scale S] [--filter NAME] [--out FILE]
+ */
+#include <getopt.h>
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/io.h"
+#include "src/itemset_map.h"
+#include "src/sort.h"
+#include "src/trace.h"
+#include "src/tree.h"
+
+#define BENCH_MAX_REPEATS 100
+/**
+ * @brief Number of slots of the maps of the hashmap benchmarks
+ */
+#define BENCH_MAP_TABLE_SIZE 65536
+
+/**
+ * @brief Settings of a run of the benchmarks
+ */
+typedef struct BenchSettings {
+    int repeats;
+    double scale;
+    char *filter;
+    FILE *out;
+    bool first;
+} BenchSettings;
+
+/**
+ * @brief A benchmark: setup and teardown are not timed, run performs the
+ * operations and returns their number
+ */
+typedef struct Benchmark {
+    void (*setup)(void *state);
+    long (*run)(void *state);
+    void (*teardown)(void *state);
+    void *state;
+} Benchmark;
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+/**
+ * @brief Deterministic pseudo-random generator (xorshift64)
+ *
+ * @return A pseudo-random number
+ */
+static uint64_t rng_next() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/**
+ * @brief Current time from a monotonic clock
+ *
+ * @return The time in nanoseconds
+ */
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int double_compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Run a benchmark and print its statistics as a JSON object
+ *
+ * @param settings Settings of the run
+ * @param name Name of the benchmark
+ * @param params JSON object with the parameters of the benchmark
+ * @param bytes_per_op Bytes processed by an operation, to report the
+ * throughput, 0 if not meaningful
+ * @param bench The benchmark
+ */
+static void bench_run(BenchSettings *settings, const char *name,
+                      const char *params, double bytes_per_op,
+                      Benchmark bench) {
+    if (settings->filter != NULL && strstr(name, settings->filter) == NULL) {
+        return;
+    }
+    double samples[BENCH_MAX_REPEATS];
+    long ops = 0;
+    int r;
+    for (r = -1; r < settings->repeats; r++) {
+        bench.setup(bench.state);
+        double start = now_ns();
+        ops = bench.run(bench.state);
+        double elapsed = now_ns() - start;
+        bench.teardown(bench.state);
+        // the first run is a warm-up
+        if (r >= 0) {
+            samples[r] = elapsed / (ops > 0 ? ops : 1);
+        }
+    }
+
+    int n = settings->repeats;
+    double mean = 0, var = 0;
+    for (r = 0; r < n; r++) {
+        mean += samples[r];
+    }
+    mean /= n;
+    for (r = 0; r < n; r++) {
+        var += (samples[r] - mean) * (samples[r] - mean);
+    }
+    double stddev = n > 1 ? sqrt(var / (n - 1)) : 0;
+    qsort(samples, n, sizeof(double), double_compare);
+    double median = n % 2 ? samples[n / 2]
+                          : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+    fprintf(settings->out,
+            "%s    {\"name\": \"%s\", \"params\": %s, \"ops\": %ld, "
+            "\"repeats\": %d, \"ns_per_op\": {\"min\": %.3f, \"median\": "
+            "%.3f, \"mean\": %.3f, \"stddev\": %.3f}",
+            settings->first ? "" : ",\n", name, params, ops, n, samples[0],
+            median, mean, stddev);
+    if (bytes_per_op > 0) {
+        fprintf(settings->out, ", \"mb_per_s\": %.3f",
+                bytes_per_op * 1e3 / median);
+    }
+    fprintf(settings->out, "}");
+    fflush(settings->out);
+    settings->first = false;
+}
+
+static void noop(void *state) {}
+
+/*--- HASHMAP ---*/
+
+typedef struct HashmapState {
+    map_t map;
+    int key_length;
+    int num_keys;
+    uint8_t *keys;
+    bool prefill;
+} HashmapState;
+
+/**
+ * @brief Generate num_keys distinct keys of the given length
+ *
+ * @param state The state of the benchmark
+ */
+static void hashmap_keys_init(HashmapState *state) {
+    state->keys = (uint8_t *)malloc(state->num_keys * state->key_length);
+    int i, j;
+    for (i = 0; i < state->num_keys; i++) {
+        // the first bytes encode i in base 26, the others are random
+        int x = i;
+        for (j = 0; j < state->key_length; j++) {
+            if (j < 4) {
+                state->keys[i * state->key_length + j] = 'a' + x % 26;
+                x /= 26;
+            } else {
+                state->keys[i * state->key_length + j] = 'a' + rng_next() % 26;
+            }
+        }
+    }
+}
+
+static void hashmap_setup(void *data) {
+    HashmapState *state = (HashmapState *)data;
+    state->map = hashmap_new();
+    if (state->prefill) {
+        int i;
+        for (i = 0; i < state->num_keys; i++) {
+            hashmap_put(state->map, state->keys + i * state->key_length,
+                        state->key_length, i);
+        }
+    }
+}
+
+static void hashmap_teardown(void *data) {
+    hashmap_free(((HashmapState *)data)->map);
+}
+
+static long hashmap_put_run(void *data) {
+    HashmapState *state = (HashmapState *)data;
+    int i;
+    for (i = 0; i < state->num_keys; i++) {
+        hashmap_put(state->map, state->keys + i * state->key_length,
+                    state->key_length, i);
+    }
+    return state->num_keys;
+}
+
+static long hashmap_get_run(void *data) {
+    HashmapState *state = (HashmapState *)data;
+    int i, value;
+    long found = 0;
+    for (i = 0; i < state->num_keys; i++) {
+        found += hashmap_get(state->map, state->keys + i * state->key_length,
+                             state->key_length, &value) == MAP_OK;
+    }
+    assert(found == state->num_keys);
+    return state->num_keys;
+}
+
+static long hashmap_increment_run(void *data) {
+    HashmapState *state = (HashmapState *)data;
+    int i;
+    for (i = 0; i < state->num_keys; i++) {
+        hashmap_increment(state->map, state->keys + i * state->key_length,
+                          state->key_length, 1);
+    }
+    return state->num_keys;
+}
+
+static void bench_hashmap(BenchSettings *settings) {
+    int key_lengths[] = {4, 8, 15};
+    // the map doubles when half full, so the load factor is in [0.25, 0.5)
+    double load_factors[] = {0.26, 0.49};
+    int k, l;
+    for (k = 0; k < 3; k++) {
+        for (l = 0; l < 2; l++) {
+            HashmapState state;
+            state.key_length = key_lengths[k];
+            state.num_keys = load_factors[l] * BENCH_MAP_TABLE_SIZE;
+            hashmap_keys_init(&state);
+            char params[128];
+            snprintf(params, sizeof(params),
+                     "{\"key_length\": %d, \"load_factor\": %.2f}",
+                     key_lengths[k], load_factors[l]);
+
+            state.prefill = false;
+            bench_run(settings, "hashmap_put", params, 0,
+                      (Benchmark){hashmap_setup, hashmap_put_run,
+                                  hashmap_teardown, &state});
+            state.prefill = true;
+            bench_run(settings, "hashmap_get", params, 0,
+                      (Benchmark){hashmap_setup, hashmap_get_run,
+                                  hashmap_teardown, &state});
+            bench_run(settings, "hashmap_increment", params, 0,
+                      (Benchmark){hashmap_setup, hashmap_increment_run,
+                                  hashmap_teardown, &state});
+            free(state.keys);
+        }
+    }
+}
+
+/*--- PARSER ---*/
+
+typedef struct ParseState {
+    char *chunk;
+    size_t size;
+    TransactionsList transactions;
+    SupportMap support_map;
+} ParseState;
+
+static void parse_setup(void *data) {
+    ParseState *state = (ParseState *)data;
+    state->transactions = NULL;
+    state->support_map = hashmap_new();
+}
+
+static long parse_run(void *data) {
+    ParseState *state = (ParseState *)data;
+    size_t i = 0;
+    while (i < state->size) {
+        i = transaction_parse(0, i, state->chunk, state->size,
+                              &(state->transactions), &(state->support_map));
+    }
+    // an operation is a byte of the chunk
+    return state->size;
+}
+
+static void parse_teardown(void *data) {
+    ParseState *state = (ParseState *)data;
+    transactions_free(&(state->transactions));
+    hashmap_free(state->support_map);
+}
+
+static void bench_parse(BenchSettings *settings) {
+    ParseState state;
+    size_t target = 8e6 * settings->scale;
+    cvector_vector_type(char) chunk = NULL;
+    cvector_grow(chunk, target + 64);
+    char item[16];
+    // transactions of 1-20 items out of 1000, skewed towards small ids
+    while (cvector_size(chunk) < target) {
+        int n_items = 1 + rng_next() % 20, j;
+        for (j = 0; j < n_items; j++) {
+            int id = (rng_next() % 1000) * (rng_next() % 1000) / 1000;
+            int length = snprintf(item, sizeof(item), j ? " i%d" : "i%d", id);
+            int c;
+            for (c = 0; c < length; c++) {
+                cvector_push_back(chunk, item[c]);
+            }
+        }
+        cvector_push_back(chunk, '\n');
+    }
+    cvector_push_back(chunk, '\0');
+    state.chunk = chunk;
+    state.size = cvector_size(chunk) - 1;
+
+    char params[64];
+    snprintf(params, sizeof(params), "{\"bytes\": %zu}", state.size);
+    bench_run(settings, "item_parse", params, 1,
+              (Benchmark){parse_setup, parse_run, parse_teardown, &state});
+    cvector_free(chunk);
+}
+
+/*--- SORT ---*/
+
+typedef struct SortState {
+    hashmap_element *items_count;
+    int *sorted_indices;
+    int num_items;
+    int num_threads;
+} SortState;
+
+static long sort_run(void *data) {
+    SortState *state = (SortState *)data;
+    sort(state->items_count, state->num_items, state->sorted_indices, 0,
+         state->num_items - 1, state->num_threads);
+    return state->num_items;
+}
+
+static void bench_sort(BenchSettings *settings, int *thread_counts,
+                       int n_thread_counts) {
+    SortState state;
+    state.num_items = 1e6 * settings->scale;
+    state.items_count = (hashmap_element *)calloc(state.num_items,
+                                                  sizeof(hashmap_element));
+    state.sorted_indices = (int *)malloc(state.num_items * sizeof(int));
+    int i;
+    for (i = 0; i < state.num_items; i++) {
+        state.items_count[i].value = rng_next() % 100000;
+    }
+    for (i = 0; i < n_thread_counts; i++) {
+        state.num_threads = thread_counts[i];
+        char params[64];
+        snprintf(params, sizeof(params),
+                 "{\"num_items\": %d, \"num_threads\": %d}", state.num_items,
+                 state.num_threads);
+        bench_run(settings, "sort", params, 0,
+                  (Benchmark){noop, sort_run, noop, &state});
+    }
+    free(state.items_count);
+    free(state.sorted_indices);
+}
+
+/*--- TREE ---*/
+
+static int int_compare(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+/**
+ * @brief Generate synthetic transactions as sorted arrays of distinct item
+ * ids, skewed towards small ids like the ids assigned by decreasing support
+ *
+ * @param n Number of transactions
+ * @param num_items Number of distinct items
+ * @return The transactions
+ */
+static WeightedItemsetList synthetic_transactions(int n, int num_items) {
+    WeightedItemsetList list = NULL;
+    int i, j;
+    for (i = 0; i < n; i++) {
+        WeightedItemset transaction;
+        transaction.items = NULL;
+        transaction.weight = 1;
+        int n_items = 1 + rng_next() % 15;
+        for (j = 0; j < n_items; j++) {
+            int id = (rng_next() % num_items) * (rng_next() % num_items) /
+                     num_items;
+            cvector_push_back(transaction.items, id);
+        }
+        qsort(transaction.items, n_items, sizeof(int), int_compare);
+        int size = 1;
+        for (j = 1; j < n_items; j++) {
+            if (transaction.items[j] != transaction.items[size - 1]) {
+                transaction.items[size++] = transaction.items[j];
+            }
+        }
+        cvector_set_size(transaction.items, size);
+        cvector_push_back(list, transaction);
+    }
+    return list;
+}
+
+typedef struct TreeState {
+    WeightedItemsetList keys;
+    TransactionsList transactions;
+    IndexMap index_map;
+    Tree tree;
+    Tree source;
+    int num_threads;
+} TreeState;
+
+/**
+ * @brief Convert the synthetic transactions to transactions of items
+ * named i<id>, as read from a file
+ *
+ * @param data The state of the benchmark
+ */
+static void tree_transactions_setup(void *data) {
+    TreeState *state = (TreeState *)data;
+    state->transactions = NULL;
+    size_t i, j;
+    char name[16];
+    for (i = 0; i < cvector_size(state->keys); i++) {
+        Transaction transaction = NULL;
+        for (j = 0; j < cvector_size(state->keys[i].items); j++) {
+            int length =
+                snprintf(name, sizeof(name), "i%d", state->keys[i].items[j]);
+            Item item = NULL;
+            cvector_grow(item, length + 1);
+            memcpy(item, name, length + 1);
+            cvector_set_size(item, length + 1);
+            cvector_push_back(transaction, item);
+        }
+        cvector_push_back(state->transactions, transaction);
+    }
+}
+
+static long tree_build_from_transaction_run(void *data) {
+    TreeState *state = (TreeState *)data;
+    size_t i, n = cvector_size(state->transactions);
+    for (i = 0; i < n; i++) {
+        Tree tree = tree_build_from_transaction(
+            0, 1, &(state->transactions[i]), state->index_map, NULL, 0, NULL);
+        state->transactions[i] = NULL;
+        tree_free(&tree);
+    }
+    return n;
+}
+
+static void tree_transactions_teardown(void *data) {
+    transactions_free(&(((TreeState *)data)->transactions));
+}
+
+static void tree_setup(void *data) { ((TreeState *)data)->tree = tree_new(); }
+
+static long tree_add_transaction_run(void *data) {
+    TreeState *state = (TreeState *)data;
+    size_t i, n = cvector_size(state->keys);
+    for (i = 0; i < n; i++) {
+        tree_add_transaction(&(state->tree), state->keys[i].items,
+                             cvector_size(state->keys[i].items), 1, false);
+    }
+    return n;
+}
+
+static void tree_teardown(void *data) {
+    TreeState *state = (TreeState *)data;
+    tree_free(&(state->tree));
+    if (state->source != NULL) {
+        tree_free(&(state->source));
+    }
+}
+
+/**
+ * @brief Build the two trees to merge from the two halves of the
+ * transactions
+ *
+ * @param data The state of the benchmark
+ */
+static void tree_merge_setup(void *data) {
+    TreeState *state = (TreeState *)data;
+    size_t i, n = cvector_size(state->keys);
+    state->tree = tree_new();
+    state->source = tree_new();
+    for (i = 0; i < n; i++) {
+        tree_add_transaction(i < n / 2 ? &(state->tree) : &(state->source),
+                             state->keys[i].items,
+                             cvector_size(state->keys[i].items), 1, false);
+    }
+}
+
+static long tree_merge_run(void *data) {
+    TreeState *state = (TreeState *)data;
+    long n = cvector_size(state->source);
+    if (state->num_threads > 0) {
+        tree_merge_parallel(&(state->tree), state->source, state->num_threads);
+    } else {
+        tree_merge(&(state->tree), state->source);
+    }
+    return n;
+}
+
+static void bench_tree(BenchSettings *settings, int *thread_counts,
+                       int n_thread_counts) {
+    TreeState state;
+    int num_transactions = 200000 * settings->scale;
+    int num_items = 1000;
+    state.keys = synthetic_transactions(num_transactions, num_items);
+    state.source = NULL;
+    state.index_map = hashmap_new();
+    char name[16], params[96];
+    int i;
+    for (i = 0; i < num_items; i++) {
+        int length = snprintf(name, sizeof(name), "i%d", i);
+        hashmap_put(state.index_map, name, length + 1, i);
+    }
+    snprintf(params, sizeof(params),
+             "{\"num_transactions\": %d, \"num_items\": %d}",
+             num_transactions, num_items);
+
+    bench_run(settings, "tree_build_from_transaction", params, 0,
+              (Benchmark){tree_transactions_setup,
+                          tree_build_from_transaction_run,
+                          tree_transactions_teardown, &state});
+    bench_run(settings, "tree_add_transaction", params, 0,
+              (Benchmark){tree_setup, tree_add_transaction_run, tree_teardown,
+                          &state});
+    state.num_threads = 0;
+    bench_run(settings, "tree_merge", params, 0,
+              (Benchmark){tree_merge_setup, tree_merge_run, tree_teardown,
+                          &state});
+    for (i = 0; i < n_thread_counts; i++) {
+        state.num_threads = thread_counts[i];
+        snprintf(params, sizeof(params),
+                 "{\"num_transactions\": %d, \"num_items\": %d, "
+                 "\"num_threads\": %d}",
+                 num_transactions, num_items, state.num_threads);
+        bench_run(settings, "tree_merge_parallel", params, 0,
+                  (Benchmark){tree_merge_setup, tree_merge_run, tree_teardown,
+                              &state});
+    }
+    hashmap_free(state.index_map);
+    weighted_itemsets_free(&(state.keys));
+}
+
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+
+    static struct option long_options[] = {
+        {"repeats", required_argument, NULL, 'r'},
+        {"scale", required_argument, NULL, 's'},
+        {"filter", required_argument, NULL, 'f'},
+        {"out", required_argument, NULL, 'o'},
+        {NULL, 0, NULL, 0}};
+    BenchSettings settings = {5, 1.0, NULL, stdout, true};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            settings.repeats = atoi(optarg);
+            break;
+        case 's':
+            settings.scale = atof(optarg);
+            break;
+        case 'f':
+            settings.filter = optarg;
+            break;
+        case 'o':
+            settings.out = fopen(optarg, "w");
+            assert(settings.out != NULL);
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [--repeats N] [--scale S] [--filter NAME] "
+                    "[--out FILE]\n",
+                    argv[0]);
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+    if (settings.repeats < 1 || settings.repeats > BENCH_MAX_REPEATS) {
+        fprintf(stderr, "repeats must be between 1 and %d\n",
+                BENCH_MAX_REPEATS);
+        MPI_Finalize();
+        exit(1);
+    }
+
+    // 1, 2, 4, ... up to the number of available threads
+    int thread_counts[16], n_thread_counts = 0, t;
+    for (t = 1; t <= omp_get_max_threads() && n_thread_counts < 16; t *= 2) {
+        thread_counts[n_thread_counts++] = t;
+    }
+    if (thread_counts[n_thread_counts - 1] == 1) {
+        thread_counts[n_thread_counts++] = 2;
+    }
+
+    fprintf(settings.out, "{\"benchmarks\": [\n");
+    bench_hashmap(&settings);
+    bench_parse(&settings);
+    bench_sort(&settings, thread_counts, n_thread_counts);
+    bench_tree(&settings, thread_counts, n_thread_counts);
+    fprintf(settings.out, "\n]}\n");
+    if (settings.out != stdout) {
+        fclose(settings.out);
+    }
+
+    trace_free();
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,523 @@
+/**
+ * @file generate.c
+ * @brief Synthetic transactions generator, modelled on the IBM Quest
+ * generator
+ *
+ * A set of potentially frequent patterns is generated first, with the same
+ * seed on every process: the items of every pattern are drawn from a Zipf
+ * distribution, and a fraction of them is shared with the previous pattern.
+ * Every pattern has an exponentially distributed weight and a corruption
+ * level. The length of every transaction is Poisson distributed; the
+ * transaction is filled with patterns chosen by weight, each losing its
+ * items with probability given by its corruption level, and with single
+ * items drawn from the Zipf distribution, so that on average a fraction
+ * density of the items comes from the patterns.
+ *
+ * The transactions are generated in blocks, each with a random generator
+ * seeded by the seed and the block number, so the output only depends on
+ * the parameters and not on the number of processes. At every round each
+ * process generates a block, and the blocks of the round are written in
+ * order with a collective write.
+ *
+ * The output is either text, a transaction per line with the items written
+ * as i<id> separated by spaces, or the binary format of io.h, which the
+ * program reads without parsing and splits among the processes by blocks.
+ */
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/io.h"
+
+/**
+ * @brief Parameters of the generator
+ */
+typedef struct GeneratorOptions {
+    char *filename;
+    uint64_t num_transactions;
+    double avg_length;
+    int num_items;
+    double skew;
+    int num_patterns;
+    double avg_pattern_length;
+    double density;
+    double correlation;
+    uint64_t seed;
+    bool binary;
+    int block;
+} GeneratorOptions;
+
+/**
+ * @brief Pattern embedded in the transactions
+ */
+typedef struct Pattern {
+    cvector_vector_type(uint32_t) items;
+    double corruption;
+} Pattern;
+
+/**
+ * @brief Distributions shared by all the blocks
+ */
+typedef struct Model {
+    /**
+     * @brief Cumulative Zipf distribution of the items
+     */
+    double *item_cdf;
+    int num_items;
+    /**
+     * @brief Cumulative distribution of the weights of the patterns
+     */
+    double *pattern_cdf;
+    Pattern *patterns;
+    int num_patterns;
+    /**
+     * @brief Probability of adding a pattern instead of a single item, so
+     * that a fraction density of the items comes from the patterns
+     */
+    double pattern_probability;
+} Model;
+
+/**
+ * @brief splitmix64, used to seed the generators
+ *
+ * @param x The state, advanced by the call
+ * @return A pseudo-random number
+ */
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Uniform number in [0, 1) from a xorshift64* generator
+ *
+ * @param state The state of the generator
+ * @return The number
+ */
+static double uniform(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return ((*state * 0x2545f4914f6cdd1dULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double exponential(uint64_t *state, double mean) {
+    return -mean * log(1 - uniform(state));
+}
+
+static double normal(uint64_t *state, double mean, double stddev) {
+    double u = 1 - uniform(state), v = uniform(state);
+    return mean + stddev * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/**
+ * @brief Poisson distributed number, approximated with a normal
+ * distribution for large means
+ *
+ * @param state The state of the generator
+ * @param mean The mean
+ * @return The number
+ */
+static int poisson(uint64_t *state, double mean) {
+    if (mean > 30) {
+        int x = (int)round(normal(state, mean, sqrt(mean)));
+        return x < 0 ? 0 : x;
+    }
+    double limit = exp(-mean), p = uniform(state);
+    int k = 0;
+    while (p > limit) {
+        p *= uniform(state);
+        k++;
+    }
+    return k;
+}
+
+/**
+ * @brief Index of the first element of a cumulative distribution greater
+ * than a uniform number
+ *
+ * @param cdf The cumulative distribution
+ * @param n Number of elements
+ * @param state The state of the generator
+ * @return The index drawn
+ */
+static int sample(double *cdf, int n, uint64_t *state) {
+    double u = uniform(state) * cdf[n - 1];
+    int low = 0, high = n - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (cdf[mid] > u) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+static bool contains(cvector_vector_type(uint32_t) items, uint32_t item) {
+    size_t i;
+    for (i = 0; i < cvector_size(items); i++) {
+        if (items[i] == item) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Build the item and pattern distributions
+ *
+ * @param options The parameters of the generator
+ * @param model Where to store the distributions
+ */
+static void model_init(GeneratorOptions *options, Model *model) {
+    int i;
+    model->num_items = options->num_items;
+    model->item_cdf = (double *)malloc(options->num_items * sizeof(double));
+    double total = 0;
+    for (i = 0; i < options->num_items; i++) {
+        total += pow(i + 1, -options->skew);
+        model->item_cdf[i] = total;
+    }
+
+    uint64_t seed = options->seed;
+    uint64_t state = splitmix64(&seed);
+    model->num_patterns = options->num_patterns;
+    model->patterns = (Pattern *)calloc(options->num_patterns, sizeof(Pattern));
+    model->pattern_cdf = (double *)malloc(options->num_patterns * sizeof(double));
+    total = 0;
+    for (i = 0; i < options->num_patterns; i++) {
+        Pattern *pattern = &(model->patterns[i]);
+        int length = poisson(&state, options->avg_pattern_length - 1) + 1;
+        if (length > options->num_items) {
+            length = options->num_items;
+        }
+        // part of the items come from the previous pattern
+        if (i > 0) {
+            Pattern *previous = &(model->patterns[i - 1]);
+            double fraction = exponential(&state, options->correlation);
+            int shared = (int)(fraction < 1 ? fraction * length : length);
+            size_t j;
+            for (j = 0; j < cvector_size(previous->items) && shared > 0;
+                 j++, shared--) {
+                cvector_push_back(pattern->items, previous->items[j]);
+            }
+        }
+        while (cvector_size(pattern->items) < (size_t)length) {
+            uint32_t item = sample(model->item_cdf, model->num_items, &state);
+            if (!contains(pattern->items, item)) {
+                cvector_push_back(pattern->items, item);
+            }
+        }
+        double corruption = normal(&state, 0.5, 0.1);
+        pattern->corruption =
+            corruption < 0 ? 0 : (corruption > 1 ? 1 : corruption);
+        total += exponential(&state, 1);
+        model->pattern_cdf[i] = total;
+    }
+    // on average a pattern adds half of its items
+    double pattern_items = options->avg_pattern_length * 0.5;
+    model->pattern_probability =
+        options->density /
+        (pattern_items * (1 - options->density) + options->density);
+}
+
+static void model_free(Model *model) {
+    int i;
+    for (i = 0; i < model->num_patterns; i++) {
+        cvector_free(model->patterns[i].items);
+    }
+    free(model->patterns);
+    free(model->pattern_cdf);
+    free(model->item_cdf);
+}
+
+/**
+ * @brief Append bytes to a buffer
+ *
+ * @param buffer The buffer
+ * @param data The bytes
+ * @param size Number of bytes
+ */
+static void buffer_append(cvector_vector_type(char) * buffer,
+                          const void *data, size_t size) {
+    size_t length = cvector_size((*buffer));
+    if (cvector_capacity((*buffer)) < length + size) {
+        cvector_grow((*buffer), 2 * (length + size));
+    }
+    memcpy((*buffer) + length, data, size);
+    cvector_set_size((*buffer), length + size);
+}
+
+/**
+ * @brief Generate a block of transactions
+ *
+ * @param options The parameters of the generator
+ * @param model The distributions
+ * @param block_id Number of the block
+ * @param n_transactions Number of transactions of the block
+ * @param buffer Where to write the block, in the output format
+ */
+static void generate_block(GeneratorOptions *options, Model *model,
+                           uint64_t block_id, uint64_t n_transactions,
+                           cvector_vector_type(char) * buffer) {
+    uint64_t seed = options->seed ^ (block_id * 0xd1b54a32d192ed03ULL);
+    uint64_t state = splitmix64(&seed);
+    state = state ? state : 1;
+    cvector_vector_type(uint32_t) items = NULL;
+    char text[16];
+    uint64_t t;
+    for (t = 0; t < n_transactions; t++) {
+        cvector_set_size(items, 0);
+        int length = poisson(&state, options->avg_length - 1) + 1;
+        if (length > model->num_items) {
+            length = model->num_items;
+        }
+        while (cvector_size(items) < (size_t)length) {
+            size_t n_before = cvector_size(items);
+            if (model->num_patterns > 0 &&
+                uniform(&state) < model->pattern_probability) {
+                Pattern *pattern = &(model->patterns[sample(
+                    model->pattern_cdf, model->num_patterns, &state)]);
+                size_t j;
+                for (j = 0; j < cvector_size(pattern->items) &&
+                            cvector_size(items) < (size_t)length;
+                     j++) {
+                    if (uniform(&state) >= pattern->corruption &&
+                        !contains(items, pattern->items[j])) {
+                        cvector_push_back(items, pattern->items[j]);
+                    }
+                }
+            }
+            // a pattern whose items are all corrupted or already taken
+            // adds a single item instead, so that the transaction fills up
+            if (cvector_size(items) == n_before) {
+                uint32_t item =
+                    sample(model->item_cdf, model->num_items, &state);
+                if (!contains(items, item)) {
+                    cvector_push_back(items, item);
+                }
+            }
+        }
+
+        uint32_t n_items = cvector_size(items), j;
+        if (options->binary) {
+            buffer_append(buffer, &n_items, sizeof(uint32_t));
+            buffer_append(buffer, items, n_items * sizeof(uint32_t));
+        } else {
+            for (j = 0; j < n_items; j++) {
+                int size = snprintf(text, sizeof(text), j ? " i%u" : "i%u",
+                                    items[j]);
+                buffer_append(buffer, text, size);
+            }
+            buffer_append(buffer, "\n", 1);
+        }
+    }
+    cvector_free(items);
+}
+
+/**
+ * @brief Generate all the blocks and write them to the output file
+ *
+ * @param options The parameters of the generator
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ */
+static void generate(GeneratorOptions *options, int rank, int world_size) {
+    Model model;
+    model_init(options, &model);
+
+    MPI_File out;
+    if (rank == 0) {
+        MPI_File_delete(options->filename, MPI_INFO_NULL);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (MPI_File_open(MPI_COMM_WORLD, options->filename,
+                      MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                      &out) != MPI_SUCCESS) {
+        if (rank == 0)
+            fprintf(stderr, "Couldn't open file %s\n", options->filename);
+        MPI_Finalize();
+        exit(2);
+    }
+
+    uint64_t num_blocks =
+        (options->num_transactions + options->block - 1) / options->block;
+    uint64_t base = options->binary ? sizeof(BinaryHeader) : 0;
+    BinaryBlock *index = NULL;
+    if (rank == 0) {
+        index = (BinaryBlock *)malloc((num_blocks + world_size) *
+                                      sizeof(BinaryBlock));
+    }
+    cvector_vector_type(char) buffer = NULL;
+    uint64_t round;
+    for (round = 0; round * world_size < num_blocks; round++) {
+        BinaryBlock block = {0, 0, 0};
+        uint64_t block_id = round * world_size + rank;
+        cvector_set_size(buffer, 0);
+        if (block_id < num_blocks) {
+            uint64_t first = block_id * options->block;
+            block.num_transactions =
+                first + options->block > options->num_transactions
+                    ? options->num_transactions - first
+                    : (uint64_t)options->block;
+            generate_block(options, &model, block_id, block.num_transactions,
+                           &buffer);
+        }
+        block.bytes = cvector_size(buffer);
+        assert(block.bytes <= INT32_MAX);
+
+        // the blocks of the round are written in order of block number
+        uint64_t offset = 0, round_bytes;
+        MPI_Exscan(&(block.bytes), &offset, 1, MPI_UINT64_T, MPI_SUM,
+                   MPI_COMM_WORLD);
+        if (rank == 0) {
+            offset = 0;
+        }
+        MPI_Allreduce(&(block.bytes), &round_bytes, 1, MPI_UINT64_T, MPI_SUM,
+                      MPI_COMM_WORLD);
+        block.offset = base + offset;
+        MPI_File_write_at_all(out, block.offset, buffer, block.bytes, MPI_BYTE,
+                              MPI_STATUS_IGNORE);
+        MPI_Gather(&block, sizeof(BinaryBlock), MPI_BYTE,
+                   rank == 0 ? index + round * world_size : NULL,
+                   sizeof(BinaryBlock), MPI_BYTE, 0, MPI_COMM_WORLD);
+        base += round_bytes;
+    }
+    cvector_free(buffer);
+
+    if (options->binary && rank == 0) {
+        MPI_File_write_at(out, base, index, num_blocks * sizeof(BinaryBlock),
+                          MPI_BYTE, MPI_STATUS_IGNORE);
+        BinaryHeader header;
+        memcpy(header.magic, BINARY_MAGIC, 4);
+        header.version = BINARY_VERSION;
+        header.num_transactions = options->num_transactions;
+        header.num_blocks = num_blocks;
+        header.index_offset = base;
+        MPI_File_write_at(out, 0, &header, sizeof(BinaryHeader), MPI_BYTE,
+                          MPI_STATUS_IGNORE);
+    }
+    if (rank == 0) {
+        fprintf(stderr, "Generated %" PRIu64 " transactions, %" PRIu64
+                        " bytes\n",
+                options->num_transactions,
+                base + (options->binary ? num_blocks * sizeof(BinaryBlock)
+                                        : 0));
+    }
+    free(index);
+    MPI_File_close(&out);
+    model_free(&model);
+}
+
+static void usage(int rank, char *program) {
+    if (rank == 0) {
+        fprintf(stderr,
+                "Usage: %s filename [options]\n"
+                "Options:\n"
+                "  --transactions N    number of transactions (100000)\n"
+                "  --avg-length T      average transaction length (10)\n"
+                "  --items N           number of distinct items (1000)\n"
+                "  --skew S            Zipf exponent of the items, 0 for "
+                "uniform (1)\n"
+                "  --patterns L        number of embedded patterns (1000)\n"
+                "  --pattern-length I  average pattern length (4)\n"
+                "  --density D         fraction of the items coming from the "
+                "patterns, in [0, 1)\n"
+                "                      (0.5)\n"
+                "  --correlation C     average fraction of a pattern shared "
+                "with the previous one (0.5)\n"
+                "  --seed N            seed of the random generators (1)\n"
+                "  --block N           transactions per block (100000)\n"
+                "  --binary            write the binary format instead of "
+                "text\n",
+                program);
+    }
+}
+
+int main(int argc, char **argv) {
+    int rank, world_size;
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    static struct option long_options[] = {
+        {"transactions", required_argument, NULL, 'n'},
+        {"avg-length", required_argument, NULL, 't'},
+        {"items", required_argument, NULL, 'i'},
+        {"skew", required_argument, NULL, 'z'},
+        {"patterns", required_argument, NULL, 'l'},
+        {"pattern-length", required_argument, NULL, 'p'},
+        {"density", required_argument, NULL, 'd'},
+        {"correlation", required_argument, NULL, 'c'},
+        {"seed", required_argument, NULL, 's'},
+        {"block", required_argument, NULL, 'k'},
+        {"binary", no_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0}};
+    GeneratorOptions options = {NULL, 100000, 10, 1000, 1, 1000,
+                                4,    0.5,    0.5, 1,   false, 100000};
+    opterr = rank == 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'n':
+            options.num_transactions = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            options.avg_length = atof(optarg);
+            break;
+        case 'i':
+            options.num_items = atoi(optarg);
+            break;
+        case 'z':
+            options.skew = atof(optarg);
+            break;
+        case 'l':
+            options.num_patterns = atoi(optarg);
+            break;
+        case 'p':
+            options.avg_pattern_length = atof(optarg);
+            break;
+        case 'd':
+            options.density = atof(optarg);
+            break;
+        case 'c':
+            options.correlation = atof(optarg);
+            break;
+        case 's':
+            options.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'k':
+            options.block = atoi(optarg);
+            break;
+        case 'b':
+            options.binary = true;
+            break;
+        default:
+            usage(rank, argv[0]);
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+    if (optind != argc - 1 || options.num_items < 1 || options.block < 1 ||
+        options.avg_length < 1 || options.avg_pattern_length < 1 ||
+        options.num_patterns < 0 || options.density < 0 ||
+        options.density >= 1) {
+        usage(rank, argv[0]);
+        MPI_Finalize();
+        exit(1);
+    }
+    options.filename = argv[optind];
+
+    generate(&options, rank, world_size);
+
+    MPI_Finalize();
+    return 0;
+}
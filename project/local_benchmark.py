@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""Scaling sweeps on a single machine.
+
+Runs bin/main.out with mpiexec for every combination of datasets, minimum
+supports, numbers of processes, numbers of threads and OpenMP schedules,
+repeating every configuration. The stdout and stderr of every run are saved
+as out_<timestamp>_<iter>_<support>_<procs>_<threads>_<dataset>_<schedule>
+and err_..., the same names produced by serial_benchmark.sh on the cluster,
+so the results directory can also be loaded by sub_results/analyze.py.
+
+At the end the time of every run is computed as analyze.py does (the sum of
+the phases of every rank, maximum over the ranks, with the time of
+'received global tree' set to 0 for the 1 process, 1 thread runs) and the mean time, speedup
+and efficiency with respect to the 1 process, 1 thread run of the same
+dataset, support and schedule are printed and written to scaling.csv, with
+the mean time of every phase in phases.csv. With --plot the speedup and
+efficiency are also plotted, if matplotlib is available.
+
+Example:
+    ./local_benchmark.py --datasets data/small_dataset.txt \\
+        --procs 1,2,4 --threads 1,2 --schedules static,dynamic \\
+        --supports 0.0001 --repeats 3 --plot
+"""
+import argparse
+import csv
+import datetime
+import os
+import subprocess
+import sys
+from collections import defaultdict
+
+BASEPATH = os.path.dirname(os.path.abspath(__file__))
+# phases printed by main.out in debug mode, in order
+PHASES = ['read transactions', 'received global map', 'sorted local items',
+          'received sorted global items', 'planned pipeline',
+          'deduplicated transactions',
+          'built local tree', 'received global tree', 'updated tree',
+          'broadcast global tree', 'built vertical database',
+          'mined frequent itemsets', 'wrote frequent itemsets',
+          'generated association rules']
+
+
+def parse_list(value, kind=str):
+    return [kind(x) for x in value.split(',') if x]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--datasets', type=parse_list, required=True,
+                        help='comma separated list of transaction files')
+    parser.add_argument('--procs', type=lambda v: parse_list(v, int),
+                        default=[1, 2, 4], help='numbers of MPI processes')
+    parser.add_argument('--threads', type=lambda v: parse_list(v, int),
+                        default=[1, 2], help='numbers of OpenMP threads')
+    parser.add_argument('--schedules', type=parse_list, default=['static'],
+                        help='OpenMP schedules (static, dynamic, guided)')
+    parser.add_argument('--chunk-size', type=int, default=1,
+                        help='chunk size of the OpenMP schedule')
+    parser.add_argument('--supports', type=parse_list, default=['0.0001'],
+                        help='minimum supports')
+    parser.add_argument('--repeats', type=int, default=3,
+                        help='repetitions of every configuration')
+    parser.add_argument('--out-dir', default=os.path.join(BASEPATH, 'sub_results', 'local'),
+                        help='directory of the results')
+    parser.add_argument('--bin', default=os.path.join(BASEPATH, 'bin', 'main.out'),
+                        help='executable to run')
+    parser.add_argument('--mpiexec', default='mpiexec --oversubscribe',
+                        help='mpiexec command and its options')
+    parser.add_argument('--extra', default='',
+                        help='extra options of main.out, e.g. --dedup')
+    parser.add_argument('--timeout', type=float, default=None,
+                        help='timeout of a run in seconds')
+    parser.add_argument('--analyze-only', action='store_true',
+                        help='only build the tables from the existing results')
+    parser.add_argument('--plot', action='store_true',
+                        help='plot speedup and efficiency')
+    return parser.parse_args()
+
+
+def run_name(timestamp, iteration, support, procs, threads, dataset, schedule):
+    # '_' separates the fields of the name
+    dataset = os.path.basename(dataset).replace('_', '-')
+    return f'{timestamp}_{iteration}_{support}_{procs}_{threads}_{dataset}_{schedule}'
+
+
+def run_all(args):
+    os.makedirs(args.out_dir, exist_ok=True)
+    configs = [(it, d, s, p, t, sc)
+               for it in range(1, args.repeats + 1)
+               for d in args.datasets
+               for s in args.supports
+               for p in args.procs
+               for t in args.threads
+               for sc in args.schedules]
+    for i, (it, dataset, support, procs, threads, schedule) in enumerate(configs):
+        timestamp = datetime.datetime.now().strftime('%Y-%m-%d-%H-%M-%S-%f')
+        name = run_name(timestamp, it, support, procs, threads, dataset, schedule)
+        env = dict(os.environ, OMP_SCHEDULE=f'{schedule},{args.chunk_size}')
+        command = args.mpiexec.split() + ['-n', str(procs), args.bin, dataset,
+                                          str(threads), support, '1'] + args.extra.split()
+        print(f'[{i + 1}/{len(configs)}] {name}', file=sys.stderr)
+        with open(os.path.join(args.out_dir, f'out_{name}'), 'w') as out, \
+                open(os.path.join(args.out_dir, f'err_{name}'), 'w') as err:
+            try:
+                result = subprocess.run(command, stdout=out, stderr=err, env=env,
+                                        timeout=args.timeout)
+                if result.returncode != 0:
+                    print(f'  failed with exit code {result.returncode}', file=sys.stderr)
+            except subprocess.TimeoutExpired:
+                print('  timed out', file=sys.stderr)
+
+
+def load_runs(out_dir):
+    """Return a list of runs, each with its configuration, the time of the run
+    and the time of every phase (maximum over the ranks)."""
+    runs = []
+    for file_name in sorted(os.listdir(out_dir)):
+        if not file_name.startswith('out_'):
+            continue
+        _, ts, it, support, procs, threads, dataset, schedule = file_name.split('_')
+        rank_total = defaultdict(float)
+        phase_max = defaultdict(float)
+        with open(os.path.join(out_dir, file_name)) as f:
+            for row in csv.DictReader(f, skipinitialspace=True):
+                try:
+                    rank, time, msg = int(row['rank']), float(row['time']), row['msg']
+                except (KeyError, TypeError, ValueError):
+                    continue
+                # as analyze.py, a single process with a single thread
+                # receives no tree, so the phase takes no time
+                if procs == '1' and threads == '1' and msg == 'received global tree':
+                    time = 0.0
+                rank_total[rank] += time
+                phase_max[msg] = max(phase_max[msg], time)
+        # same criterion as analyze.py for incomplete runs
+        if 'received global tree' not in phase_max:
+            print(f'Discarding {file_name}', file=sys.stderr)
+            continue
+        runs.append({
+            'config': (dataset, support, schedule, int(procs), int(threads)),
+            'time': max(rank_total.values()),
+            'phases': phase_max,
+        })
+    return runs
+
+
+def mean(values):
+    return sum(values) / len(values)
+
+
+def build_tables(runs, out_dir):
+    by_config = defaultdict(list)
+    for run in runs:
+        by_config[run['config']].append(run)
+
+    rows = []
+    for config in sorted(by_config):
+        dataset, support, schedule, procs, threads = config
+        times = [run['time'] for run in by_config[config]]
+        base = by_config.get((dataset, support, schedule, 1, 1))
+        t = mean(times)
+        speedup = mean([run['time'] for run in base]) / t if base else None
+        rows.append({
+            'dataset': dataset, 'support': support, 'schedule': schedule,
+            'processes': procs, 'threads': threads, 'cores': procs * threads,
+            'runs': len(times), 'time': t, 'min_time': min(times),
+            'speedup': speedup,
+            'efficiency': speedup / (procs * threads) if speedup else None,
+        })
+
+    fields = list(rows[0].keys()) if rows else []
+    with open(os.path.join(out_dir, 'scaling.csv'), 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=fields)
+        writer.writeheader()
+        writer.writerows(rows)
+
+    phases = [p for p in PHASES if any(p in run['phases'] for run in runs)]
+    with open(os.path.join(out_dir, 'phases.csv'), 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(['dataset', 'support', 'schedule', 'processes', 'threads'] + phases)
+        for config in sorted(by_config):
+            writer.writerow(list(config) + [
+                '%.6f' % mean([run['phases'].get(p, 0) for run in by_config[config]])
+                for p in phases])
+    return rows
+
+
+def print_table(rows):
+    header = f"{'dataset':>16} {'support':>8} {'schedule':>8} {'P':>3} {'T':>3} " \
+             f"{'runs':>4} {'time [s]':>10} {'speedup':>8} {'eff.':>6}"
+    print(header)
+    print('-' * len(header))
+    for r in rows:
+        speedup = f"{r['speedup']:8.2f}" if r['speedup'] else f"{'-':>8}"
+        efficiency = f"{r['efficiency']:6.2f}" if r['efficiency'] else f"{'-':>6}"
+        print(f"{r['dataset']:>16} {r['support']:>8} {r['schedule']:>8} "
+              f"{r['processes']:>3} {r['threads']:>3} {r['runs']:>4} "
+              f"{r['time']:10.4f} {speedup} {efficiency}")
+
+
+def plot(rows, out_dir):
+    try:
+        import matplotlib
+        matplotlib.use('Agg')
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print('matplotlib not available, skipping the plots', file=sys.stderr)
+        return
+    groups = defaultdict(list)
+    for r in rows:
+        if r['speedup']:
+            groups[(r['dataset'], r['support'], r['schedule'], r['threads'])].append(r)
+    for metric in ['speedup', 'efficiency']:
+        fig, ax = plt.subplots()
+        for (dataset, support, schedule, threads), group in sorted(groups.items()):
+            group.sort(key=lambda r: r['cores'])
+            ax.plot([r['cores'] for r in group], [r[metric] for r in group], marker='o',
+                    label=f'{dataset} s={support} {schedule} T={threads}')
+        if metric == 'speedup':
+            cores = sorted({r['cores'] for r in rows})
+            ax.plot(cores, cores, linestyle='--', color='gray', label='ideal')
+        ax.set_xlabel('cores (processes x threads)')
+        ax.set_ylabel(metric)
+        ax.legend(fontsize='small')
+        fig.tight_layout()
+        fig.savefig(os.path.join(out_dir, f'{metric}.pdf'))
+        plt.close(fig)
+
+
+def main():
+    args = parse_args()
+    if not args.analyze_only:
+        run_all(args)
+    rows = build_tables(load_runs(args.out_dir), args.out_dir)
+    print_table(rows)
+    if args.plot:
+        plot(rows, args.out_dir)
+
+
+if __name__ == '__main__':
+    main()
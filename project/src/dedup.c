@@ -0,0 +1,68 @@
+#include "dedup.h"
+#include "io.h"
+#include "tree.h"
+#include <omp.h>
+
+/**
+ * @brief Convert a list of transactions into a list of distinct weighted
+ * transactions.
+ *
+ * Every transaction is reduced to the sorted ids of its frequent items,
+ * then identical transactions are collapsed into a single one whose weight
+ * is the number of occurrences. Transactions without frequent items are
+ * dropped. The transactions are freed as they get converted.
+ *
+ * @param transactions Pointer to the list of transactions to convert
+ * @param index_map The map from item to the corresponding id
+ * @param weighted Pointer to the list where the weighted transactions are
+ * stored
+ * @param num_threads The number of threads used to compute the item ids
+ */
+void transactions_dedup(TransactionsList *transactions, IndexMap index_map,
+                        WeightedItemsetList *weighted, int num_threads) {
+    int n_transactions = cvector_size((*transactions));
+    cvector_vector_type(int) *keys = (cvector_vector_type(int) *)calloc(
+        n_transactions, sizeof(cvector_vector_type(int)));
+    assert(n_transactions == 0 || keys != NULL);
+    int i;
+
+#pragma omp parallel for default(none)                                         \
+    shared(n_transactions, keys, transactions, index_map)                      \
+        num_threads(num_threads) schedule(static)
+    for (i = 0; i < n_transactions; i++) {
+        transaction_get_keys((*transactions)[i], index_map, &(keys[i]));
+        transaction_free(&((*transactions)[i]));
+    }
+
+    ItemsetMap *map = itemset_map_new();
+    for (i = 0; i < n_transactions; i++) {
+        if (keys[i] != NULL) {
+            itemset_map_increment(map, keys[i], cvector_size(keys[i]), 1);
+            cvector_free(keys[i]);
+        }
+    }
+    free(keys);
+
+    *weighted = itemset_map_take_entries(map);
+    itemset_map_free(map);
+}
+
+/**
+ * @brief Collapse the identical itemsets of a list, summing their weights
+ *
+ * @param list Pointer to the list of weighted itemsets, replaced by the list
+ * of distinct itemsets
+ */
+void weighted_itemsets_dedup(WeightedItemsetList *list) {
+    ItemsetMap *map = itemset_map_new();
+    size_t n = cvector_size((*list));
+    size_t i;
+    for (i = 0; i < n; i++) {
+        itemset_map_increment(map, (*list)[i].items,
+                              cvector_size((*list)[i].items),
+                              (*list)[i].weight);
+    }
+    weighted_itemsets_free(list);
+    *list = itemset_map_take_entries(map);
+    itemset_map_free(map);
+}
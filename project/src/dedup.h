@@ -0,0 +1,38 @@
+/**
+ * @file dedup.h
+ * @brief Functions that collapse identical transactions into weighted ones
+ *
+ */
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "itemset_map.h"
+#include "types.h"
+
+/**
+ * @brief Convert a list of transactions into a list of distinct weighted
+ * transactions.
+ *
+ * Every transaction is reduced to the sorted ids of its frequent items,
+ * then identical transactions are collapsed into a single one whose weight
+ * is the number of occurrences. Transactions without frequent items are
+ * dropped. The transactions are freed as they get converted.
+ *
+ * @param transactions Pointer to the list of transactions to convert
+ * @param index_map The map from item to the corresponding id
+ * @param weighted Pointer to the list where the weighted transactions are
+ * stored
+ * @param num_threads The number of threads used to compute the item ids
+ */
+void transactions_dedup(TransactionsList *transactions, IndexMap index_map,
+                        WeightedItemsetList *weighted, int num_threads);
+
+/**
+ * @brief Collapse the identical itemsets of a list, summing their weights
+ *
+ * @param list Pointer to the list of weighted itemsets, replaced by the list
+ * of distinct itemsets
+ */
+void weighted_itemsets_dedup(WeightedItemsetList *list);
+
+#endif
@@ -0,0 +1,417 @@
+#include "eclat.h"
+#include "tree.h"
+#include <assert.h>
+#include <limits.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief An itemset of an equivalence class, i.e. the prefix of the class
+ * extended with an item
+ */
+typedef struct EclatMember {
+    /**
+     * @brief The item that extends the prefix
+     */
+    int key;
+    /**
+     * @brief Support count of the itemset
+     */
+    int support;
+    /**
+     * @brief The transactions of the itemset, NULL if the class uses diffsets
+     */
+    uint64_t *bits;
+    /**
+     * @brief Sorted ids of the transactions of the prefix without the
+     * itemset, if the class uses diffsets
+     */
+    cvector_vector_type(uint32_t) diff;
+} EclatMember;
+
+/**
+ * @brief Number of transactions in a bitset
+ */
+ECLAT_POPCOUNT_KERNEL
+static int bitset_count(const uint64_t *a, uint64_t num_words) {
+    int count = 0;
+    uint64_t w;
+    for (w = 0; w < num_words; w++) {
+        count += __builtin_popcountll(a[w]);
+    }
+    return count;
+}
+
+/**
+ * @brief Build the vertical database of the transactions of all the
+ * processes. Every process sets the bits of its transactions, then the
+ * bitsets are gathered on every process, those of a process after the ones
+ * of the processes with lower rank.
+ *
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param transactions The transactions of the current process
+ * @param index_map Map from the frequent items to their id
+ * @param num_items Number of frequent items
+ * @param db Where to store the database
+ */
+void vertical_database_build(int rank, int world_size,
+                             TransactionsList transactions,
+                             IndexMap index_map, int num_items,
+                             VerticalDatabase *db) {
+    size_t n_transactions = cvector_size(transactions), t;
+    uint64_t local_words = (n_transactions + 63) / 64;
+    // the bitsets of the current process, item by item
+    uint64_t *local =
+        (uint64_t *)calloc(num_items * local_words + 1, sizeof(uint64_t));
+    assert(local != NULL);
+    cvector_vector_type(int) keys = NULL;
+    for (t = 0; t < n_transactions; t++) {
+        cvector_set_size(keys, 0);
+        transaction_get_keys(transactions[t], index_map, &keys);
+        int n_keys = cvector_size(keys), j;
+        for (j = 0; j < n_keys; j++) {
+            local[keys[j] * local_words + t / 64] |= 1UL << (t % 64);
+        }
+    }
+    cvector_free(keys);
+
+    uint64_t *words = (uint64_t *)malloc(world_size * sizeof(uint64_t));
+    int *counts = (int *)malloc(world_size * sizeof(int));
+    int *displs = (int *)malloc(world_size * sizeof(int));
+    assert(words != NULL && counts != NULL && displs != NULL);
+    MPI_Allgather(&local_words, 1, MPI_UINT64_T, words, 1, MPI_UINT64_T,
+                  MPI_COMM_WORLD);
+    uint64_t num_words = 0, offset = 0;
+    int r;
+    for (r = 0; r < world_size; r++) {
+        num_words += words[r];
+    }
+    // the transaction ids have to fit the diffsets
+    assert(num_words * 64 <= UINT32_MAX);
+    assert(num_items * num_words <= INT_MAX);
+    for (r = 0; r < world_size; r++) {
+        counts[r] = num_items * words[r];
+        displs[r] = offset;
+        offset += counts[r];
+    }
+    uint64_t *gathered =
+        (uint64_t *)malloc((num_items * num_words + 1) * sizeof(uint64_t));
+    assert(gathered != NULL);
+    MPI_Allgatherv(local, counts[rank], MPI_UINT64_T, gathered, counts, displs,
+                   MPI_UINT64_T, MPI_COMM_WORLD);
+    free(local);
+
+    // from process by process to item by item
+    db->num_items = num_items;
+    db->num_words = num_words;
+    db->bits =
+        (uint64_t *)malloc((num_items * num_words + 1) * sizeof(uint64_t));
+    db->supports = (int *)calloc(num_items + 1, sizeof(int));
+    assert(db->bits != NULL && db->supports != NULL);
+    int i;
+    offset = 0;
+    for (r = 0; r < world_size; r++) {
+        for (i = 0; i < num_items; i++) {
+            memcpy(db->bits + i * num_words + offset,
+                   gathered + displs[r] + i * words[r],
+                   words[r] * sizeof(uint64_t));
+        }
+        offset += words[r];
+    }
+    for (i = 0; i < num_items; i++) {
+        db->supports[i] = bitset_count(db->bits + i * num_words, num_words);
+    }
+    free(gathered);
+    free(words);
+    free(counts);
+    free(displs);
+}
+
+/**
+ * @brief Free a vertical database
+ *
+ * @param db The database
+ */
+void vertical_database_free(VerticalDatabase *db) {
+    free(db->bits);
+    free(db->supports);
+    db->bits = NULL;
+    db->supports = NULL;
+}
+
+/**
+ * @brief Number of transactions in a but not in b
+ */
+ECLAT_POPCOUNT_KERNEL
+static int bitset_andnot_count(const uint64_t *a, const uint64_t *b,
+                               uint64_t num_words) {
+    int count = 0;
+    uint64_t w;
+    for (w = 0; w < num_words; w++) {
+        count += __builtin_popcountll(a[w] & ~b[w]);
+    }
+    return count;
+}
+
+/**
+ * @brief Store the transactions in both a and b in dest, returning their
+ * number
+ */
+ECLAT_POPCOUNT_KERNEL
+static int bitset_and(uint64_t *dest, const uint64_t *a, const uint64_t *b,
+                      uint64_t num_words) {
+    int count = 0;
+    uint64_t w;
+    for (w = 0; w < num_words; w++) {
+        dest[w] = a[w] & b[w];
+        count += __builtin_popcountll(dest[w]);
+    }
+    return count;
+}
+
+/**
+ * @brief Append to tids the sorted ids of the transactions in a but not in
+ * b
+ */
+static void bitset_andnot_tids(const uint64_t *a, const uint64_t *b,
+                               uint64_t num_words,
+                               cvector_vector_type(uint32_t) * tids) {
+    uint64_t w;
+    for (w = 0; w < num_words; w++) {
+        uint64_t word = a[w] & ~b[w];
+        while (word != 0) {
+            cvector_push_back((*tids), w * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+}
+
+/**
+ * @brief Append to tids the ids in the sorted array a but not in the sorted
+ * array b
+ */
+static void tids_difference(const uint32_t *a, size_t na, const uint32_t *b,
+                            size_t nb, cvector_vector_type(uint32_t) * tids) {
+    size_t i = 0, j = 0;
+    while (i < na) {
+        if (j == nb || a[i] < b[j]) {
+            cvector_push_back((*tids), a[i]);
+            i++;
+        } else if (a[i] > b[j]) {
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * @brief Free the members of a class
+ */
+static void eclat_class_free(cvector_vector_type(EclatMember) * members) {
+    size_t n = cvector_size((*members)), i;
+    for (i = 0; i < n; i++) {
+        free((*members)[i].bits);
+        cvector_free((*members)[i].diff);
+    }
+    cvector_free((*members));
+    *members = NULL;
+}
+
+/**
+ * @brief Build the class of the itemset of a member, i.e. extend it with the
+ * items of the following members.
+ *
+ * @param context The parameters of the mining
+ * @param num_words Number of words of a bitset
+ * @param members The members of the current class
+ * @param i Index of the member to extend
+ * @param n_items Number of items of the itemsets of the new class
+ * @param children Where to store the frequent itemsets of the new class
+ */
+static void eclat_extend(MineContext *context, uint64_t num_words,
+                         cvector_vector_type(EclatMember) members, int i,
+                         int n_items,
+                         cvector_vector_type(EclatMember) * children) {
+    int n = cvector_size(members), j;
+    EclatMember *member = &(members[i]);
+    if (member->bits == NULL) {
+        // diffsets stay diffsets
+        for (j = i + 1; j < n; j++) {
+            EclatMember child = {members[j].key, 0, NULL, NULL};
+            tids_difference(members[j].diff, cvector_size(members[j].diff),
+                            member->diff, cvector_size(member->diff),
+                            &(child.diff));
+            child.support = member->support - (int)cvector_size(child.diff);
+            if (child.support >= context->min_count) {
+                cvector_push_back((*children), child);
+            } else {
+                cvector_free(child.diff);
+            }
+        }
+        return;
+    }
+
+    if (n_items >= ECLAT_DIFFSET_DEPTH) {
+        // switch to diffsets if they are smaller than the bitsets
+        uint64_t diff_bytes = 0, bits_bytes = 0;
+        for (j = i + 1; j < n; j++) {
+            int missing =
+                bitset_andnot_count(member->bits, members[j].bits, num_words);
+            if (member->support - missing >= context->min_count) {
+                diff_bytes += missing * sizeof(uint32_t);
+                bits_bytes += num_words * sizeof(uint64_t);
+            }
+        }
+        if (diff_bytes < bits_bytes) {
+            for (j = i + 1; j < n; j++) {
+                EclatMember child = {members[j].key, 0, NULL, NULL};
+                bitset_andnot_tids(member->bits, members[j].bits, num_words,
+                                   &(child.diff));
+                child.support =
+                    member->support - (int)cvector_size(child.diff);
+                if (child.support >= context->min_count) {
+                    cvector_push_back((*children), child);
+                } else {
+                    cvector_free(child.diff);
+                }
+            }
+            return;
+        }
+    }
+
+    uint64_t *bits = NULL;
+    for (j = i + 1; j < n; j++) {
+        if (bits == NULL) {
+            bits = (uint64_t *)malloc((num_words + 1) * sizeof(uint64_t));
+            assert(bits != NULL);
+        }
+        int support = bitset_and(bits, member->bits, members[j].bits, num_words);
+        if (support >= context->min_count) {
+            EclatMember child = {members[j].key, support, bits, NULL};
+            cvector_push_back((*children), child);
+            bits = NULL;
+        }
+    }
+    free(bits);
+}
+
+/**
+ * @brief Report the itemsets of a class and mine the classes they generate
+ *
+ * @param context The parameters of the mining
+ * @param num_words Number of words of a bitset
+ * @param members The members of the class, by decreasing item id
+ * @param prefix The items of the prefix of the class
+ */
+static void eclat_class(MineContext *context, uint64_t num_words,
+                        cvector_vector_type(EclatMember) members,
+                        cvector_vector_type(int) * prefix) {
+    int n = cvector_size(members), i;
+    for (i = 0; i < n; i++) {
+        cvector_push_back((*prefix), members[i].key);
+        int n_items = cvector_size((*prefix));
+        context->visit(*prefix, n_items, members[i].support, context->data);
+        cvector_vector_type(EclatMember) children = NULL;
+        eclat_extend(context, num_words, members, i, n_items + 1, &children);
+        if (children != NULL) {
+            eclat_class(context, num_words, children, prefix);
+            eclat_class_free(&children);
+        }
+        cvector_pop_back((*prefix));
+    }
+}
+
+/**
+ * @brief Mine the classes of some single items, in parallel
+ *
+ * @param context The parameters of the mining
+ * @param db The vertical database
+ * @param first Position of the first item, from the least frequent one
+ * @param last Position after the last item
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the database
+ * @param num_threads Number of threads of every process
+ */
+static void eclat_mine_items(MineContext *context, VerticalDatabase *db,
+                             int first, int last, int rank, int world_size,
+                             int num_threads) {
+    int num_items = db->num_items, i;
+    uint64_t num_words = db->num_words;
+    // the least frequent items have the largest classes, they are handed out
+    // first
+#pragma omp parallel for default(none)                                         \
+    shared(context, db, first, last, rank, world_size, num_items, num_words)   \
+    schedule(dynamic, 1) num_threads(num_threads)
+    for (i = first; i < last; i++) {
+        int key = num_items - 1 - i, other;
+        if (key % world_size != rank || db->supports[key] < context->min_count) {
+            continue;
+        }
+        cvector_vector_type(int) prefix = NULL;
+        cvector_push_back(prefix, key);
+        context->visit(prefix, 1, db->supports[key], context->data);
+        const uint64_t *bits = db->bits + key * num_words;
+        cvector_vector_type(EclatMember) members = NULL;
+        uint64_t *pair = NULL;
+        for (other = key - 1; other >= 0; other--) {
+            if (pair == NULL) {
+                pair = (uint64_t *)malloc((num_words + 1) * sizeof(uint64_t));
+                assert(pair != NULL);
+            }
+            int support = bitset_and(pair, bits, db->bits + other * num_words,
+                                     num_words);
+            if (support >= context->min_count) {
+                EclatMember member = {other, support, pair, NULL};
+                cvector_push_back(members, member);
+                pair = NULL;
+            }
+        }
+        free(pair);
+        if (members != NULL) {
+            eclat_class(context, num_words, members, &prefix);
+            eclat_class_free(&members);
+        }
+        cvector_free(prefix);
+    }
+}
+
+/**
+ * @brief Find the frequent itemsets with Eclat.
+ *
+ * An itemset is extended with more frequent items only, so its equivalence
+ * class holds the itemsets made of its items and a more frequent one. The
+ * transactions of an itemset are a bitset, intersected with popcount, up to
+ * ECLAT_DIFFSET_DEPTH items; from there a class switches to diffsets, the
+ * sorted ids of the transactions of the prefix that miss the itemset, when
+ * they take less memory than the bitsets. The classes of the single items
+ * are split cyclically among the processes and mined in parallel by
+ * num_threads threads, as in @see mine_frequent_itemsets(); every process
+ * has to call this with the same database. With an end_round callback the
+ * items are mined in rounds, as in @see mine_frequent_itemsets().
+ *
+ * @param context The parameters of the mining
+ * @param db The vertical database
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the database
+ * @param num_threads Number of threads of every process
+ */
+void eclat_mine(MineContext *context, VerticalDatabase *db, int rank,
+                int world_size, int num_threads) {
+    int num_items = db->num_items, first, batch = num_items;
+    if (context->end_round != NULL) {
+        batch = MINE_SHARE_INTERVAL * world_size * num_threads;
+    }
+    for (first = 0; first < num_items; first += batch) {
+        int last = first + batch < num_items ? first + batch : num_items;
+        eclat_mine_items(context, db, first, last, rank, world_size,
+                         num_threads);
+        if (context->end_round != NULL) {
+            context->end_round(context->data);
+        }
+    }
+}
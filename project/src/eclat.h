@@ -0,0 +1,105 @@
+/**
+ * @file eclat.h
+ * @brief Mining of the frequent itemsets with Eclat over vertical bitsets,
+ * for dense datasets
+ *
+ */
+#ifndef ECLAT_H
+#define ECLAT_H
+
+#include "mine.h"
+#include "types.h"
+#include <stdint.h>
+
+/**
+ * @brief Number of items from which an itemset can be represented by the
+ * difference between its transactions and the ones of its prefix
+ */
+#define ECLAT_DIFFSET_DEPTH 3
+
+/**
+ * @brief Attribute of the kernels that count the bits of the bitsets.
+ * Without a target flag, __builtin_popcountll is a libgcc call for every
+ * word, so on x86-64 the kernels are also compiled for the popcnt
+ * instruction and the version for the CPU is chosen when the program is
+ * loaded.
+ */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ECLAT_POPCOUNT_KERNEL                                                  \
+    __attribute__((target_clones("popcnt", "default")))
+#else
+#define ECLAT_POPCOUNT_KERNEL
+#endif
+
+/**
+ * @brief The transactions of every frequent item, as a bitset over the ids
+ * of all the transactions
+ */
+typedef struct VerticalDatabase {
+    /**
+     * @brief The bitsets, num_words words for every item id
+     */
+    uint64_t *bits;
+    /**
+     * @brief Number of 64-bit words of a bitset
+     */
+    uint64_t num_words;
+    /**
+     * @brief The ids of the items are in [0, num_items)
+     */
+    int num_items;
+    /**
+     * @brief Support count of every item
+     */
+    int *supports;
+} VerticalDatabase;
+
+/**
+ * @brief Build the vertical database of the transactions of all the
+ * processes. Every process sets the bits of its transactions, then the
+ * bitsets are gathered on every process, those of a process after the ones
+ * of the processes with lower rank.
+ *
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param transactions The transactions of the current process
+ * @param index_map Map from the frequent items to their id
+ * @param num_items Number of frequent items
+ * @param db Where to store the database
+ */
+void vertical_database_build(int rank, int world_size,
+                             TransactionsList transactions,
+                             IndexMap index_map, int num_items,
+                             VerticalDatabase *db);
+
+/**
+ * @brief Free a vertical database
+ *
+ * @param db The database
+ */
+void vertical_database_free(VerticalDatabase *db);
+
+/**
+ * @brief Find the frequent itemsets with Eclat.
+ *
+ * An itemset is extended with more frequent items only, so its equivalence
+ * class holds the itemsets made of its items and a more frequent one. The
+ * transactions of an itemset are a bitset, intersected with popcount, up to
+ * ECLAT_DIFFSET_DEPTH items; from there a class switches to diffsets, the
+ * sorted ids of the transactions of the prefix that miss the itemset, when
+ * they take less memory than the bitsets. The classes of the single items
+ * are split cyclically among the processes and mined in parallel by
+ * num_threads threads, as in @see mine_frequent_itemsets(); every process
+ * has to call this with the same database. With an end_round callback the
+ * items are mined in rounds, as in @see mine_frequent_itemsets().
+ *
+ * @param context The parameters of the mining
+ * @param db The vertical database
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the database
+ * @param num_threads Number of threads of every process
+ */
+void eclat_mine(MineContext *context, VerticalDatabase *db, int rank,
+                int world_size, int num_threads);
+
+#endif
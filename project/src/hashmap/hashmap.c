@@ -449,6 +449,15 @@ int hashmap_length(map_t in) {
         return 0;
 }
 
+/* Return the number of bytes allocated by the hashmap */
+size_t hashmap_memory(map_t in) {
+    hashmap_map *m = (hashmap_map *)in;
+    if (m != NULL)
+        return sizeof(hashmap_map) + m->table_size * sizeof(hashmap_element);
+    else
+        return 0;
+}
+
 int hashmap_print(map_t in) {
     int i;
 
@@ -540,4 +549,21 @@ int hashmap_get_keys(map_t in, cvector_vector_type(uint8_t *) * keys) {
         }
 
     return MAP_OK;
-}
\ No newline at end of file
+}
+
+/*
+ * Iterate over the elements of the hashmap without copying them. Return a
+ * pointer to the first element in use at a position >= *pos, and move *pos
+ * past it. Return NULL when there are no more elements. Start with *pos = 0.
+ */
+hashmap_element *hashmap_next(map_t in, int *pos) {
+    hashmap_map *m = (hashmap_map *)in;
+
+    while (*pos < m->table_size) {
+        hashmap_element *el = &(m->data[*pos]);
+        (*pos)++;
+        if (el->in_use)
+            return el;
+    }
+    return NULL;
+}
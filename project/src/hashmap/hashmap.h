@@ -106,6 +106,11 @@ extern void hashmap_free(map_t in);
  */
 extern int hashmap_length(map_t in);
 
+/*
+ * Get the number of bytes allocated by a hashmap
+ */
+extern size_t hashmap_memory(map_t in);
+
 int hashmap_print(map_t in);
 
 int hashmap_get_elements(map_t in,
@@ -118,4 +123,12 @@ int hashmap_get_keys(map_t in, cvector_vector_type(uint8_t *) * keys);
 
 int hashmap_increment(map_t in, const void *key, size_t key_length, int inc);
 
+/*
+ * Iterate over the elements of the hashmap without copying them. Return a
+ * pointer to the first element in use at a position >= *pos, and move *pos
+ * past it. Return NULL when there are no more elements. Start with *pos = 0.
+ * The value of the returned element can be modified in place.
+ */
+hashmap_element *hashmap_next(map_t in, int *pos);
+
 #endif // __HASHMAP_H__
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "histogram.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Sum of two counts, kept at UINT64_MAX when it does not fit
+ */
+static uint64_t histogram_sum(uint64_t a, uint64_t b) {
+    return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+}
+
+/**
+ * @brief Instantiate an empty histogram. The supports are split in bins
+ * growing geometrically, HISTOGRAM_BINS_PER_DOUBLING of them every time the
+ * support doubles.
+ *
+ * @param histogram The histogram to initialize
+ * @param max_length Maximum length of an itemset, i.e. the number of items
+ * @param min_count Minimum support count of a frequent itemset
+ * @param max_count Maximum support count of an itemset
+ * @param supports Whether to count the itemsets by support too
+ * @param num_threads Number of threads that add to the histogram
+ */
+void histogram_init(ItemsetHistogram *histogram, int max_length,
+                    int min_count, int max_count, bool supports,
+                    int num_threads) {
+    assert(max_length >= 0 && num_threads > 0);
+    min_count = min_count > 1 ? min_count : 1;
+    max_count = max_count > min_count ? max_count : min_count;
+    histogram->max_length = max_length;
+    histogram->num_threads = num_threads;
+    histogram->num_bins = 0;
+    histogram->bounds = NULL;
+    if (supports) {
+        int max_bins = HISTOGRAM_BINS_PER_DOUBLING * 32 + 2, b;
+        histogram->bounds = (int *)malloc(max_bins * sizeof(int));
+        assert(histogram->bounds != NULL);
+        double bound = min_count;
+        for (b = 1; bound <= max_count; b++) {
+            // the bins narrower than a support count are merged
+            if (histogram->num_bins == 0 ||
+                bound > histogram->bounds[histogram->num_bins - 1]) {
+                histogram->bounds[histogram->num_bins++] = (int)bound;
+            }
+            bound = ceil(min_count *
+                         pow(2, (double)b / HISTOGRAM_BINS_PER_DOUBLING));
+        }
+        histogram->bounds[histogram->num_bins] = max_count + 1;
+    }
+    size_t row = histogram->max_length + 1 + histogram->num_bins;
+    histogram->counts = (uint64_t *)calloc(row * num_threads, sizeof(uint64_t));
+    assert(histogram->counts != NULL);
+}
+
+/**
+ * @brief Free a histogram
+ *
+ * @param histogram The histogram
+ */
+void histogram_free(ItemsetHistogram *histogram) {
+    free(histogram->bounds);
+    free(histogram->counts);
+    histogram->bounds = NULL;
+    histogram->counts = NULL;
+}
+
+/**
+ * @brief Counts of the current thread
+ */
+static uint64_t *histogram_row(ItemsetHistogram *histogram) {
+    int thread = omp_get_thread_num();
+    assert(thread < histogram->num_threads);
+    return histogram->counts +
+           (size_t)thread * (histogram->max_length + 1 + histogram->num_bins);
+}
+
+/**
+ * @brief Count of the bin of a support in a row of counts, NULL if the
+ * supports are not counted
+ */
+static uint64_t *histogram_bin(ItemsetHistogram *histogram, uint64_t *row,
+                               int support) {
+    if (histogram->num_bins == 0) {
+        return NULL;
+    }
+    // the last bound not above the support
+    int low = 0, high = histogram->num_bins;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (histogram->bounds[mid] <= support)
+            low = mid;
+        else
+            high = mid;
+    }
+    return row + histogram->max_length + 1 + low;
+}
+
+/**
+ * @brief Count some itemsets with the same length and support, from any
+ * thread
+ *
+ * @param histogram The histogram
+ * @param length Length of the itemsets
+ * @param support Support count of the itemsets
+ * @param count Number of itemsets
+ */
+void histogram_add(ItemsetHistogram *histogram, int length, int support,
+                   uint64_t count) {
+    assert(length >= 0 && length <= histogram->max_length);
+    uint64_t *row = histogram_row(histogram);
+    row[length] = histogram_sum(row[length], count);
+    uint64_t *bin = histogram_bin(histogram, row, support);
+    if (bin != NULL)
+        *bin = histogram_sum(*bin, count);
+}
+
+/**
+ * @brief Count the itemsets made of a prefix and a nonempty subset of the
+ * nodes of a single path, from any thread. The support of such an itemset
+ * is the one of its deepest node, so the node at depth j ends 2^(j - 1) of
+ * them, C(j - 1, t) of which with t more nodes, and they are counted
+ * without enumerating them.
+ *
+ * @param histogram The histogram
+ * @param prefix_length Length of the prefix
+ * @param supports The support count of every node of the path, from the
+ * root
+ * @param n_nodes Number of nodes of the path
+ */
+void histogram_add_path(ItemsetHistogram *histogram, int prefix_length,
+                        const int *supports, int n_nodes) {
+    assert(prefix_length + n_nodes <= histogram->max_length);
+    uint64_t *row = histogram_row(histogram);
+    // the binomial coefficients C(j - 1, t), a row of Pascal's triangle
+    uint64_t *binomials = (uint64_t *)malloc((n_nodes + 1) * sizeof(uint64_t));
+    assert(binomials != NULL);
+    binomials[0] = 1;
+    uint64_t ending = 1;
+    int j, t;
+    for (j = 1; j <= n_nodes; j++) {
+        for (t = 0; t < j; t++) {
+            row[prefix_length + 1 + t] =
+                histogram_sum(row[prefix_length + 1 + t], binomials[t]);
+        }
+        uint64_t *bin = histogram_bin(histogram, row, supports[j - 1]);
+        if (bin != NULL)
+            *bin = histogram_sum(*bin, ending);
+        binomials[j] = 1;
+        for (t = j - 1; t > 0; t--) {
+            binomials[t] = histogram_sum(binomials[t], binomials[t - 1]);
+        }
+        ending = histogram_sum(ending, ending);
+    }
+    free(binomials);
+}
+
+/**
+ * @brief Visitor that counts an itemset in a histogram
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the ItemsetHistogram
+ */
+void histogram_visit(const int *items, int n_items, int support, void *data) {
+    histogram_add((ItemsetHistogram *)data, n_items, support, 1);
+}
+
+/**
+ * @brief Saturating sum of the counts of two processes, as an MPI_Op
+ */
+static void histogram_sum_op(void *in, void *inout, int *len,
+                             MPI_Datatype *type) {
+    const uint64_t *a = (const uint64_t *)in;
+    uint64_t *b = (uint64_t *)inout;
+    int i;
+    for (i = 0; i < *len; i++) {
+        b[i] = histogram_sum(a[i], b[i]);
+    }
+}
+
+/**
+ * @brief Sum the counts of all the threads of all the processes into the
+ * ones of thread 0 of process 0, collectively
+ *
+ * @param histogram The histogram
+ * @param rank Rank of the current process
+ */
+void histogram_reduce(ItemsetHistogram *histogram, int rank) {
+    int size = histogram->max_length + 1 + histogram->num_bins, t, i;
+    uint64_t *counts = histogram->counts;
+    for (t = 1; t < histogram->num_threads; t++) {
+        for (i = 0; i < size; i++) {
+            counts[i] = histogram_sum(counts[i], counts[t * size + i]);
+        }
+    }
+    MPI_Op op;
+    MPI_Op_create(histogram_sum_op, 1, &op);
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : counts, counts, size, MPI_UINT64_T,
+               op, 0, MPI_COMM_WORLD);
+    MPI_Op_free(&op);
+}
+
+/**
+ * @brief Total number of itemsets of a reduced histogram
+ *
+ * @param histogram The histogram, see @see histogram_reduce()
+ * @return The number of itemsets
+ */
+uint64_t histogram_total(ItemsetHistogram *histogram) {
+    uint64_t total = 0;
+    int length;
+    for (length = 1; length <= histogram->max_length; length++) {
+        total = histogram_sum(total, histogram->counts[length]);
+    }
+    return total;
+}
+
+/**
+ * @brief Print the nonzero counts of a reduced histogram, one per line as
+ * "length_L_itemsets: count" and "support_LOW_HIGH_itemsets: count", where
+ * the supports of the bin are in [LOW, HIGH]
+ *
+ * @param histogram The histogram, see @see histogram_reduce()
+ * @param file Where to print
+ */
+void histogram_print(ItemsetHistogram *histogram, FILE *file) {
+    const uint64_t *counts = histogram->counts;
+    int length, b;
+    for (length = 1; length <= histogram->max_length; length++) {
+        if (counts[length] > 0)
+            fprintf(file, "length_%d_itemsets: %" PRIu64 "\n", length,
+                    counts[length]);
+    }
+    counts += histogram->max_length + 1;
+    for (b = 0; b < histogram->num_bins; b++) {
+        if (counts[b] > 0)
+            fprintf(file, "support_%d_%d_itemsets: %" PRIu64 "\n",
+                    histogram->bounds[b], histogram->bounds[b + 1] - 1,
+                    counts[b]);
+    }
+}
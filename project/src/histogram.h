@@ -0,0 +1,135 @@
+/**
+ * @file histogram.h
+ * @brief Counts of the frequent itemsets by length and by support, without
+ * enumerating them
+ *
+ */
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Number of bins of the supports for every doubling of the support
+ */
+#define HISTOGRAM_BINS_PER_DOUBLING 4
+
+/**
+ * @brief Number of frequent itemsets of every length and, optionally, of
+ * every range of supports. Every thread adds to its own counts, which are
+ * summed by @see histogram_reduce(). A count that does not fit in 64 bits is
+ * kept at UINT64_MAX.
+ */
+typedef struct ItemsetHistogram {
+    /**
+     * @brief Maximum length of an itemset, i.e. the number of items
+     */
+    int max_length;
+    /**
+     * @brief Number of bins of the supports, 0 if they are not counted
+     */
+    int num_bins;
+    /**
+     * @brief The lowest support of every bin, increasing, starting from the
+     * minimum support count, followed by the maximum support count plus one
+     */
+    int *bounds;
+    int num_threads;
+    /**
+     * @brief The counts of every thread: the max_length + 1 lengths followed
+     * by the num_bins bins
+     */
+    uint64_t *counts;
+} ItemsetHistogram;
+
+/**
+ * @brief Instantiate an empty histogram. The supports are split in bins
+ * growing geometrically, HISTOGRAM_BINS_PER_DOUBLING of them every time the
+ * support doubles.
+ *
+ * @param histogram The histogram to initialize
+ * @param max_length Maximum length of an itemset, i.e. the number of items
+ * @param min_count Minimum support count of a frequent itemset
+ * @param max_count Maximum support count of an itemset
+ * @param supports Whether to count the itemsets by support too
+ * @param num_threads Number of threads that add to the histogram
+ */
+void histogram_init(ItemsetHistogram *histogram, int max_length,
+                    int min_count, int max_count, bool supports,
+                    int num_threads);
+
+/**
+ * @brief Free a histogram
+ *
+ * @param histogram The histogram
+ */
+void histogram_free(ItemsetHistogram *histogram);
+
+/**
+ * @brief Count some itemsets with the same length and support, from any
+ * thread
+ *
+ * @param histogram The histogram
+ * @param length Length of the itemsets
+ * @param support Support count of the itemsets
+ * @param count Number of itemsets
+ */
+void histogram_add(ItemsetHistogram *histogram, int length, int support,
+                   uint64_t count);
+
+/**
+ * @brief Count the itemsets made of a prefix and a nonempty subset of the
+ * nodes of a single path, from any thread. The support of such an itemset
+ * is the one of its deepest node, so the node at depth j ends 2^(j - 1) of
+ * them, C(j - 1, t) of which with t more nodes, and they are counted
+ * without enumerating them.
+ *
+ * @param histogram The histogram
+ * @param prefix_length Length of the prefix
+ * @param supports The support count of every node of the path, from the
+ * root
+ * @param n_nodes Number of nodes of the path
+ */
+void histogram_add_path(ItemsetHistogram *histogram, int prefix_length,
+                        const int *supports, int n_nodes);
+
+/**
+ * @brief Visitor that counts an itemset in a histogram
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the ItemsetHistogram
+ */
+void histogram_visit(const int *items, int n_items, int support, void *data);
+
+/**
+ * @brief Sum the counts of all the threads of all the processes into the
+ * ones of thread 0 of process 0, collectively
+ *
+ * @param histogram The histogram
+ * @param rank Rank of the current process
+ */
+void histogram_reduce(ItemsetHistogram *histogram, int rank);
+
+/**
+ * @brief Total number of itemsets of a reduced histogram
+ *
+ * @param histogram The histogram, see @see histogram_reduce()
+ * @return The number of itemsets
+ */
+uint64_t histogram_total(ItemsetHistogram *histogram);
+
+/**
+ * @brief Print the nonzero counts of a reduced histogram, one per line as
+ * "length_L_itemsets: count" and "support_LOW_HIGH_itemsets: count", where
+ * the supports of the bin are in [LOW, HIGH]
+ *
+ * @param histogram The histogram, see @see histogram_reduce()
+ * @param file Where to print
+ */
+void histogram_print(ItemsetHistogram *histogram, FILE *file);
+
+#endif
@@ -1,4 +1,6 @@
 #include "io.h"
+#include "memory.h"
+#include "trace.h"
 #include "utils.h"
 #include <stdio.h>
 #include <string.h>
@@ -58,6 +60,25 @@ void transactions_free(TransactionsList *transactions) {
     }
 }
 
+/**
+ * @brief Number of bytes allocated by a list of transactions
+ *
+ * @param transactions The list of transactions
+ * @return The number of bytes
+ */
+size_t transactions_memory(TransactionsList transactions) {
+    size_t bytes = cvector_memory(transactions);
+    size_t i, j;
+    for (i = 0; i < cvector_size(transactions); i++) {
+        Transaction transaction = transactions[i];
+        bytes += cvector_memory(transaction);
+        for (j = 0; j < cvector_size(transaction); j++) {
+            bytes += cvector_memory(transaction[j]);
+        }
+    }
+    return bytes;
+}
+
 /**
  * @brief Write a list of transactions to the file named as the rank
  * of the process
@@ -112,8 +133,8 @@ void transactions_write(int rank, TransactionsList transactions) {
  * @param support_map The map from items to respective support
  * @return The index where the parsed item ends (excluded)
  */
-int item_parse(int rank, int i, char *chunk, int chunk_size,
-               Transaction *transaction, SupportMap *support_map) {
+size_t item_parse(int rank, size_t i, char *chunk, size_t chunk_size,
+                  Transaction *transaction, SupportMap *support_map) {
     // see if actually there is an item
     while (chunk[i] == ' ') {
         i++;
@@ -149,8 +170,9 @@ int item_parse(int rank, int i, char *chunk, int chunk_size,
  * @param support_map The map from items to respective support
  * @return The index where the parsed transaction ends (excluded)
  */
-int transaction_parse(int rank, int i, char *chunk, int chunk_size,
-                      TransactionsList *transactions, SupportMap *support_map) {
+size_t transaction_parse(int rank, size_t i, char *chunk, size_t chunk_size,
+                         TransactionsList *transactions,
+                         SupportMap *support_map) {
     while (chunk[i] == '\n') {
         i++;
     }
@@ -167,11 +189,33 @@ int transaction_parse(int rank, int i, char *chunk, int chunk_size,
     return i;
 }
 
+/**
+ * @brief Read size bytes of a file starting from start, in blocks of at most
+ * READ_BLOCK_SIZE bytes
+ *
+ * @param in The file
+ * @param start Offset of the first byte
+ * @param size Number of bytes
+ * @param chunk Where to store the bytes
+ */
+static void read_range(MPI_File in, MPI_Offset start, MPI_Offset size,
+                       char *chunk) {
+    MPI_Offset done = 0;
+    while (done < size) {
+        int block = (int)min64(READ_BLOCK_SIZE, size - done);
+        MPI_File_read_at(in, start + done, chunk + done, block, MPI_CHAR,
+                         MPI_STATUS_IGNORE);
+        done += block;
+    }
+}
+
 /**
  * @brief Read a chunk of the given file
  *
  * Read up to 2 * my_size, since we do not know where
- * transactions start exactly.
+ * transactions start exactly. Sizes and offsets are 64-bit and the
+ * read is split in blocks of at most READ_BLOCK_SIZE bytes, so that
+ * a process can be assigned more than 2 GB of the file.
  *
  * @param filename File where transactions are stored
  * @param rank Rank of the current process
@@ -181,7 +225,7 @@ int transaction_parse(int rank, int i, char *chunk, int chunk_size,
  * @param read_size Number of bytes the current process has read
  */
 void read_chunk(char *filename, int rank, int world_size, char **chunk,
-                int *my_size, int *read_size) {
+                MPI_Offset *my_size, MPI_Offset *read_size) {
     MPI_File in;
     int ierr;
     ierr = MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY,
@@ -200,26 +244,127 @@ void read_chunk(char *filename, int rank, int world_size, char **chunk,
 
     //------ READ CHUNK -------
     *my_size = (filesize - 1) / world_size + 1;
-    start = max(0, rank * (*my_size) - 1);
+    start = max64(0, rank * (*my_size) - 1);
     *read_size = 2 * (*my_size);
     if (start + *read_size >= filesize) {
         *read_size = filesize - start;
-        (*my_size) = min((*my_size), *read_size);
+        (*my_size) = min64((*my_size), *read_size);
     }
     *chunk = malloc((*read_size + 1) * sizeof(char));
-    MPI_File_read_at(in, start, *chunk, *read_size, MPI_CHAR,
-                     MPI_STATUS_IGNORE);
+    assert(*chunk != NULL);
+    read_range(in, start, *read_size, *chunk);
 
     (*chunk)[*read_size] = '\0';
 
     MPI_File_close(&in);
 }
 
+/**
+ * @brief Read the binary header at the beginning of a file, if any
+ *
+ * @param in The file
+ * @param header Where to store the header
+ * @return true if the file is in binary format, false otherwise
+ */
+static bool binary_header_read(MPI_File in, BinaryHeader *header) {
+    MPI_Offset filesize;
+    MPI_File_get_size(in, &filesize);
+    if (filesize < (MPI_Offset)sizeof(BinaryHeader)) {
+        return false;
+    }
+    MPI_File_read_at(in, 0, header, sizeof(BinaryHeader), MPI_BYTE,
+                     MPI_STATUS_IGNORE);
+    return memcmp(header->magic, BINARY_MAGIC, 4) == 0;
+}
+
+/**
+ * @brief Read the transactions of the blocks of a binary file assigned to the
+ * current process. The blocks are split evenly among the processes, in order
+ *
+ * @param transactions List of transactions where to store the data
+ * @param in The file
+ * @param header The header of the file
+ * @param rank Rank of the current process
+ * @param world_size Number of active processes
+ * @param support_map A map from items to the respective support
+ */
+static void binary_transactions_read(TransactionsList *transactions,
+                                     MPI_File in, BinaryHeader *header,
+                                     int rank, int world_size,
+                                     SupportMap *support_map) {
+    if (header->version != BINARY_VERSION) {
+        if (rank == 0)
+            fprintf(stderr, "Unsupported binary format version %u\n",
+                    header->version);
+        MPI_Finalize();
+        exit(2);
+    }
+    uint64_t first = header->num_blocks * rank / world_size;
+    uint64_t last = header->num_blocks * (rank + 1) / world_size;
+    if (first == last) {
+        return;
+    }
+
+    trace_begin("read chunk");
+    uint64_t n_blocks = last - first;
+    BinaryBlock *blocks = (BinaryBlock *)malloc(n_blocks * sizeof(BinaryBlock));
+    assert(blocks != NULL);
+    MPI_File_read_at(in, header->index_offset + first * sizeof(BinaryBlock),
+                     blocks, n_blocks * sizeof(BinaryBlock), MPI_BYTE,
+                     MPI_STATUS_IGNORE);
+    // the blocks of a process are contiguous
+    MPI_Offset start = blocks[0].offset;
+    MPI_Offset size =
+        blocks[n_blocks - 1].offset + blocks[n_blocks - 1].bytes - start;
+    uint64_t n_transactions = 0, b;
+    for (b = 0; b < n_blocks; b++) {
+        n_transactions += blocks[b].num_transactions;
+    }
+    free(blocks);
+
+    char *chunk = malloc(size);
+    assert(size == 0 || chunk != NULL);
+    MPI_Offset done = 0;
+    while (done < size) {
+        int block = (int)min64(READ_BLOCK_SIZE, size - done);
+        MPI_File_read_at(in, start + done, chunk + done, block, MPI_BYTE,
+                         MPI_STATUS_IGNORE);
+        done += block;
+    }
+    trace_end();
+
+    trace_begin("parse transactions");
+    cvector_grow((*transactions), n_transactions);
+    uint32_t *ids = (uint32_t *)chunk;
+    uint64_t pos = 0, t;
+    char name[16];
+    for (t = 0; t < n_transactions; t++) {
+        uint32_t n_items = ids[pos++], j;
+        assert((pos + n_items) * sizeof(uint32_t) <= (uint64_t)size);
+        Transaction transaction = NULL;
+        cvector_grow(transaction, n_items);
+        for (j = 0; j < n_items; j++) {
+            int length = snprintf(name, sizeof(name), "i%u", ids[pos++]);
+            Item item = NULL;
+            cvector_grow(item, length + 1);
+            memcpy(item, name, length + 1);
+            cvector_set_size(item, length + 1);
+            cvector_push_back(transaction, item);
+            update_supports(item, support_map);
+        }
+        cvector_push_back((*transactions), transaction);
+    }
+    free(chunk);
+    trace_end();
+}
+
 /**
  * @brief Read a list of transactions from the portion of
  * file assigned to the current process. The support of the
  * items read is increased in the support_map
  *
+ * The file is either text, with a transaction per line and the items
+ * separated by spaces, or in the binary format described by BinaryHeader.
  *
  * @param transactions List of transactions where to store the data
  * @param filename Name of the file from which to read
@@ -229,12 +374,36 @@ void read_chunk(char *filename, int rank, int world_size, char **chunk,
  */
 void transactions_read(TransactionsList *transactions, char *filename, int rank,
                        int world_size, SupportMap *support_map) {
+    MPI_File in;
+    if (MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                      &in) == MPI_SUCCESS) {
+        BinaryHeader header;
+        bool binary = binary_header_read(in, &header);
+        if (binary) {
+            binary_transactions_read(transactions, in, &header, rank,
+                                     world_size, support_map);
+        }
+        MPI_File_close(&in);
+        if (binary) {
+            return;
+        }
+    }
+
     char *chunk;
-    int my_size, read_size;
+    MPI_Offset my_size, read_size;
+    trace_begin("read chunk");
     read_chunk(filename, rank, world_size, &chunk, &my_size, &read_size);
+    trace_end();
 
+    trace_begin("parse transactions");
     //------ READ TRANSACTIONS ----------
-    int i = 0;
+    size_t i = 0;
+    // every process reads the transactions that follow a newline in
+    // [rank * my_size - 1, (rank + 1) * my_size - 1), the first one of
+    // process 0 follows an implicit newline at -1. The chunk of process 0
+    // starts at 0 rather than at -1, so its end is one byte earlier
+    size_t end = rank > 0 || my_size == 0 ? my_size : my_size - 1;
+    bool first = rank == 0 && my_size > 0;
     // skip first incomplete transaction
     if (rank > 0) {
         while (chunk[i] != '\n') {
@@ -243,10 +412,103 @@ void transactions_read(TransactionsList *transactions, char *filename, int rank,
     }
     // read transactions starting before the ending of the bytes assigned
     // to the current process
-    while (i < my_size) {
+    while (first || i < end) {
+        first = false;
         i = transaction_parse(rank, i, chunk, read_size, transactions,
                               support_map);
         assert(cvector_size((*transactions)) > 0);
     }
     free(chunk);
-}
\ No newline at end of file
+    trace_end();
+}
+/**
+ * @brief Read a sample of the transactions of the portion of a text file
+ * assigned to the current process, the same as the one of
+ * @see read_chunk(). The portion is split in equal strides, and the
+ * transactions starting in a window of SAMPLE_WINDOW_SIZE bytes in the
+ * middle of every stride are read, so that about fraction of the bytes are
+ * sampled evenly across the file. The support of the items read is increased
+ * in the support_map
+ *
+ * @param transactions List of transactions where to store the sample
+ * @param filename Name of the text file from which to read
+ * @param fraction Fraction of the bytes to sample, in (0, 1]
+ * @param rank Rank of the current process
+ * @param world_size Number of active processes
+ * @param support_map A map from items to the respective support
+ * @return The number of bytes sampled by the current process
+ */
+MPI_Offset transactions_sample(TransactionsList *transactions, char *filename,
+                               double fraction, int rank, int world_size,
+                               SupportMap *support_map) {
+    MPI_File in;
+    if (MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY,
+                      MPI_INFO_NULL, &in) != MPI_SUCCESS) {
+        if (rank == 0)
+            fprintf(stderr, "Process %d: Couldn't open file %s\n", rank,
+                    filename);
+        MPI_Finalize();
+        exit(2);
+    }
+    BinaryHeader header;
+    if (binary_header_read(in, &header)) {
+        if (rank == 0)
+            fprintf(stderr, "only text files can be sampled\n");
+        MPI_Finalize();
+        exit(1);
+    }
+    MPI_Offset filesize;
+    MPI_File_get_size(in, &filesize);
+    MPI_Offset my_size = (filesize - 1) / world_size + 1;
+    MPI_Offset begin = min64(rank * my_size, filesize);
+    MPI_Offset end = min64(begin + my_size, filesize);
+    MPI_Offset span = end - begin, sampled = 0;
+
+    trace_begin("read sample");
+    MPI_Offset target = max64(1, (MPI_Offset)(fraction * span));
+    MPI_Offset n_windows =
+        span > 0 ? (target - 1) / SAMPLE_WINDOW_SIZE + 1 : 0;
+    MPI_Offset stride = n_windows > 0 ? span / n_windows : 0, w;
+    MPI_Offset extra = n_windows > 0 ? span % n_windows : 0;
+    // a window and as many bytes after it, for the last transaction
+    char *chunk = malloc((2 * SAMPLE_WINDOW_SIZE + 2) * sizeof(char));
+    assert(chunk != NULL);
+    for (w = 0; w < n_windows; w++) {
+        // the strides cover the portion, the first extra ones a byte more
+        MPI_Offset stride_start = begin + w * stride + min64(w, extra);
+        MPI_Offset stride_size = stride + (w < extra ? 1 : 0);
+        MPI_Offset window =
+            min64((target - 1) / n_windows + 1, stride_size);
+        MPI_Offset first = stride_start + (stride_size - window) / 2;
+        MPI_Offset last = first + window;
+        // from the byte before the window, as in read_chunk()
+        MPI_Offset start = max64(0, first - 1);
+        MPI_Offset read_size =
+            min64(last + SAMPLE_WINDOW_SIZE, filesize) - start;
+        read_range(in, start, read_size, chunk);
+        chunk[read_size] = '\0';
+
+        size_t i = 0;
+        // skip first incomplete transaction
+        if (first > 0) {
+            while (chunk[i] != '\n' && chunk[i] != '\0') {
+                i++;
+            }
+        }
+        while (true) {
+            while (chunk[i] == '\n') {
+                i++;
+            }
+            // the transactions starting in the window
+            if (chunk[i] == '\0' || (MPI_Offset)i >= last - start)
+                break;
+            i = transaction_parse(rank, i, chunk, read_size, transactions,
+                                  support_map);
+        }
+        sampled += last - first;
+    }
+    free(chunk);
+    trace_end();
+    MPI_File_close(&in);
+    return sampled;
+}
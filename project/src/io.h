@@ -8,6 +8,53 @@
 
 #include "types.h"
 #include <mpi.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of bytes read with a single MPI_File_read_at call.
+ * MPI counts are int, so larger chunks are read in blocks of this size.
+ */
+#define READ_BLOCK_SIZE (1 << 30)
+
+/**
+ * @brief Number of bytes of every window of a sample of a text file, see
+ * @see transactions_sample()
+ */
+#define SAMPLE_WINDOW_SIZE (1 << 16)
+
+/**
+ * @brief First bytes of a file of transactions in binary format
+ */
+#define BINARY_MAGIC "FPTB"
+#define BINARY_VERSION 1
+
+/**
+ * @brief Header at the beginning of a file of transactions in binary format.
+ *
+ * The header is followed by the blocks of transactions, where every
+ * transaction is stored as its number of items n followed by the n item ids,
+ * all as native uint32_t; item id x is read as the item "i<x>", as written
+ * in the text files generated by the same generator. The blocks are
+ * contiguous and ordered, and are described by an array of BinaryBlock
+ * starting at index_offset, so that they can be split among the processes
+ * without scanning the file.
+ */
+typedef struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t num_transactions;
+    uint64_t num_blocks;
+    uint64_t index_offset;
+} BinaryHeader;
+
+/**
+ * @brief Position of a block of transactions in a binary file
+ */
+typedef struct BinaryBlock {
+    uint64_t offset;
+    uint64_t bytes;
+    uint64_t num_transactions;
+} BinaryBlock;
 
 /**
  * @brief Increase the support of the given item in the map.
@@ -32,6 +79,14 @@ void transaction_free(Transaction *transaction);
  */
 void transactions_free(TransactionsList *transactions);
 
+/**
+ * @brief Number of bytes allocated by a list of transactions
+ *
+ * @param transactions The list of transactions
+ * @return The number of bytes
+ */
+size_t transactions_memory(TransactionsList transactions);
+
 /**
  * @brief Write a list of transactions to the file named as the rank
  * of the process
@@ -55,8 +110,8 @@ void transactions_write(int rank, TransactionsList transactions);
  * @param support_map The map from items to respective support
  * @return The index where the parsed item ends (excluded)
  */
-int item_parse(int rank, int i, char *chunk, int chunk_size,
-               Transaction *transaction, SupportMap *support_map);
+size_t item_parse(int rank, size_t i, char *chunk, size_t chunk_size,
+                  Transaction *transaction, SupportMap *support_map);
 
 /**
  * @brief Parse an transaction from the string chunk, starting from
@@ -72,14 +127,17 @@ int item_parse(int rank, int i, char *chunk, int chunk_size,
  * @param support_map The map from items to respective support
  * @return The index where the parsed transaction ends (excluded)
  */
-int transaction_parse(int rank, int i, char *chunk, int chunk_size,
-                      TransactionsList *transactions, SupportMap *support_map);
+size_t transaction_parse(int rank, size_t i, char *chunk, size_t chunk_size,
+                         TransactionsList *transactions,
+                         SupportMap *support_map);
 
 /**
  * @brief Read a chunk of the given file
  *
  * Read up to 2 * my_size, since we do not know where
- * transactions start exactly.
+ * transactions start exactly. Sizes and offsets are 64-bit and the
+ * read is split in blocks of at most READ_BLOCK_SIZE bytes, so that
+ * a process can be assigned more than 2 GB of the file.
  *
  * @param filename File where transactions are stored
  * @param rank Rank of the current process
@@ -89,13 +147,15 @@ int transaction_parse(int rank, int i, char *chunk, int chunk_size,
  * @param read_size Number of bytes the current process has read
  */
 void read_chunk(char *filename, int rank, int world_size, char **chunk,
-                int *my_size, int *read_size);
+                MPI_Offset *my_size, MPI_Offset *read_size);
 
 /**
  * @brief Read a list of transactions from the portion of
  * file assigned to the current process. The support of the
  * items read is increased in the support_map
  *
+ * The file is either text, with a transaction per line and the items
+ * separated by spaces, or in the binary format described by BinaryHeader.
  *
  * @param transactions List of transactions where to store the data
  * @param filename Name of the file from which to read
@@ -106,4 +166,25 @@ void read_chunk(char *filename, int rank, int world_size, char **chunk,
 void transactions_read(TransactionsList *transactions, char *filename, int rank,
                        int world_size, SupportMap *support_map);
 
+/**
+ * @brief Read a sample of the transactions of the portion of a text file
+ * assigned to the current process, the same as the one of
+ * @see read_chunk(). The portion is split in equal strides, and the
+ * transactions starting in a window of SAMPLE_WINDOW_SIZE bytes in the
+ * middle of every stride are read, so that about fraction of the bytes are
+ * sampled evenly across the file. The support of the items read is increased
+ * in the support_map
+ *
+ * @param transactions List of transactions where to store the sample
+ * @param filename Name of the text file from which to read
+ * @param fraction Fraction of the bytes to sample, in (0, 1]
+ * @param rank Rank of the current process
+ * @param world_size Number of active processes
+ * @param support_map A map from items to the respective support
+ * @return The number of bytes sampled by the current process
+ */
+MPI_Offset transactions_sample(TransactionsList *transactions, char *filename,
+                               double fraction, int rank, int world_size,
+                               SupportMap *support_map);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "itemset_map.h"
+#include "memory.h"
+#include <string.h>
+
+#define ITEMSET_MAP_INITIAL_SIZE 64
+
+/**
+ * @brief Instantiate a new empty map
+ *
+ * @return Pointer to the map created
+ */
+ItemsetMap *itemset_map_new() {
+    ItemsetMap *map = (ItemsetMap *)malloc(sizeof(ItemsetMap));
+    assert(map != NULL);
+    map->table_size = ITEMSET_MAP_INITIAL_SIZE;
+    map->slots = (int *)malloc(map->table_size * sizeof(int));
+    map->hashes = (uint64_t *)malloc(map->table_size * sizeof(uint64_t));
+    assert(map->slots != NULL && map->hashes != NULL);
+    memset(map->slots, -1, map->table_size * sizeof(int));
+    map->entries = NULL;
+    return map;
+}
+
+/**
+ * @brief Free the map. The keys of the entries are freed as well, unless the
+ * entries have been taken out with @see itemset_map_take_entries()
+ *
+ * @param map Pointer to the map to free
+ */
+void itemset_map_free(ItemsetMap *map) {
+    if (map != NULL) {
+        weighted_itemsets_free(&(map->entries));
+        free(map->slots);
+        free(map->hashes);
+        free(map);
+    }
+}
+
+/**
+ * @brief Hash of an array of item ids
+ *
+ * @param items The item ids
+ * @param n_items Number of item ids
+ * @return The 64-bit hash of the array
+ */
+uint64_t itemset_hash(const int *items, int n_items) {
+    // FNV-1a on the ids, followed by a final avalanche
+    uint64_t hash = 14695981039346656037ULL;
+    int i;
+    for (i = 0; i < n_items; i++) {
+        hash ^= (uint32_t)items[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Find the slot of the given itemset, or the empty slot where it
+ * should be inserted
+ *
+ * @param map Pointer to the map
+ * @param items The item ids
+ * @param n_items Number of item ids
+ * @param hash Hash of the itemset
+ * @return Position of the slot in the table
+ */
+static int itemset_map_find(ItemsetMap *map, const int *items, int n_items,
+                            uint64_t hash) {
+    int mask = map->table_size - 1;
+    int curr = hash & mask;
+    while (map->slots[curr] != -1) {
+        WeightedItemset *entry = &(map->entries[map->slots[curr]]);
+        if (map->hashes[curr] == hash &&
+            cvector_size(entry->items) == (size_t)n_items &&
+            memcmp(entry->items, items, n_items * sizeof(int)) == 0) {
+            return curr;
+        }
+        curr = (curr + 1) & mask;
+    }
+    return curr;
+}
+
+/**
+ * @brief Double the size of the table and reinsert all the entries
+ *
+ * @param map Pointer to the map
+ */
+static void itemset_map_rehash(ItemsetMap *map) {
+    int old_size = map->table_size;
+    int *old_slots = map->slots;
+    uint64_t *old_hashes = map->hashes;
+
+    map->table_size *= 2;
+    map->slots = (int *)malloc(map->table_size * sizeof(int));
+    map->hashes = (uint64_t *)malloc(map->table_size * sizeof(uint64_t));
+    assert(map->slots != NULL && map->hashes != NULL);
+    memset(map->slots, -1, map->table_size * sizeof(int));
+
+    int mask = map->table_size - 1;
+    int i;
+    for (i = 0; i < old_size; i++) {
+        if (old_slots[i] != -1) {
+            int curr = old_hashes[i] & mask;
+            while (map->slots[curr] != -1) {
+                curr = (curr + 1) & mask;
+            }
+            map->slots[curr] = old_slots[i];
+            map->hashes[curr] = old_hashes[i];
+        }
+    }
+    free(old_slots);
+    free(old_hashes);
+}
+
+/**
+ * @brief Increase by weight the value of the given itemset. If the itemset
+ * is not present, a copy of it is inserted with value weight
+ *
+ * @param map Pointer to the map
+ * @param items The item ids
+ * @param n_items Number of item ids
+ * @param weight Amount to add to the value of the itemset
+ * @return The index of the itemset in the entries of the map
+ */
+int itemset_map_increment(ItemsetMap *map, const int *items, int n_items,
+                          int weight) {
+    uint64_t hash = itemset_hash(items, n_items);
+    int pos = itemset_map_find(map, items, n_items, hash);
+    if (map->slots[pos] != -1) {
+        map->entries[map->slots[pos]].weight += weight;
+        return map->slots[pos];
+    }
+
+    WeightedItemset entry;
+    entry.items = NULL;
+    entry.weight = weight;
+    if (n_items > 0) {
+        cvector_grow(entry.items, n_items);
+        memcpy(entry.items, items, n_items * sizeof(int));
+        cvector_set_size(entry.items, n_items);
+    }
+    int index = cvector_size(map->entries);
+    cvector_push_back(map->entries, entry);
+    map->slots[pos] = index;
+    map->hashes[pos] = hash;
+
+    // keep the load factor below 1/2
+    if (2 * cvector_size(map->entries) >= (size_t)map->table_size) {
+        itemset_map_rehash(map);
+    }
+    return index;
+}
+
+/**
+ * @brief Get the value of the given itemset
+ *
+ * @param map Pointer to the map
+ * @param items The item ids
+ * @param n_items Number of item ids
+ * @param weight Where to store the value of the itemset
+ * @return MAP_OK if the itemset is present, MAP_MISSING otherwise
+ */
+int itemset_map_get(ItemsetMap *map, const int *items, int n_items,
+                    int *weight) {
+    uint64_t hash = itemset_hash(items, n_items);
+    int pos = itemset_map_find(map, items, n_items, hash);
+    if (map->slots[pos] == -1) {
+        return MAP_MISSING;
+    }
+    *weight = map->entries[map->slots[pos]].weight;
+    return MAP_OK;
+}
+
+/**
+ * @brief Number of itemsets in the map
+ *
+ * @param map Pointer to the map
+ * @return The number of itemsets
+ */
+int itemset_map_length(ItemsetMap *map) { return cvector_size(map->entries); }
+
+/**
+ * @brief Move the entries out of the map, which is left empty. The caller
+ * becomes the owner of the returned list
+ *
+ * @param map Pointer to the map
+ * @return The list of weighted itemsets stored in the map
+ */
+WeightedItemsetList itemset_map_take_entries(ItemsetMap *map) {
+    WeightedItemsetList entries = map->entries;
+    map->entries = NULL;
+    memset(map->slots, -1, map->table_size * sizeof(int));
+    return entries;
+}
+
+/**
+ * @brief Free a list of weighted itemsets and the items of every itemset
+ *
+ * @param list Pointer to the list to free
+ */
+void weighted_itemsets_free(WeightedItemsetList *list) {
+    if (*list != NULL) {
+        size_t n = cvector_size((*list));
+        size_t i;
+        for (i = 0; i < n; i++) {
+            cvector_free((*list)[i].items);
+        }
+        cvector_free((*list));
+        *list = NULL;
+    }
+}
+
+/**
+ * @brief Number of bytes allocated by a list of weighted itemsets
+ *
+ * @param list The list
+ * @return The number of bytes
+ */
+size_t weighted_itemsets_memory(WeightedItemsetList list) {
+    size_t bytes = cvector_memory(list);
+    size_t i;
+    for (i = 0; i < cvector_size(list); i++) {
+        bytes += cvector_memory(list[i].items);
+    }
+    return bytes;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file itemset_map.h
+ * @brief Hash map from sets of item ids to a count
+ *
+ */
+#ifndef ITEMSET_MAP_H
+#define ITEMSET_MAP_H
+
+#include "types.h"
+
+/**
+ * @brief Open addressing hash map whose keys are arrays of item ids.
+ *
+ * The entries are stored contiguously in insertion order, so that the
+ * content of the map can be used directly as a list of weighted itemsets.
+ */
+typedef struct ItemsetMap {
+    /**
+     * @brief Number of slots of the table, always a power of two
+     */
+    int table_size;
+    /**
+     * @brief Index in entries of the element stored in each slot, or -1
+     */
+    int *slots;
+    /**
+     * @brief Hash of the element stored in each slot
+     */
+    uint64_t *hashes;
+    /**
+     * @brief Elements of the map, in insertion order
+     */
+    WeightedItemsetList entries;
+} ItemsetMap;
+
+/**
+ * @brief Instantiate a new empty map
+ *
+ * @return Pointer to the map created
+ */
+ItemsetMap *itemset_map_new();
+
+/**
+ * @brief Free the map. The keys of the entries are freed as well, unless the
+ * entries have been taken out with @see itemset_map_take_entries()
+ *
+ * @param map Pointer to the map to free
+ */
+void itemset_map_free(ItemsetMap *map);
+
+/**
+ * @brief Hash of an array of item ids
+ *
+ * @param items The item ids
+ * @param n_items Number of item ids
+ * @return The 64-bit hash of the array
+ */
+uint64_t itemset_hash(const int *items, int n_items);
+
+/**
+ * @brief Increase by weight the value of the given itemset. If the itemset
+ * is not present, a copy of it is inserted with value weight
+ *
+ * @param map Pointer to the map
+ * @param items The item ids
+ * @param n_items Number of item ids
+ * @param weight Amount to add to the value of the itemset
+ * @return The index of the itemset in the entries of the map
+ */
+int itemset_map_increment(ItemsetMap *map, const int *items, int n_items,
+                          int weight);
+
+/**
+ * @brief Get the value of the given itemset
+ *
+ * @param map Pointer to the map
+ * @param items The item ids
+ * @param n_items Number of item ids
+ * @param weight Where to store the value of the itemset
+ * @return MAP_OK if the itemset is present, MAP_MISSING otherwise
+ */
+int itemset_map_get(ItemsetMap *map, const int *items, int n_items,
+                    int *weight);
+
+/**
+ * @brief Number of itemsets in the map
+ *
+ * @param map Pointer to the map
+ * @return The number of itemsets
+ */
+int itemset_map_length(ItemsetMap *map);
+
+/**
+ * @brief Move the entries out of the map, which is left empty. The caller
+ * becomes the owner of the returned list
+ *
+ * @param map Pointer to the map
+ * @return The list of weighted itemsets stored in the map
+ */
+WeightedItemsetList itemset_map_take_entries(ItemsetMap *map);
+
+/**
+ * @brief Free a list of weighted itemsets and the items of every itemset
+ *
+ * @param list Pointer to the list to free
+ */
+void weighted_itemsets_free(WeightedItemsetList *list);
+
+/**
+ * @brief Number of bytes allocated by a list of weighted itemsets
+ *
+ * @param list The list
+ * @return The number of bytes
+ */
+size_t weighted_itemsets_memory(WeightedItemsetList list);
+
+#endif
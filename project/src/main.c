@@ -1,98 +1,571 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <math.h>
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "dedup.h"
+#include "eclat.h"
+#include "histogram.h"
 #include "io.h"
+#include "memory.h"
+#include "mine.h"
+#include "options.h"
+#include "output.h"
+#include "oracle.h"
+#include "perf.h"
+#include "plan.h"
 #include "reduce.h"
+#include "rules.h"
+#include "sample.h"
+#include "snapshot.h"
 #include "sort.h"
+#include "stream.h"
+#include "topk.h"
+#include "trace.h"
+#include "update.h"
 #include "tree.h"
 #include "utils.h"
 
-void print_log_header(bool debug) {
-    if (debug) {
-        printf("rank, time, msg\n");
+/**
+ * @brief Mine the top_k itemsets with the highest support of the global
+ * tree, which every process has, and print them on process 0. The minimum
+ * support count is raised as they are found, see topk.h.
+ *
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param nodes The nodes of the global tree
+ * @param num_nodes Number of nodes
+ * @param num_items Number of frequent items
+ * @param min_count Minimum support count of the itemsets
+ * @param top_k Number of itemsets
+ * @param names Name of every item id
+ * @param num_threads Number of threads of every process
+ */
+static void report_top_k_itemsets(int rank, int world_size,
+                                  const TreeNodeToSend *nodes,
+                                  size_t num_nodes, int num_items,
+                                  int min_count, int top_k, char **names,
+                                  int num_threads) {
+    trace_begin("mined frequent itemsets");
+    TopK best;
+    top_k_mine(&best, top_k, nodes, num_nodes, num_items, min_count, rank,
+               world_size, num_threads);
+    trace_end();
+    if (rank == 0) {
+        size_t found = cvector_size(best.heap);
+        fprintf(stderr, "top_k_itemsets: %zu\n", found);
+        fprintf(stderr, "top_k_min_count: %d\n",
+                found > 0 ? best.heap[0].weight : min_count);
+        top_k_print(&best, names, stderr);
     }
+    top_k_free(&best);
 }
 
-void print_log(bool debug, int rank, double start, double end, char *msg) {
-    if (debug) {
-        printf("%d, %lf, %s\n", rank, end - start, msg);
+/**
+ * @brief Generate the association rules of the frequent itemsets collected
+ * by every process, writing them to the file of the options, and print
+ * their number on process 0
+ *
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param itemsets The frequent itemsets of the current process, replaced by
+ * the ones of all the processes
+ * @param options The options of the run
+ * @param names Name of every item id
+ * @param num_items Number of frequent items
+ * @param num_transactions Number of transactions
+ */
+static void report_rules(int rank, int world_size, ItemsetMap **itemsets,
+                         Options *options, char **names, int num_items,
+                         uint64_t num_transactions) {
+    trace_begin("generated association rules");
+    rules_share_itemsets(itemsets);
+    memory_log("rules_itemsets", weighted_itemsets_memory((*itemsets)->entries));
+    OutputWriter writer;
+    output_open(&writer, options->rules, options->format, names, num_items,
+                rank, options->num_threads);
+    rules_write(*itemsets, &writer, options->min_confidence,
+                num_transactions, rank, world_size, options->num_threads);
+    uint64_t total = output_close(&writer);
+    trace_end();
+    if (rank == 0)
+        fprintf(stderr, "rules: %" PRIu64 "\n", total);
+}
+
+/**
+ * @brief Destination of the mined itemsets: they are counted, and collected
+ * for the rules or written to a file if requested, or only counted by
+ * length and support
+ */
+typedef struct ItemsetSink {
+    uint64_t count;
+    /**
+     * @brief The itemsets collected for the rules, NULL if none
+     */
+    ItemsetMap *itemsets;
+    /**
+     * @brief The file of the itemsets, NULL if none
+     */
+    OutputWriter *writer;
+    /**
+     * @brief The counts of the itemsets, NULL if they are visited one by one
+     */
+    ItemsetHistogram *histogram;
+} ItemsetSink;
+
+/**
+ * @brief Visitor that hands an itemset to a sink
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the ItemsetSink
+ */
+static void sink_visit(const int *items, int n_items, int support,
+                       void *data) {
+    ItemsetSink *sink = (ItemsetSink *)data;
+#pragma omp atomic
+    sink->count++;
+    if (sink->itemsets != NULL)
+        rules_collect_itemset(items, n_items, support, sink->itemsets);
+    if (sink->writer != NULL)
+        output_itemset(items, n_items, support, sink->writer);
+}
+
+/**
+ * @brief Write the itemsets of a round of the mining
+ *
+ * @param data Pointer to the ItemsetSink
+ */
+static void sink_end_round(void *data) {
+    ItemsetSink *sink = (ItemsetSink *)data;
+    output_flush(sink->writer, false);
+}
+
+/**
+ * @brief Prepare the sink of a mining, opening the file of the itemsets if
+ * requested
+ *
+ * @param sink The sink to initialize
+ * @param context The mining, which gets the sink as its visitor
+ * @param options The options of the run
+ * @param names Name of every item id
+ * @param num_items Number of frequent items
+ * @param num_transactions Number of transactions, the highest support
+ * @param rank Rank of the current process
+ */
+static void sink_init(ItemsetSink *sink, MineContext *context,
+                      Options *options, char **names, int num_items,
+                      uint64_t num_transactions, int rank) {
+    sink->count = 0;
+    sink->itemsets = options->rules != NULL ? itemset_map_new() : NULL;
+    sink->writer = NULL;
+    sink->histogram = NULL;
+    context->visit = sink_visit;
+    context->data = sink;
+    if (options->output != NULL) {
+        sink->writer = (OutputWriter *)malloc(sizeof(OutputWriter));
+        assert(sink->writer != NULL);
+        output_open(sink->writer, options->output, options->format, names,
+                    num_items, rank, options->num_threads);
+        context->end_round = sink_end_round;
+    }
+    if (options->count) {
+        int max_count =
+            num_transactions < INT_MAX ? (int)num_transactions : INT_MAX;
+        sink->histogram = (ItemsetHistogram *)malloc(sizeof(ItemsetHistogram));
+        assert(sink->histogram != NULL);
+        histogram_init(sink->histogram, num_items, context->min_count,
+                       max_count, options->histogram, options->num_threads);
+        context->visit = histogram_visit;
+        context->data = sink->histogram;
+        context->histogram = sink->histogram;
+    }
+}
+
+/**
+ * @brief Print the number of itemsets of a sink on process 0, closing their
+ * file and generating their rules if requested
+ *
+ * @param sink The sink
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param label Which itemsets have been mined
+ * @param options The options of the run
+ * @param names Name of every item id
+ * @param num_items Number of frequent items
+ * @param num_transactions Number of transactions
+ */
+static void sink_report(ItemsetSink *sink, int rank, int world_size,
+                        const char *label, Options *options, char **names,
+                        int num_items, uint64_t num_transactions) {
+    uint64_t total = 0;
+    if (sink->histogram != NULL) {
+        histogram_reduce(sink->histogram, rank);
+        total = histogram_total(sink->histogram);
+    } else {
+        MPI_Reduce(&sink->count, &total, 1, MPI_UINT64_T, MPI_SUM, 0,
+                   MPI_COMM_WORLD);
+    }
+    if (rank == 0)
+        fprintf(stderr, "%s_itemsets: %" PRIu64 "\n", label, total);
+    if (sink->histogram != NULL) {
+        if (rank == 0)
+            histogram_print(sink->histogram, stderr);
+        histogram_free(sink->histogram);
+        free(sink->histogram);
+    }
+    if (sink->writer != NULL) {
+        trace_begin("wrote frequent itemsets");
+        uint64_t written = output_close(sink->writer);
+        trace_end();
+        free(sink->writer);
+        if (rank == 0)
+            fprintf(stderr, "written_itemsets: %" PRIu64 "\n", written);
+    }
+    if (sink->itemsets != NULL) {
+        report_rules(rank, world_size, &sink->itemsets, options, names,
+                     num_items, num_transactions);
+        itemset_map_free(sink->itemsets);
     }
 }
 
+/**
+ * @brief Mine the frequent itemsets of the global tree, which every process
+ * has, and print their number on process 0. Depending on the options, the
+ * top-k itemsets are printed instead, the itemsets are written to a file
+ * or their association rules are generated.
+ *
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param nodes The nodes of the global tree
+ * @param num_nodes Number of nodes
+ * @param chains The compacted records of the global tree, see
+ * @see tree_get_chains(), mined instead of the nodes if not NULL
+ * @param chains_size Number of ints of the records
+ * @param num_items Number of frequent items
+ * @param min_count Minimum support count of a frequent itemset
+ * @param options The options of the run
+ * @param names Name of every item id, used by the top-k itemsets and the
+ * rules
+ * @param num_transactions Number of transactions of the tree
+ */
+static void report_frequent_itemsets(int rank, int world_size,
+                                     const TreeNodeToSend *nodes,
+                                     size_t num_nodes, const int *chains,
+                                     uint64_t chains_size, int num_items,
+                                     int min_count, Options *options,
+                                     char **names, uint64_t num_transactions) {
+    if (options->top_k > 0) {
+        // the top-k search walks a node per item
+        cvector_vector_type(TreeNodeToSend) expanded = NULL;
+        if (chains != NULL) {
+            tree_chains_to_nodes(chains, chains_size, &expanded);
+            nodes = expanded;
+            num_nodes = cvector_size(expanded);
+        }
+        report_top_k_itemsets(rank, world_size, nodes, num_nodes, num_items,
+                              min_count, options->top_k, names,
+                              options->num_threads);
+        cvector_free(expanded);
+        return;
+    }
+    trace_begin("mined frequent itemsets");
+    MineContext context = {min_count, NULL, NULL, options->mode};
+    ItemsetSink sink;
+    sink_init(&sink, &context, options, names, num_items, num_transactions,
+              rank);
+    if (chains != NULL)
+        mine_frequent_itemsets_chains(&context, chains, chains_size, num_items,
+                                      rank, world_size, options->num_threads);
+    else
+        mine_frequent_itemsets(&context, nodes, num_nodes, num_items, rank,
+                               world_size, options->num_threads);
+    trace_end();
+    sink_report(&sink, rank, world_size, mine_mode_name(options->mode),
+                options, names, num_items, num_transactions);
+}
+
+/**
+ * @brief Broadcast the global tree from process 0 and mine its frequent
+ * itemsets, see @see report_frequent_itemsets()
+ *
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param tree The global tree on process 0, ignored on the others
+ * @param num_items Number of frequent items
+ * @param min_count Minimum support count of a frequent itemset
+ * @param options The options of the run
+ * @param names Name of every item id, used by the top-k itemsets and the
+ * rules
+ * @param num_transactions Number of transactions of the tree
+ */
+static void mine_global_tree(int rank, int world_size, Tree tree,
+                             int num_items, int min_count, Options *options,
+                             char **names, uint64_t num_transactions) {
+    trace_begin("broadcast global tree");
+    cvector_vector_type(TreeNodeToSend) nodes = NULL;
+    cvector_vector_type(int) chains = NULL;
+    if (options->compact) {
+        broadcast_tree_chains(rank, tree, &chains);
+        memory_log("global_tree_chains", cvector_memory(chains));
+    } else {
+        broadcast_tree_nodes(rank, tree, &nodes);
+        memory_log("global_tree_nodes", cvector_memory(nodes));
+    }
+    trace_end();
+    report_frequent_itemsets(rank, world_size, nodes, cvector_size(nodes),
+                             chains, cvector_size(chains), num_items,
+                             min_count, options, names, num_transactions);
+    cvector_free(chains);
+    cvector_free(nodes);
+}
+
+/**
+ * @brief Build the vertical database of the transactions of every process
+ * and mine its frequent itemsets with Eclat, printing their number on
+ * process 0, writing them and generating their association rules if
+ * requested
+ *
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param transactions The transactions of the current process
+ * @param index_map Map from the frequent items to their id
+ * @param num_items Number of frequent items
+ * @param min_count Minimum support count of a frequent itemset
+ * @param options The options of the run
+ * @param names Name of every item id, used by the rules
+ * @param num_transactions Number of transactions of all the processes
+ */
+static void mine_vertical_database(int rank, int world_size,
+                                   TransactionsList transactions,
+                                   IndexMap index_map, int num_items,
+                                   int min_count, Options *options,
+                                   char **names, uint64_t num_transactions) {
+    trace_begin("built vertical database");
+    VerticalDatabase db;
+    vertical_database_build(rank, world_size, transactions, index_map,
+                            num_items, &db);
+    memory_log("vertical_database",
+               db.num_items * db.num_words * sizeof(uint64_t));
+    trace_end();
+    trace_begin("mined frequent itemsets");
+    MineContext context = {min_count, NULL, NULL, MINE_ALL};
+    ItemsetSink sink;
+    sink_init(&sink, &context, options, names, num_items, num_transactions,
+              rank);
+    eclat_mine(&context, &db, rank, world_size, options->num_threads);
+    trace_end();
+    vertical_database_free(&db);
+    sink_report(&sink, rank, world_size, "frequent", options, names,
+                num_items, num_transactions);
+}
+
+/**
+ * @brief Minimum support count used to mine a saved tree. The items below
+ * the support count of the tree are not in it, so a lower one is raised
+ *
+ * @param rank Rank of the current process
+ * @param min_support Minimum support, as a fraction of the transactions
+ * @param num_transactions Number of transactions of the tree
+ * @param tree_min_count Minimum support count of the items of the tree
+ * @return The minimum support count
+ */
+static int saved_tree_min_count(int rank, double min_support,
+                                uint64_t num_transactions,
+                                int tree_min_count) {
+    int min_count = min_support * num_transactions;
+    if (min_count < tree_min_count) {
+        if (rank == 0)
+            fprintf(stderr,
+                    "min_support is lower than the one of the saved tree, "
+                    "using a support count of %d\n",
+                    tree_min_count);
+        min_count = tree_min_count;
+    }
+    return min_count;
+}
+
+/**
+ * @brief End of every mode of the program: write the trace if requested,
+ * free the trace and the hardware counters and finalize MPI
+ *
+ * @param options The options of the run
+ * @param status The exit status of the program
+ * @return The exit status, to be returned by main
+ */
+static int finish(Options *options, int status) {
+    if (options->trace_file != NULL)
+        trace_write(options->trace_file);
+    trace_free();
+    perf_free();
+    MPI_Finalize();
+    return status;
+}
+
 int main(int argc, char **argv) {
-    int rank, world_size;
+    int rank, world_size, provided;
 
-    MPI_Init(&argc, &argv);
+    // the threads of the output write in turn, see output.h
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     // printf("World size: %d\n", world_size);
 
-    if (argc < 2) {
-        if (rank == 0)
-            fprintf(stderr, "Usage: %s filename [numthreads]\n", argv[0]);
-        MPI_Finalize();
-        exit(1);
-    }
+    Options options;
+    options_parse(argc, argv, rank, &options);
+    int num_threads = options.num_threads;
+    double min_support = options.min_support;
+    bool debug = options.debug;
 
-    int num_threads = 1;
-    double min_support = 0;
-    bool debug = false;
-    if (argc > 2)
-        num_threads = atoi(argv[2]);
-    if (argc > 3)
-        min_support = atof(argv[3]);
-    if (argc > 4)
-        debug = atoi(argv[4]);
+    perf_init(rank, num_threads, options.perf);
+    memory_init(rank, options.memory);
+    trace_init(rank, debug, options.trace_file != NULL);
 
-    if (rank == 0)
-        print_log_header(debug);
+    /*--- MINE A SLIDING WINDOW OF A STREAM ---*/
+    if (options.window > 0) {
+        stream_mine(options.filename, options.window, options.pane,
+                    options.follow, min_support, options.mode, rank,
+                    world_size, num_threads);
+        return finish(&options, 0);
+    }
 
+    /*--- MINE A SAVED TREE ---*/
+    Snapshot snapshot;
+    if (snapshot_open(options.filename, &snapshot)) {
+        trace_begin("loaded tree snapshot");
+        const SnapshotHeader *header = snapshot.header;
+        int min_count = saved_tree_min_count(
+            rank, min_support, header->num_transactions, header->min_count);
+        memory_log("snapshot", snapshot.size);
+        trace_end();
+        char **names = (char **)malloc(header->num_items * sizeof(char *));
+        for (uint64_t i = 0; i < header->num_items; i++)
+            names[i] = (char *)snapshot.items[i].key;
+        report_frequent_itemsets(rank, world_size, snapshot.nodes,
+                                 header->num_nodes, NULL, 0, header->num_items,
+                                 min_count, &options, names,
+                                 header->num_transactions);
+        free(names);
+        snapshot_close(&snapshot);
+        return finish(&options, 0);
+    }
 
-    
+    /*--- UPDATE A SAVED TREE ---*/
+    if (options.update != NULL) {
+        if (!snapshot_open(options.update, &snapshot)) {
+            if (rank == 0)
+                fprintf(stderr, "%s is not a saved tree\n", options.update);
+            MPI_Finalize();
+            exit(1);
+        }
+        UpdatedTree updated;
+        tree_update(&snapshot, options.filename, rank, world_size,
+                    num_threads, options.grain, options.max_drift,
+                    options.compact, &updated);
+        snapshot_close(&snapshot);
+        int num_tree_items = cvector_size(updated.items);
+        if (rank == 0) {
+            fprintf(stderr, "global_tree_size: %zu\n",
+                    cvector_size(updated.tree));
+            fprintf(stderr, "original_num_items: %d\n", num_tree_items);
+            if (options.save_tree != NULL)
+                snapshot_write(options.save_tree, updated.tree, updated.items,
+                               num_tree_items, updated.supports,
+                               cvector_size(updated.supports),
+                               updated.num_transactions, updated.min_count,
+                               updated.min_support);
+        }
+        if (options.mine) {
+            char **names = (char **)malloc(num_tree_items * sizeof(char *));
+            for (int i = 0; i < num_tree_items; i++)
+                names[i] = (char *)updated.items[i].key;
+            mine_global_tree(rank, world_size, updated.tree, num_tree_items,
+                             saved_tree_min_count(rank, min_support,
+                                                  updated.num_transactions,
+                                                  updated.min_count),
+                             &options, names, updated.num_transactions);
+            free(names);
+        }
+        updated_tree_free(&updated);
+        return finish(&options, 0);
+    }
+
+    /*--- ESTIMATE THE SUPPORTS FROM A SAMPLE ---*/
+    if (options.sample > 0) {
+        double estimated = sample_min_support(
+            options.filename, options.sample, min_support,
+            options.target_items, options.target_itemsets, rank, world_size,
+            num_threads);
+        if (!options.auto_support) {
+            return finish(&options, 0);
+        }
+        min_support = estimated;
+        if (rank == 0)
+            fprintf(stderr, "min_support: %f\n", min_support);
+    }
 
-    double start_time, end_time;
     /*--- READ TRANSACTION AND SUPPORT MAP ---*/
-    start_time = MPI_Wtime();
+    trace_begin("read transactions");
     TransactionsList transactions = NULL;
     SupportMap support_map = hashmap_new();
-    transactions_read(&transactions, argv[1], rank, world_size, &support_map);
-    int num_transactions = cvector_size(transactions);
-    int num_global_transactions = 0;
-    MPI_Allreduce(&num_transactions, &num_global_transactions, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-
-    end_time = MPI_Wtime();
-    print_log(debug, rank, start_time, end_time, "read transactions");
+    transactions_read(&transactions, options.filename, rank, world_size, &support_map);
+    memory_log("transactions", transactions_memory(transactions));
+    memory_log("support_map", hashmap_memory(support_map));
+    uint64_t num_transactions = cvector_size(transactions);
+    uint64_t num_global_transactions = 0;
+    MPI_Allreduce(&num_transactions, &num_global_transactions, 1, MPI_UINT64_T,
+                  MPI_SUM, MPI_COMM_WORLD);
+    trace_end();
 
     // transactions_write(rank, transactions);
-    start_time = MPI_Wtime();
+    trace_begin("received global map");
     hashmap_element *items_count = NULL;
     int num_items;
+    int min_count = min_support * num_global_transactions;
+    uint64_t distinct_items = 0;
     get_global_map(rank, world_size, &support_map, &items_count, &num_items,
-                   min_support * num_global_transactions);
+                   min_count, options.sketch_width, &distinct_items);
+    // the items less frequent than k others are in no top-k itemset
+    if (options.top_k > 0)
+        min_count = top_k_filter_items(items_count, &num_items, min_count,
+                                       options.top_k);
+    memory_log("support_map", hashmap_memory(support_map));
+    // process 0 has the supports of all the items, saved to update the tree
+    cvector_vector_type(hashmap_element) all_supports = NULL;
+    if (options.save_tree != NULL && rank == 0)
+        hashmap_get_elements(support_map, &all_supports);
     hashmap_free(support_map);
-    end_time = MPI_Wtime();
-    print_log(debug, rank, start_time, end_time, "received global map");
+    trace_end();
 
     /*--- SORT ITEMS BY SUPPORT ---*/
-    start_time = MPI_Wtime();
+    trace_begin("sorted local items");
     size_t length = 1 + (num_items - 1) / world_size;
     int *sorted_indices = (int *)malloc(num_items * sizeof(int));
     int start = length * rank;
     int end = min(length * (rank + 1), num_items) - 1;
     start = start >= num_items ? end + 1 : start;
     sort(items_count, num_items, sorted_indices, start, end, num_threads);
-    end_time = MPI_Wtime();
-    print_log(debug, rank, start_time, end_time, "sorted local items");
-    start_time = MPI_Wtime();
+    trace_end();
+    trace_begin("received sorted global items");
     get_sorted_indices(rank, world_size, sorted_indices, start, end, length,
                        items_count, num_items);
-
-    end_time = MPI_Wtime();
-    print_log(debug, rank, start_time, end_time,
-              "received sorted global items");
+    // item -> id, ids are assigned by decreasing support
+    IndexMap index_map = hashmap_new();
+    for (int i = 0; i < num_items; i++) {
+        uint8_t *key = items_count[sorted_indices[i]].key;
+        int key_length = items_count[sorted_indices[i]].key_length;
+        hashmap_put(index_map, key, key_length, num_items - 1 - i);
+    }
+    // the items by id, to print the mined itemsets
+    char **names = (char **)malloc(num_items * sizeof(char *));
+    for (int i = 0; i < num_items; i++)
+        names[i] = (char *)items_count[sorted_indices[num_items - 1 - i]].key;
+    trace_end();
 
     /*--- PRINT ITEMS SORTED ---*/
     // if (rank == 0) {
@@ -104,45 +577,135 @@ int main(int argc, char **argv) {
     //     }
     // }
 
-    start_time = MPI_Wtime();
-    IndexMap index_map = hashmap_new(); // item -> pos in the sorted array
-    for (int i = 0; i < num_items; i++) {
-        uint8_t *key = items_count[sorted_indices[i]].key;
-        int key_length = items_count[sorted_indices[i]].key_length;
-        hashmap_put(index_map, key, key_length, sorted_indices[i]);
+    // printf("%d built index map\n", rank);
+    memory_log("index_map", hashmap_memory(index_map));
+
+    /*--- PLAN THE PIPELINE ---*/
+    MineEngine engine = options.engine;
+    bool dedup = options.dedup;
+    if (options.plan || engine == MINE_ENGINE_AUTO) {
+        trace_begin("planned pipeline");
+        PlanStats stats;
+        Plan plan;
+        plan_collect_stats(transactions, index_map, items_count, num_items,
+                           num_global_transactions, distinct_items,
+                           world_size, &stats);
+        plan_choose(&stats, &plan);
+        plan_log(rank, &stats, &plan);
+        trace_end();
+        if (engine == MINE_ENGINE_AUTO)
+            engine = plan.engine;
+        if (options.plan)
+            dedup = dedup || plan.dedup;
+    }
+    if ((options.mode != MINE_ALL || options.top_k > 0) &&
+        engine == MINE_ENGINE_ECLAT) {
+        if (rank == 0)
+            fprintf(stderr, "%s itemsets are mined with fpgrowth\n",
+                    options.top_k > 0 ? "top-k"
+                                      : mine_mode_name(options.mode));
+        engine = MINE_ENGINE_FPGROWTH;
     }
 
-    // printf("%d built index map\n", rank);
+    /*--- MINE THE VERTICAL DATABASE ---*/
+    if (options.mine && engine == MINE_ENGINE_ECLAT) {
+        mine_vertical_database(rank, world_size, transactions, index_map,
+                               num_items, min_count, &options, names,
+                               num_global_transactions);
+        // the tree is only needed to be checked or saved
+        if (!options.oracle && options.save_tree == NULL) {
+            hashmap_free(index_map);
+            transactions_free(&transactions);
+            free(names);
+            free(sorted_indices);
+            if (rank != 0)
+                free(items_count);
+            else
+                cvector_free(items_count);
+            return finish(&options, 0);
+        }
+    }
+
+    trace_begin(dedup ? "deduplicated transactions"
+                              : "built local tree");
 
-    Tree tree = tree_build_from_transactions(rank, world_size, transactions,
-                                             index_map, items_count, num_items,
-                                             sorted_indices, num_threads);
+    Tree tree;
+    if (dedup) {
+        WeightedItemsetList weighted = NULL;
+        transactions_dedup(&transactions, index_map, &weighted, num_threads);
+        hashmap_free(index_map);
+        transactions_free(&transactions);
+        exchange_weighted_transactions(rank, world_size, &weighted);
+        memory_log("weighted_transactions", weighted_itemsets_memory(weighted));
+        trace_end();
+        fprintf(stderr, "%d distinct_transactions: %zu\n", rank,
+                cvector_size(weighted));
+
+        trace_begin("built local tree");
+        tree = tree_build_from_weighted_transactions(weighted, num_threads,
+                                                     options.grain,
+                                                     options.compact);
+        weighted_itemsets_free(&weighted);
+    } else {
+        tree = tree_build_from_transactions(rank, world_size, transactions,
+                                            index_map, items_count, num_items,
+                                            sorted_indices, num_threads,
+                                            options.grain, options.compact);
+        hashmap_free(index_map);
+        transactions_free(&transactions);
+    }
     // printf("%d built tree\n", rank);
-    hashmap_free(index_map);
-    transactions_free(&transactions);
-    end_time = MPI_Wtime();
-    print_log(debug, rank, start_time, end_time, "built local tree");
+    memory_log("local_tree", tree_memory(tree));
+    trace_end();
     fprintf(stderr, "%d local_tree_size: %lu\n", rank, cvector_size(tree));
 
-    start_time = MPI_Wtime();
-
-    get_global_tree(rank, world_size, &tree);
+    trace_begin("received global tree");
+    get_global_tree(rank, world_size, &tree, num_threads,
+                    options.compact);
     if( rank == 0){
         fprintf(stderr, "global_tree_size: %lu\n", cvector_size(tree));
         fprintf(stderr, "original_num_items: %d\n", num_items);
+        memory_log("global_tree", tree_memory(tree));
+    }
+    trace_end();
+
+    // the oracle is not a phase of the pipeline, so it's not traced
+    uint64_t oracle_errors = 0;
+    if (options.oracle) {
+        if (rank == 0)
+            oracle_errors = oracle_check(options.filename, min_count,
+                                         num_global_transactions, items_count,
+                                         num_items, sorted_indices, tree);
+        MPI_Bcast(&oracle_errors, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
     }
-    end_time = MPI_Wtime();
-    print_log(debug, rank, start_time, end_time, "received global tree");
+
+    if (options.save_tree != NULL && rank == 0) {
+        // the items by id
+        hashmap_element *items =
+            (hashmap_element *)malloc(num_items * sizeof(hashmap_element));
+        for (int i = 0; i < num_items; i++)
+            items[i] = items_count[sorted_indices[num_items - 1 - i]];
+        snapshot_write(options.save_tree, tree, items, num_items,
+                       all_supports, cvector_size(all_supports),
+                       num_global_transactions, min_count, min_support);
+        free(items);
+        cvector_free(all_supports);
+    }
+
+    /*--- MINE FREQUENT ITEMSETS ---*/
+    if (options.mine && engine == MINE_ENGINE_FPGROWTH)
+        mine_global_tree(rank, world_size, tree, num_items, min_count,
+                         &options, names, num_global_transactions);
 
     /*--- FREE MEMORY ---*/
     if (tree != NULL)
         tree_free(&tree);
+    free(names);
     free(sorted_indices);
     if (rank != 0)
         free(items_count);
     else
         cvector_free(items_count);
-    MPI_Finalize();
 
-    return 0;
+    return finish(&options, oracle_errors == 0 ? 0 : 3);
 }
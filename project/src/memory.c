@@ -0,0 +1,120 @@
+#include "memory.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+static bool memory_on = false;
+static int memory_rank = 0;
+static const char *memory_phase = "";
+static uint64_t memory_max_buffer = 0;
+
+/**
+ * @brief Initialize the memory accounting of the current process
+ *
+ * @param rank Rank of the current process
+ * @param enabled Whether to print the memory log, if false all the other
+ * functions except the measures do nothing
+ */
+void memory_init(int rank, bool enabled) {
+    memory_rank = rank;
+    memory_on = enabled;
+    if (enabled && rank == 0) {
+        fprintf(stderr, "mem, rank, msg, what, bytes\n");
+    }
+}
+
+/**
+ * @brief Whether the memory log is printed
+ *
+ * @return true if memory_init() has been called with enabled
+ */
+bool memory_enabled() { return memory_on; }
+
+/**
+ * @brief Resident set size of the current process
+ *
+ * @return The resident set size in bytes, 0 if it is not available
+ */
+uint64_t memory_rss() {
+    unsigned long size, resident;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) {
+        return 0;
+    }
+    int read = fscanf(statm, "%lu %lu", &size, &resident);
+    fclose(statm);
+    if (read != 2) {
+        return 0;
+    }
+    return (uint64_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Peak resident set size of the current process
+ *
+ * @return The peak resident set size in bytes
+ */
+uint64_t memory_peak_rss() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in kilobytes on Linux
+    return (uint64_t)usage.ru_maxrss * 1024;
+}
+
+/**
+ * @brief Record a buffer sent or received with MPI in the current phase
+ *
+ * @param bytes Size of the buffer
+ */
+void memory_track_buffer(uint64_t bytes) {
+    if (memory_on && bytes > memory_max_buffer) {
+        memory_max_buffer = bytes;
+    }
+}
+
+/**
+ * @brief Print the size of a data structure
+ *
+ * @param what Name of the data structure
+ * @param bytes Size of the data structure
+ */
+void memory_log(const char *what, uint64_t bytes) {
+    if (memory_on) {
+        fprintf(stderr, "mem, %d, %s, %s, %" PRIu64 "\n", memory_rank,
+                memory_phase, what, bytes);
+    }
+}
+
+/**
+ * @brief Start a phase
+ *
+ * @param name Name of the phase
+ */
+void memory_phase_begin(const char *name) {
+    memory_phase = name;
+    memory_max_buffer = 0;
+}
+
+/**
+ * @brief End the current phase and print its memory usage
+ *
+ * @param rss Where to store the resident set size at the end of the phase
+ * @param peak_rss Where to store the peak resident set size
+ */
+void memory_phase_end(uint64_t *rss, uint64_t *peak_rss) {
+    *rss = 0;
+    *peak_rss = 0;
+    if (!memory_on) {
+        return;
+    }
+    *rss = memory_rss();
+    *peak_rss = memory_peak_rss();
+    // ru_maxrss is updated lazily by the kernel
+    if (*peak_rss < *rss) {
+        *peak_rss = *rss;
+    }
+    memory_log("rss", *rss);
+    memory_log("peak_rss", *peak_rss);
+    memory_log("max_message_buffer", memory_max_buffer);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file memory.h
+ * @brief Memory accounting of the data structures and of the phases
+ *
+ * The size of the main data structures is computed from their layout (the
+ * bytes requested to the allocator, without its overhead) and printed on
+ * stderr as "mem, rank, msg, what, bytes" lines, where msg is the phase in
+ * which the structure has been measured. At the end of every phase the
+ * resident set size, the peak resident set size of the process and the
+ * largest message buffer exchanged during the phase are printed as well.
+ */
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include "cvector/cvector.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Bytes allocated by a cvector, including its header
+ */
+#define cvector_memory(vec)                                                    \
+    ((vec) ? 2 * sizeof(size_t) + cvector_capacity(vec) * sizeof(*(vec))      \
+           : (size_t)0)
+
+/**
+ * @brief Initialize the memory accounting of the current process
+ *
+ * @param rank Rank of the current process
+ * @param enabled Whether to print the memory log, if false all the other
+ * functions except the measures do nothing
+ */
+void memory_init(int rank, bool enabled);
+
+/**
+ * @brief Whether the memory log is printed
+ *
+ * @return true if memory_init() has been called with enabled
+ */
+bool memory_enabled();
+
+/**
+ * @brief Resident set size of the current process
+ *
+ * @return The resident set size in bytes, 0 if it is not available
+ */
+uint64_t memory_rss();
+
+/**
+ * @brief Peak resident set size of the current process
+ *
+ * @return The peak resident set size in bytes
+ */
+uint64_t memory_peak_rss();
+
+/**
+ * @brief Record a buffer sent or received with MPI in the current phase
+ *
+ * @param bytes Size of the buffer
+ */
+void memory_track_buffer(uint64_t bytes);
+
+/**
+ * @brief Print the size of a data structure
+ *
+ * @param what Name of the data structure
+ * @param bytes Size of the data structure
+ */
+void memory_log(const char *what, uint64_t bytes);
+
+/**
+ * @brief Start a phase
+ *
+ * @param name Name of the phase
+ */
+void memory_phase_begin(const char *name);
+
+/**
+ * @brief End the current phase and print its memory usage
+ *
+ * @param rss Where to store the resident set size at the end of the phase
+ * @param peak_rss Where to store the peak resident set size
+ */
+void memory_phase_end(uint64_t *rss, uint64_t *peak_rss);
+
+#endif
@@ -0,0 +1,695 @@
+#include "mine.h"
+#include "reduce.h"
+#include "subset.h"
+#include <assert.h>
+#include <limits.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Name of a mode, used to label the results
+ *
+ * @param mode The mode
+ * @return "frequent", "closed" or "maximal"
+ */
+const char *mine_mode_name(MineMode mode) {
+    switch (mode) {
+    case MINE_CLOSED:
+        return "closed";
+    case MINE_MAXIMAL:
+        return "maximal";
+    default:
+        return "frequent";
+    }
+}
+
+/**
+ * @brief Visitor that counts the frequent itemsets
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the uint64_t counter, increased atomically
+ */
+void mine_count_itemset(const int *items, int n_items, int support,
+                        void *data) {
+    uint64_t *count = (uint64_t *)data;
+#pragma omp atomic
+    (*count)++;
+}
+
+/**
+ * @brief Current minimum support count of a mining, which can be raised
+ * concurrently
+ *
+ * @param context The parameters of the mining
+ * @return The minimum support count
+ */
+int mine_min_count(MineContext *context) {
+    int min_count;
+#pragma omp atomic read
+    min_count = context->min_count;
+    return min_count;
+}
+
+/**
+ * @brief Raise the minimum support count of a mining, e.g. from the
+ * visitor. The itemsets with a lower support and their extensions are not
+ * searched anymore.
+ *
+ * @param context The parameters of the mining
+ * @param min_count The new minimum support count, ignored if lower than the
+ * current one
+ */
+void mine_raise_min_count(MineContext *context, int min_count) {
+#pragma omp critical(mine_min_count)
+    if (min_count > context->min_count) {
+#pragma omp atomic write
+        context->min_count = min_count;
+    }
+}
+
+/**
+ * @brief Link the nodes of every item of a flat tree. The nodes are not
+ * copied, so they must outlive the MineTree.
+ *
+ * @param tree The tree to initialize
+ * @param nodes The nodes, the first one is the root
+ * @param num_nodes Number of nodes
+ * @param num_keys Number of items, every node has an id in [0, num_keys)
+ */
+void mine_tree_init(MineTree *tree, const TreeNodeToSend *nodes,
+                    size_t num_nodes, int num_keys) {
+    tree->nodes = nodes;
+    tree->num_nodes = num_nodes;
+    tree->num_keys = num_keys;
+    tree->heads = (int *)malloc((num_keys + 1) * sizeof(int));
+    tree->supports = (int *)calloc(num_keys + 1, sizeof(int));
+    tree->next = (int *)malloc((num_nodes + 1) * sizeof(int));
+    assert(tree->heads != NULL && tree->supports != NULL && tree->next != NULL);
+    memset(tree->heads, -1, num_keys * sizeof(int));
+    tree->items = NULL;
+    tree->starts = NULL;
+    tree->owners = NULL;
+    // backwards, so that the lists are in the order of the nodes
+    size_t i;
+    for (i = num_nodes - 1; i >= 1; i--) {
+        int key = nodes[i].key;
+        assert(key >= 0 && key < num_keys);
+        tree->next[i] = tree->heads[key];
+        tree->heads[key] = i;
+        tree->supports[key] += nodes[i].value;
+    }
+    tree->next[0] = -1;
+}
+
+/**
+ * @brief Build the tree of the compacted records of a tree, see
+ * @see tree_get_chains(), with a node per record, and link the slots of
+ * every item. The records are not needed afterwards.
+ *
+ * @param tree The tree to initialize
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param num_keys Number of items, every item has an id in [0, num_keys)
+ */
+void mine_tree_init_chains(MineTree *tree, const int *chains, uint64_t size,
+                           int num_keys) {
+    size_t num_records = 0, num_slots = 1;
+    uint64_t i;
+    for (i = 0; i < size; i += chains[i + 2] + 3) {
+        num_records++;
+        num_slots += chains[i + 2];
+    }
+    // node ids and slots are int
+    assert(num_slots < INT_MAX);
+    TreeNodeToSend *nodes =
+        (TreeNodeToSend *)malloc((num_records + 1) * sizeof(TreeNodeToSend));
+    tree->items = (int *)malloc(num_slots * sizeof(int));
+    tree->starts = (int *)malloc((num_records + 2) * sizeof(int));
+    tree->owners = (int *)malloc(num_slots * sizeof(int));
+    tree->heads = (int *)malloc((num_keys + 1) * sizeof(int));
+    tree->supports = (int *)calloc(num_keys + 1, sizeof(int));
+    tree->next = (int *)malloc(num_slots * sizeof(int));
+    assert(nodes != NULL && tree->items != NULL && tree->starts != NULL &&
+           tree->owners != NULL && tree->heads != NULL &&
+           tree->supports != NULL && tree->next != NULL);
+    TreeNodeToSend root = {TREE_NODE_NULL, -1, 0};
+    nodes[0] = root;
+    tree->items[0] = TREE_NODE_NULL;
+    tree->owners[0] = 0;
+    tree->starts[0] = 0;
+    int record = 0, slot = 1, j;
+    for (i = 0; i < size; i += chains[i + 2] + 3) {
+        record++;
+        TreeNodeToSend node = {chains[i + 3], chains[i + 1], chains[i]};
+        nodes[record] = node;
+        tree->starts[record] = slot;
+        for (j = 0; j < chains[i + 2]; j++, slot++) {
+            tree->items[slot] = chains[i + 3 + j];
+            tree->owners[slot] = record;
+        }
+    }
+    tree->starts[record + 1] = slot;
+    tree->nodes = nodes;
+    tree->num_nodes = num_records + 1;
+    tree->num_keys = num_keys;
+    memset(tree->heads, -1, num_keys * sizeof(int));
+    // backwards, so that the lists are in the order of the slots
+    for (slot = num_slots - 1; slot >= 1; slot--) {
+        int key = tree->items[slot];
+        assert(key >= 0 && key < num_keys);
+        tree->next[slot] = tree->heads[key];
+        tree->heads[key] = slot;
+        tree->supports[key] += nodes[tree->owners[slot]].value;
+    }
+    tree->next[0] = -1;
+}
+
+/**
+ * @brief Free the lists of a MineTree, but not the nodes unless they are
+ * owned by it
+ *
+ * @param tree The tree
+ */
+void mine_tree_free(MineTree *tree) {
+    if (tree->items != NULL) {
+        free((void *)tree->nodes);
+        tree->nodes = NULL;
+    }
+    free(tree->heads);
+    free(tree->next);
+    free(tree->supports);
+    free(tree->items);
+    free(tree->starts);
+    free(tree->owners);
+    tree->heads = NULL;
+    tree->next = NULL;
+    tree->supports = NULL;
+    tree->items = NULL;
+    tree->starts = NULL;
+    tree->owners = NULL;
+}
+
+/**
+ * @brief Item of a slot of a MineTree
+ *
+ * @param tree The tree
+ * @param slot The slot
+ * @return The id of the item
+ */
+static inline int mine_slot_key(const MineTree *tree, int slot) {
+    return tree->items == NULL ? tree->nodes[slot].key : tree->items[slot];
+}
+
+/**
+ * @brief Value of the node of a slot of a MineTree
+ *
+ * @param tree The tree
+ * @param slot The slot
+ * @return The value
+ */
+static inline int mine_slot_value(const MineTree *tree, int slot) {
+    return tree->items == NULL ? tree->nodes[slot].value
+                               : tree->nodes[tree->owners[slot]].value;
+}
+
+/**
+ * @brief Slot of the item before the item of a slot in its path, i.e. the
+ * previous item of its record or the last one of the parent record
+ *
+ * @param tree The tree
+ * @param slot The slot, not the root
+ * @return The slot, 0 for the root
+ */
+static inline int mine_slot_parent(const MineTree *tree, int slot) {
+    if (tree->items == NULL) {
+        return tree->nodes[slot].parent;
+    }
+    int record = tree->owners[slot];
+    return slot > tree->starts[record]
+               ? slot - 1
+               : tree->starts[tree->nodes[record].parent + 1] - 1;
+}
+
+/**
+ * @brief Build the conditional tree of an item, i.e. the tree of the
+ * prefixes of the paths ending in the nodes of the item, each with the
+ * value of the node. Only the items that are frequent in the prefixes are
+ * kept. The prefix of an item in a record starts with the items before it
+ * in the record.
+ *
+ * @param context The parameters of the mining
+ * @param tree The tree
+ * @param key The item
+ * @param nodes Vector where the nodes of the conditional tree are stored
+ * @param merged If not NULL, the items in all the prefixes are left out of
+ * the conditional tree and appended here
+ * @param cond The conditional tree, built over nodes
+ */
+static void mine_conditional_tree(MineContext *context, MineTree *tree,
+                                  int key,
+                                  cvector_vector_type(TreeNodeToSend) * nodes,
+                                  cvector_vector_type(int) * merged,
+                                  MineTree *cond) {
+    // the same threshold for all the paths, even if it is raised meanwhile
+    int min_count = mine_min_count(context);
+    int *counts = (int *)calloc(key + 1, sizeof(int));
+    assert(counts != NULL);
+    int n, p;
+    for (n = tree->heads[key]; n != -1; n = tree->next[n]) {
+        int weight = mine_slot_value(tree, n);
+        for (p = mine_slot_parent(tree, n); p != 0;
+             p = mine_slot_parent(tree, p)) {
+            counts[mine_slot_key(tree, p)] += weight;
+        }
+    }
+    if (merged != NULL) {
+        for (p = key - 1; p >= 0; p--) {
+            if (counts[p] == tree->supports[key]) {
+                cvector_push_back((*merged), p);
+                counts[p] = 0;
+            }
+        }
+    }
+
+    // the children of a node are a list linked by sibling
+    cvector_vector_type(int) child = NULL;
+    cvector_vector_type(int) sibling = NULL;
+    cvector_vector_type(int) path = NULL;
+    TreeNodeToSend root = {TREE_NODE_NULL, 0, -1};
+    cvector_push_back((*nodes), root);
+    cvector_push_back(child, -1);
+    cvector_push_back(sibling, -1);
+    for (n = tree->heads[key]; n != -1; n = tree->next[n]) {
+        int weight = mine_slot_value(tree, n);
+        cvector_set_size(path, 0);
+        for (p = mine_slot_parent(tree, n); p != 0;
+             p = mine_slot_parent(tree, p)) {
+            if (counts[mine_slot_key(tree, p)] >= min_count) {
+                cvector_push_back(path, mine_slot_key(tree, p));
+            }
+        }
+        // the path has been collected from the leaf
+        int curr = 0, j;
+        for (j = (int)cvector_size(path) - 1; j >= 0; j--) {
+            int next = child[curr];
+            while (next != -1 && (*nodes)[next].key != path[j]) {
+                next = sibling[next];
+            }
+            if (next == -1) {
+                TreeNodeToSend node = {path[j], 0, curr};
+                next = cvector_size((*nodes));
+                cvector_push_back((*nodes), node);
+                cvector_push_back(child, -1);
+                cvector_push_back(sibling, child[curr]);
+                child[curr] = next;
+            }
+            (*nodes)[next].value += weight;
+            curr = next;
+        }
+    }
+    cvector_free(path);
+    cvector_free(sibling);
+    cvector_free(child);
+    free(counts);
+    mine_tree_init(cond, *nodes, cvector_size((*nodes)), key);
+}
+
+/**
+ * @brief Compare two integers, used to sort the item ids
+ */
+static int mine_key_compare(const void *a, const void *b) {
+    int ka = *(const int *)a, kb = *(const int *)b;
+    return (ka > kb) - (ka < kb);
+}
+
+/**
+ * @brief Check an itemset against the candidates of the current item, and
+ * add it to them if no candidate contains it
+ *
+ * @param context The parameters of the mining
+ * @param found The candidates
+ * @param items The ids of the items, in any order, sorted in place
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param add Whether to add the itemset if it is not contained
+ * @return true if a candidate contains the itemset, with the same support
+ * in closed mode
+ */
+static bool mine_candidate(MineContext *context, SubsetIndex *found,
+                           int *items, int n_items, int support, bool add) {
+    qsort(items, n_items, sizeof(int), mine_key_compare);
+    if (subset_index_has_superset(found, items, n_items, support)) {
+        return true;
+    }
+    if (add) {
+        subset_index_add(found, items, n_items, support);
+    }
+    return false;
+}
+
+/**
+ * @brief Whether the nodes of a conditional tree form a single path
+ *
+ * @param tree The conditional tree, built by @see mine_conditional_tree()
+ */
+static bool mine_single_path(MineTree *tree) {
+    size_t i;
+    for (i = 1; i < tree->num_nodes; i++) {
+        if (tree->nodes[i].parent != (int)i - 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void mine_tree(MineContext *context, MineTree *tree,
+                      cvector_vector_type(int) * prefix, SubsetIndex *found);
+
+/**
+ * @brief Report the itemset made of the prefix and the given item, then mine
+ * the conditional tree of the item to find the itemsets that extend it.
+ * Unless all the itemsets are mined, the itemset is checked against the
+ * candidates found and the search is pruned, see
+ * @see mine_frequent_itemsets().
+ *
+ * @param context The parameters of the mining
+ * @param tree The tree
+ * @param key The item, which has to be frequent in the tree
+ * @param prefix The items of the current suffix, from the top level of the
+ * recursion
+ * @param found The closed or maximal candidates of the current top-level
+ * item, NULL if all the itemsets are mined
+ */
+static void mine_item(MineContext *context, MineTree *tree, int key,
+                      cvector_vector_type(int) * prefix, SubsetIndex *found) {
+    int support = tree->supports[key];
+    ItemsetHistogram *histogram =
+        context->mode == MINE_ALL ? context->histogram : NULL;
+    cvector_push_back((*prefix), key);
+    if (histogram != NULL) {
+        histogram_add(histogram, cvector_size((*prefix)), support, 1);
+    } else if (context->mode == MINE_ALL) {
+        context->visit(*prefix, cvector_size((*prefix)), support,
+                       context->data);
+    }
+    cvector_vector_type(TreeNodeToSend) nodes = NULL;
+    cvector_vector_type(int) merged = NULL;
+    MineTree cond = {NULL, 0, 0, NULL, NULL, NULL, NULL, NULL, NULL};
+    if (key > 0) {
+        mine_conditional_tree(context, tree, key, &nodes,
+                              context->mode == MINE_CLOSED ? &merged : NULL,
+                              &cond);
+    }
+    bool extend = cond.num_nodes > 1;
+    size_t n_merged = cvector_size(merged), i;
+    for (i = 0; i < n_merged; i++) {
+        cvector_push_back((*prefix), merged[i]);
+    }
+
+    if (context->mode != MINE_ALL) {
+        // a copy of the itemset, sorted to be checked
+        cvector_vector_type(int) itemset = NULL;
+        size_t n_prefix = cvector_size((*prefix));
+        for (i = 0; i < n_prefix; i++) {
+            cvector_push_back(itemset, (*prefix)[i]);
+        }
+        if (context->mode == MINE_CLOSED) {
+            // a closed superset with the same support contains the closures
+            // of the extensions too
+            extend &= !mine_candidate(context, found, itemset, n_prefix,
+                                      support, true);
+        } else {
+            // the itemset with all its frequent extensions
+            int k, last_support = support;
+            for (k = 0; k < cond.num_keys; k++) {
+                if (cond.supports[k] > 0) {
+                    cvector_push_back(itemset, k);
+                }
+            }
+            bool single = extend && mine_single_path(&cond);
+            if (single) {
+                last_support = cond.nodes[cond.num_nodes - 1].value;
+            }
+            bool leaf = !extend || single;
+            if (mine_candidate(context, found, itemset, cvector_size(itemset),
+                               last_support, leaf) ||
+                leaf) {
+                extend = false;
+            }
+        }
+        cvector_free(itemset);
+    }
+    if (histogram != NULL && extend && mine_single_path(&cond)) {
+        cvector_vector_type(int) supports = NULL;
+        for (i = 1; i < cond.num_nodes; i++) {
+            cvector_push_back(supports, cond.nodes[i].value);
+        }
+        histogram_add_path(histogram, cvector_size((*prefix)), supports,
+                           cvector_size(supports));
+        cvector_free(supports);
+        extend = false;
+    }
+
+    if (extend) {
+        mine_tree(context, &cond, prefix, found);
+    }
+    if (key > 0) {
+        mine_tree_free(&cond);
+    }
+    cvector_free(nodes);
+    cvector_free(merged);
+    cvector_set_size((*prefix), cvector_size((*prefix)) - n_merged - 1);
+}
+
+/**
+ * @brief Find the frequent itemsets of a tree, extending the given prefix
+ *
+ * @param context The parameters of the mining
+ * @param tree The tree
+ * @param prefix The items of the current suffix
+ * @param found The closed or maximal candidates of the current top-level
+ * item, NULL if all the itemsets are mined
+ */
+static void mine_tree(MineContext *context, MineTree *tree,
+                      cvector_vector_type(int) * prefix, SubsetIndex *found) {
+    int key;
+    for (key = tree->num_keys - 1; key >= 0; key--) {
+        if (tree->supports[key] >= mine_min_count(context)) {
+            mine_item(context, tree, key, prefix, found);
+        }
+    }
+}
+
+/**
+ * @brief Gather the closed or maximal candidates of all the processes on
+ * process 0, and visit the ones that no other candidate contains. The
+ * candidates of different top-level items are different, so the ones left
+ * are exactly the closed or maximal itemsets.
+ *
+ * @param context The parameters of the mining
+ * @param candidates The candidates of the current process, every one stored
+ * as its support, its number of items and its sorted item ids
+ * @param num_items Number of items
+ * @param rank Rank of the current process
+ */
+static void mine_filter_candidates(MineContext *context,
+                                   cvector_vector_type(int) candidates,
+                                   int num_items, int rank) {
+    int *all;
+    uint64_t total, i;
+    gather_buffer(candidates, cvector_size(candidates), (void **)&all, &total,
+                  MPI_INT);
+    if (rank != 0) {
+        return;
+    }
+
+    // the largest first, so that the supersets are indexed before
+    cvector_vector_type(size_t) order = NULL;
+    int max_items = 0, n;
+    for (i = 0; i < total; i += all[i + 1] + 2) {
+        max_items = all[i + 1] > max_items ? all[i + 1] : max_items;
+    }
+    for (n = max_items; n > 0; n--) {
+        for (i = 0; i < total; i += all[i + 1] + 2) {
+            if (all[i + 1] == n) {
+                cvector_push_back(order, i);
+            }
+        }
+    }
+    SubsetIndex index;
+    subset_index_init(&index, num_items, context->mode == MINE_CLOSED);
+    cvector_vector_type(int) itemset = NULL;
+    size_t n_candidates = cvector_size(order), c;
+    for (c = 0; c < n_candidates; c++) {
+        int support = all[order[c]], n_items = all[order[c] + 1];
+        int *items = all + order[c] + 2;
+        if (subset_index_has_superset(&index, items, n_items, support)) {
+            continue;
+        }
+        subset_index_add(&index, items, n_items, support);
+        // the visitor takes the ids in decreasing order
+        cvector_set_size(itemset, 0);
+        for (n = n_items - 1; n >= 0; n--) {
+            cvector_push_back(itemset, items[n]);
+        }
+        context->visit(itemset, n_items, support, context->data);
+    }
+    cvector_free(itemset);
+    subset_index_free(&index);
+    cvector_free(order);
+    free(all);
+}
+
+/**
+ * @brief Mine the itemsets whose least frequent item is the given one. The
+ * closed or maximal candidates are appended to the ones of the process.
+ *
+ * @param context The parameters of the mining
+ * @param tree The tree
+ * @param key The item, which has to be frequent in the tree
+ * @param candidates The candidates of the current process, every one stored
+ * as its support, its number of items and its sorted item ids
+ */
+static void mine_top_level_item(MineContext *context, MineTree *tree, int key,
+                                cvector_vector_type(int) * candidates) {
+    cvector_vector_type(int) prefix = NULL;
+    if (context->mode == MINE_ALL) {
+        mine_item(context, tree, key, &prefix, NULL);
+    } else {
+        // the itemsets of an item contain no more infrequent items
+        SubsetIndex found;
+        subset_index_init(&found, key + 1, context->mode == MINE_CLOSED);
+        mine_item(context, tree, key, &prefix, &found);
+        int n_found = subset_index_length(&found), f;
+#pragma omp critical
+        for (f = 0; f < n_found; f++) {
+            size_t start = found.starts[f], end = found.starts[f + 1], j;
+            cvector_push_back((*candidates), found.supports[f]);
+            cvector_push_back((*candidates), (int)(end - start));
+            for (j = start; j < end; j++) {
+                cvector_push_back((*candidates), found.items[j]);
+            }
+        }
+        subset_index_free(&found);
+    }
+    cvector_free(prefix);
+}
+
+/**
+ * @brief Find the frequent itemsets of a MineTree, then free it. See
+ * @see mine_frequent_itemsets()
+ *
+ * @param context The parameters of the mining
+ * @param tree The tree
+ * @param num_items Number of items, every item has an id in [0, num_items)
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the tree
+ * @param num_threads Number of threads of every process
+ */
+static void mine_tree_itemsets(MineContext *context, MineTree *tree,
+                               int num_items, int rank, int world_size,
+                               int num_threads) {
+    cvector_vector_type(int) candidates = NULL;
+    int i, first, batch = num_items;
+    if (context->share_min_count || context->end_round != NULL) {
+        batch = MINE_SHARE_INTERVAL * world_size * num_threads;
+    }
+    for (first = 0; first < num_items; first += batch) {
+        int last = first + batch < num_items ? first + batch : num_items;
+        // the least frequent items have the deepest nodes and the largest
+        // conditional trees, they are handed out first, unless min_count is
+        // raised: the itemsets of the most frequent ones raise it sooner
+#pragma omp parallel for default(none)                                         \
+    shared(context, tree, rank, world_size, num_items, candidates, first,      \
+               last) schedule(dynamic, 1) num_threads(num_threads)
+        for (i = first; i < last; i++) {
+            int key = context->share_min_count ? i : num_items - 1 - i;
+            if (key % world_size == rank &&
+                tree->supports[key] >= mine_min_count(context)) {
+                mine_top_level_item(context, tree, key, &candidates);
+            }
+        }
+        if (context->share_min_count) {
+            int min_count = context->min_count;
+            MPI_Allreduce(MPI_IN_PLACE, &min_count, 1, MPI_INT, MPI_MAX,
+                          MPI_COMM_WORLD);
+            context->min_count = min_count;
+        }
+        if (context->end_round != NULL) {
+            context->end_round(context->data);
+        }
+    }
+    mine_tree_free(tree);
+    if (context->mode != MINE_ALL) {
+        mine_filter_candidates(context, candidates, num_items, rank);
+    }
+    cvector_free(candidates);
+}
+
+/**
+ * @brief Find the frequent itemsets of a tree with FP-growth.
+ *
+ * The items are the suffixes of the itemsets at the top level of the
+ * recursion. They are split cyclically among the processes, and the
+ * items of a process are mined in parallel by num_threads threads, each
+ * building its own conditional trees. Every process has to call this with
+ * the same tree. The visitor is called on the itemsets found by the current
+ * process only.
+ * With share_min_count or an end_round callback, the items are mined in
+ * rounds of MINE_SHARE_INTERVAL items per thread of every process, and the
+ * processes synchronize at the end of every round.
+ *
+ * The closed and maximal itemsets are searched as in FPClose and FPMax. In
+ * closed mode, the items in every transaction of a prefix are merged into
+ * it, and a prefix contained in a closed candidate with the same support is
+ * pruned with its extensions; in maximal mode, only the itemsets without
+ * frequent extensions are candidates, a prefix is pruned when it is
+ * contained in a candidate together with all the frequent items of its
+ * conditional tree, and a conditional tree made of a single path gives a
+ * single candidate. The candidates of the items of every process are checked
+ * against each other with a SubsetIndex, then gathered on process 0, which
+ * checks them again against the ones of the other items and visits the
+ * itemsets left.
+ *
+ * @param context The parameters of the mining
+ * @param nodes The nodes of the tree, the first one is the root
+ * @param num_nodes Number of nodes
+ * @param num_items Number of items, every node has an id in [0, num_items)
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the tree
+ * @param num_threads Number of threads of every process
+ */
+void mine_frequent_itemsets(MineContext *context, const TreeNodeToSend *nodes,
+                            size_t num_nodes, int num_items, int rank,
+                            int world_size, int num_threads) {
+    MineTree tree;
+    mine_tree_init(&tree, nodes, num_nodes, num_items);
+    mine_tree_itemsets(context, &tree, num_items, rank, world_size,
+                       num_threads);
+}
+
+/**
+ * @brief Find the frequent itemsets of a tree of compacted records, see
+ * @see tree_get_chains(), with FP-growth, without expanding the records
+ * into a node per item. See @see mine_frequent_itemsets()
+ *
+ * @param context The parameters of the mining
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param num_items Number of items, every item has an id in [0, num_items)
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the tree
+ * @param num_threads Number of threads of every process
+ */
+void mine_frequent_itemsets_chains(MineContext *context, const int *chains,
+                                   uint64_t size, int num_items, int rank,
+                                   int world_size, int num_threads) {
+    MineTree tree;
+    mine_tree_init_chains(&tree, chains, size, num_items);
+    mine_tree_itemsets(context, &tree, num_items, rank, world_size,
+                       num_threads);
+}
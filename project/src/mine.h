@@ -0,0 +1,294 @@
+/**
+ * @file mine.h
+ * @brief Mining of the frequent itemsets of an FP-Tree with FP-growth
+ *
+ */
+#ifndef MINE_H
+#define MINE_H
+
+#include "histogram.h"
+#include "tree.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Number of top-level items mined by every thread of every process
+ * in a round, when the mining is split in rounds
+ */
+#define MINE_SHARE_INTERVAL 4
+
+/**
+ * @brief Function called on every frequent itemset found. It is called
+ * concurrently by the threads of the miner.
+ *
+ * @param items The ids of the items of the itemset, in decreasing order
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data The data of the MineContext
+ */
+typedef void (*MineVisitor)(const int *items, int n_items, int support,
+                            void *data);
+
+/**
+ * @brief Function called by every process at the end of every round of
+ * top-level items, outside of the parallel region, see MineContext
+ *
+ * @param data The data of the MineContext
+ */
+typedef void (*MineRoundEnd)(void *data);
+
+/**
+ * @brief Algorithm used to mine the frequent itemsets
+ */
+typedef enum MineEngine {
+    /**
+     * @brief FP-growth on the global tree, see mine.h
+     */
+    MINE_ENGINE_FPGROWTH,
+    /**
+     * @brief Eclat on vertical bitsets of the transactions, see eclat.h
+     */
+    MINE_ENGINE_ECLAT,
+    /**
+     * @brief The cheapest engine according to the statistics of the
+     * transactions, see plan.h
+     */
+    MINE_ENGINE_AUTO
+} MineEngine;
+
+/**
+ * @brief Which frequent itemsets are reported
+ */
+typedef enum MineMode {
+    /**
+     * @brief All the frequent itemsets
+     */
+    MINE_ALL,
+    /**
+     * @brief The frequent itemsets without a superset with the same support
+     */
+    MINE_CLOSED,
+    /**
+     * @brief The frequent itemsets without a frequent superset
+     */
+    MINE_MAXIMAL
+} MineMode;
+
+/**
+ * @brief Parameters of the mining
+ */
+typedef struct MineContext {
+    /**
+     * @brief Minimum support count of a frequent itemset
+     */
+    int min_count;
+    /**
+     * @brief Function called on every frequent itemset
+     */
+    MineVisitor visit;
+    /**
+     * @brief Data passed to visit
+     */
+    void *data;
+    /**
+     * @brief Which frequent itemsets are reported, all of them by default
+     */
+    MineMode mode;
+    /**
+     * @brief Whether the visitor raises min_count while mining, with
+     * @see mine_raise_min_count(). The processes then mine the top-level
+     * items in rounds, the most frequent first, and take the highest
+     * min_count of all of them after every round.
+     */
+    bool share_min_count;
+    /**
+     * @brief If not NULL, the processes mine the top-level items in rounds
+     * and call it at the end of every round, e.g. to write the itemsets
+     * found collectively
+     */
+    MineRoundEnd end_round;
+    /**
+     * @brief If not NULL and all the itemsets are mined, FP-growth counts
+     * the itemsets into it instead of visiting them, and counts the ones of
+     * a conditional tree made of a single path arithmetically, see
+     * @see histogram_add_path()
+     */
+    ItemsetHistogram *histogram;
+} MineContext;
+
+/**
+ * @brief Current minimum support count of a mining, which can be raised
+ * concurrently
+ *
+ * @param context The parameters of the mining
+ * @return The minimum support count
+ */
+int mine_min_count(MineContext *context);
+
+/**
+ * @brief Raise the minimum support count of a mining, e.g. from the
+ * visitor. The itemsets with a lower support and their extensions are not
+ * searched anymore.
+ *
+ * @param context The parameters of the mining
+ * @param min_count The new minimum support count, ignored if lower than the
+ * current one
+ */
+void mine_raise_min_count(MineContext *context, int min_count);
+
+/**
+ * @brief Name of a mode, used to label the results
+ *
+ * @param mode The mode
+ * @return "frequent", "closed" or "maximal"
+ */
+const char *mine_mode_name(MineMode mode);
+
+/**
+ * @brief Visitor that counts the frequent itemsets
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the uint64_t counter, increased atomically
+ */
+void mine_count_itemset(const int *items, int n_items, int support,
+                        void *data);
+
+/**
+ * @brief FP-Tree stored as a flat array of nodes, linked by parent, together
+ * with the list of the nodes of every item.
+ *
+ * The nodes of a tree of compacted records, see @see tree_get_chains(), are
+ * the records, whose items are stored apart: the lists are then of the
+ * slots of the items, every slot being a position in items. In a tree with
+ * a node per item, the slot of an item is its node.
+ */
+typedef struct MineTree {
+    /**
+     * @brief The nodes, the first one is the root
+     */
+    const TreeNodeToSend *nodes;
+    size_t num_nodes;
+    /**
+     * @brief The ids of the items are in [0, num_keys)
+     */
+    int num_keys;
+    /**
+     * @brief First slot of every item, -1 if none
+     */
+    int *heads;
+    /**
+     * @brief Next slot with the same item of every slot, -1 if none
+     */
+    int *next;
+    /**
+     * @brief Support count of every item, i.e. the sum of the values of its
+     * nodes
+     */
+    int *supports;
+    /**
+     * @brief The items of the records, the slot 0 being the root, or NULL if
+     * every node has a single item. The nodes are owned by the MineTree
+     * when the items are not NULL
+     */
+    int *items;
+    /**
+     * @brief First slot of every record, and the end of the last one
+     */
+    int *starts;
+    /**
+     * @brief Record of every slot
+     */
+    int *owners;
+} MineTree;
+
+/**
+ * @brief Link the nodes of every item of a flat tree. The nodes are not
+ * copied, so they must outlive the MineTree.
+ *
+ * @param tree The tree to initialize
+ * @param nodes The nodes, the first one is the root
+ * @param num_nodes Number of nodes
+ * @param num_keys Number of items, every node has an id in [0, num_keys)
+ */
+void mine_tree_init(MineTree *tree, const TreeNodeToSend *nodes,
+                    size_t num_nodes, int num_keys);
+
+/**
+ * @brief Build the tree of the compacted records of a tree, see
+ * @see tree_get_chains(), with a node per record, and link the slots of
+ * every item. The records are not needed afterwards.
+ *
+ * @param tree The tree to initialize
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param num_keys Number of items, every item has an id in [0, num_keys)
+ */
+void mine_tree_init_chains(MineTree *tree, const int *chains, uint64_t size,
+                           int num_keys);
+
+/**
+ * @brief Free the lists of a MineTree, but not the nodes unless they are
+ * owned by it
+ *
+ * @param tree The tree
+ */
+void mine_tree_free(MineTree *tree);
+
+/**
+ * @brief Find the frequent itemsets of a tree with FP-growth.
+ *
+ * The items are the suffixes of the itemsets at the top level of the
+ * recursion. They are split cyclically among the processes, and the
+ * items of a process are mined in parallel by num_threads threads, each
+ * building its own conditional trees. Every process has to call this with
+ * the same tree. The visitor is called on the itemsets found by the current
+ * process only.
+ * With share_min_count or an end_round callback, the items are mined in
+ * rounds of MINE_SHARE_INTERVAL items per thread of every process, and the
+ * processes synchronize at the end of every round.
+ *
+ * The closed and maximal itemsets are searched as in FPClose and FPMax. In
+ * closed mode, the items in every transaction of a prefix are merged into
+ * it, and a prefix contained in a closed candidate with the same support is
+ * pruned with its extensions; in maximal mode, only the itemsets without
+ * frequent extensions are candidates, a prefix is pruned when it is
+ * contained in a candidate together with all the frequent items of its
+ * conditional tree, and a conditional tree made of a single path gives a
+ * single candidate. The candidates of the items of every process are checked
+ * against each other with a SubsetIndex, then gathered on process 0, which
+ * checks them again against the ones of the other items and visits the
+ * itemsets left.
+ *
+ * @param context The parameters of the mining
+ * @param nodes The nodes of the tree, the first one is the root
+ * @param num_nodes Number of nodes
+ * @param num_items Number of items, every node has an id in [0, num_items)
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the tree
+ * @param num_threads Number of threads of every process
+ */
+void mine_frequent_itemsets(MineContext *context, const TreeNodeToSend *nodes,
+                            size_t num_nodes, int num_items, int rank,
+                            int world_size, int num_threads);
+
+/**
+ * @brief Find the frequent itemsets of a tree of compacted records, see
+ * @see tree_get_chains(), with FP-growth, without expanding the records
+ * into a node per item. See @see mine_frequent_itemsets()
+ *
+ * @param context The parameters of the mining
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param num_items Number of items, every item has an id in [0, num_items)
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the tree
+ * @param num_threads Number of threads of every process
+ */
+void mine_frequent_itemsets_chains(MineContext *context, const int *chains,
+                                   uint64_t size, int num_items, int rank,
+                                   int world_size, int num_threads);
+
+#endif
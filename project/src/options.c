@@ -0,0 +1,340 @@
+#include "options.h"
+#include "rules.h"
+#include "update.h"
+#include <getopt.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Print the usage of the program on process 0
+ *
+ * @param rank Rank of the current process
+ * @param program Name of the executable
+ */
+void options_usage(int rank, char *program) {
+    if (rank == 0) {
+        fprintf(stderr,
+                "Usage: %s filename [numthreads] [min_support] [debug] "
+                "[options]\n"
+                "Options:\n"
+                "  --dedup    collapse identical transactions before building "
+                "the tree\n"
+                "  --grain N  insert at most N transactions per tree building "
+                "task\n"
+                "  --trace FILE  write a Chrome trace of the phases to FILE\n"
+                "  --perf     collect the hardware counters of every phase\n"
+                "  --mem      print the memory usage of the data structures "
+                "and of every phase\n"
+                "  --oracle   check the results against a serial brute-force "
+                "computation\n"
+                "  --mine     mine the frequent itemsets of the global tree\n"
+                "  --save-tree FILE  write the global tree to FILE; passing "
+                "FILE as filename\n"
+                "             mines it again with the given min_support, "
+                "without rebuilding it\n"
+                "  --update FILE  add the transactions of filename to the "
+                "tree saved in FILE\n"
+                "  --max-drift D  rebuild the updated tree when more than a "
+                "fraction D of the\n"
+                "             pairs of items are out of order (0.1), "
+                "otherwise move only\n"
+                "             the subtrees out of order\n"
+                "  --window W mine the last W transactions of filename, "
+                "\"-\" for the standard\n"
+                "             input, after every pane of transactions\n"
+                "  --pane N   insert and remove N transactions at a time "
+                "(W/10)\n"
+                "  --follow   wait for new transactions at the end of "
+                "filename\n"
+                "  --engine E mine with fpgrowth, eclat or auto, which "
+                "picks the cheapest\n"
+                "             from the statistics of the transactions "
+                "(fpgrowth)\n"
+                "  --auto     choose the deduplication and the engine from "
+                "the statistics of\n"
+                "             the transactions, logging the choices\n"
+                "  --closed   mine only the closed itemsets, implies --mine\n"
+                "  --maximal  mine only the maximal itemsets, implies "
+                "--mine\n"
+                "  --top-k K  mine the K itemsets with the highest support "
+                "and print them,\n"
+                "             implies --mine\n"
+                "  --rules FILE  write the association rules of the frequent "
+                "itemsets to FILE,\n"
+                "             implies --mine\n"
+                "  --min-confidence C  minimum confidence of a rule (0.5)\n"
+                "  --output FILE  write the frequent itemsets to FILE, implies "
+                "--mine\n"
+                "  --binary   write the itemsets and the rules in binary "
+                "format\n"
+                "  --count    only count the frequent itemsets of every "
+                "length, implies --mine\n"
+                "  --histogram  count the frequent itemsets by support too, "
+                "implies --count\n"
+                "  --compact  store the chains of single children of the "
+                "trees in a node,\n"
+                "             and send and mine them as such\n"
+                "  --sketch W  send only the items whose support estimated "
+                "by a Count-Min\n"
+                "             sketch of width W reaches the minimum support\n"
+                "  --sample F  estimate the supports from a fraction F of the "
+                "file and exit\n"
+                "  --target-items K  estimate the minimum support with K "
+                "frequent items\n"
+                "  --target-itemsets K  estimate the minimum support with K "
+                "frequent itemsets\n"
+                "  --auto-support  mine the file with the estimated minimum "
+                "support instead\n"
+                "             of exiting\n",
+                program);
+    }
+}
+
+/**
+ * @brief Parse the command line.
+ *
+ * The positional arguments are filename [numthreads] [min_support] [debug],
+ * the optional flags can be placed anywhere. On invalid arguments the usage
+ * is printed and the program terminates.
+ *
+ * @param argc Number of arguments
+ * @param argv The arguments
+ * @param rank Rank of the current process
+ * @param options Where to store the parsed options
+ */
+void options_parse(int argc, char **argv, int rank, Options *options) {
+    static struct option long_options[] = {
+        {"dedup", no_argument, NULL, 'd'},
+        {"grain", required_argument, NULL, 'g'},
+        {"trace", required_argument, NULL, 't'},
+        {"perf", no_argument, NULL, 'p'},
+        {"mem", no_argument, NULL, 'm'},
+        {"oracle", no_argument, NULL, 'o'},
+        {"mine", no_argument, NULL, 'n'},
+        {"save-tree", required_argument, NULL, 's'},
+        {"update", required_argument, NULL, 'u'},
+        {"max-drift", required_argument, NULL, 'r'},
+        {"window", required_argument, NULL, 'w'},
+        {"pane", required_argument, NULL, 'a'},
+        {"follow", no_argument, NULL, 'f'},
+        {"engine", required_argument, NULL, 'e'},
+        {"auto", no_argument, NULL, 'A'},
+        {"closed", no_argument, NULL, 'c'},
+        {"maximal", no_argument, NULL, 'x'},
+        {"top-k", required_argument, NULL, 'k'},
+        {"rules", required_argument, NULL, 'R'},
+        {"min-confidence", required_argument, NULL, 'C'},
+        {"output", required_argument, NULL, 'O'},
+        {"binary", no_argument, NULL, 'B'},
+        {"count", no_argument, NULL, 'N'},
+        {"histogram", no_argument, NULL, 'H'},
+        {"compact", no_argument, NULL, 'P'},
+        {"sketch", required_argument, NULL, 'S'},
+        {"sample", required_argument, NULL, 'F'},
+        {"target-items", required_argument, NULL, 'I'},
+        {"target-itemsets", required_argument, NULL, 'T'},
+        {"auto-support", no_argument, NULL, 'U'},
+        {NULL, 0, NULL, 0}};
+
+    options->filename = NULL;
+    options->num_threads = 1;
+    options->min_support = 0;
+    options->debug = false;
+    options->dedup = false;
+    options->grain = 0;
+    options->trace_file = NULL;
+    options->perf = false;
+    options->memory = false;
+    options->oracle = false;
+    options->mine = false;
+    options->save_tree = NULL;
+    options->update = NULL;
+    options->max_drift = UPDATE_MAX_DRIFT;
+    options->window = 0;
+    options->pane = 0;
+    options->follow = false;
+    options->engine = MINE_ENGINE_FPGROWTH;
+    options->plan = false;
+    options->mode = MINE_ALL;
+    options->top_k = 0;
+    options->rules = NULL;
+    options->min_confidence = RULES_MIN_CONFIDENCE;
+    options->output = NULL;
+    options->format = OUTPUT_TEXT;
+    options->count = false;
+    options->histogram = false;
+    options->compact = false;
+    options->sketch_width = 0;
+    options->sample = 0;
+    options->target_items = 0;
+    options->target_itemsets = 0;
+    options->auto_support = false;
+    bool engine_given = false;
+
+    opterr = rank == 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'd':
+            options->dedup = true;
+            break;
+        case 'g':
+            options->grain = atoi(optarg);
+            break;
+        case 't':
+            options->trace_file = optarg;
+            break;
+        case 'p':
+            options->perf = true;
+            break;
+        case 'm':
+            options->memory = true;
+            break;
+        case 'o':
+            options->oracle = true;
+            break;
+        case 'n':
+            options->mine = true;
+            break;
+        case 's':
+            options->save_tree = optarg;
+            break;
+        case 'u':
+            options->update = optarg;
+            break;
+        case 'r':
+            options->max_drift = atof(optarg);
+            break;
+        case 'w':
+            options->window = strtoull(optarg, NULL, 10);
+            break;
+        case 'a':
+            options->pane = strtoull(optarg, NULL, 10);
+            break;
+        case 'f':
+            options->follow = true;
+            break;
+        case 'e':
+            if (strcmp(optarg, "fpgrowth") == 0) {
+                options->engine = MINE_ENGINE_FPGROWTH;
+            } else if (strcmp(optarg, "eclat") == 0) {
+                options->engine = MINE_ENGINE_ECLAT;
+            } else if (strcmp(optarg, "auto") == 0) {
+                options->engine = MINE_ENGINE_AUTO;
+            } else {
+                options_usage(rank, argv[0]);
+                MPI_Finalize();
+                exit(1);
+            }
+            engine_given = true;
+            break;
+        case 'A':
+            options->plan = true;
+            break;
+        case 'c':
+            options->mode = MINE_CLOSED;
+            options->mine = true;
+            break;
+        case 'x':
+            options->mode = MINE_MAXIMAL;
+            options->mine = true;
+            break;
+        case 'k':
+            options->top_k = atoi(optarg);
+            options->mine = true;
+            break;
+        case 'R':
+            options->rules = optarg;
+            options->mine = true;
+            break;
+        case 'C':
+            options->min_confidence = atof(optarg);
+            break;
+        case 'O':
+            options->output = optarg;
+            options->mine = true;
+            break;
+        case 'B':
+            options->format = OUTPUT_BINARY;
+            break;
+        case 'H':
+            options->histogram = true;
+            // fall through
+        case 'N':
+            options->count = true;
+            options->mine = true;
+            break;
+        case 'P':
+            options->compact = true;
+            break;
+        case 'S':
+            options->sketch_width = atoi(optarg);
+            break;
+        case 'F':
+            options->sample = atof(optarg);
+            break;
+        case 'I':
+            options->target_items = atoi(optarg);
+            break;
+        case 'T':
+            options->target_itemsets = atoi(optarg);
+            break;
+        case 'U':
+            options->auto_support = true;
+            break;
+        default:
+            options_usage(rank, argv[0]);
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+
+    if (options->plan && !engine_given)
+        options->engine = MINE_ENGINE_AUTO;
+
+    // the top-k itemsets and the rules come from all the itemsets of a file,
+    // the rules need the support of every subset; the top-k itemsets are
+    // printed, and the windows are not written; the counts replace the
+    // itemsets; the supports of all the items are saved with the tree, not
+    // only the ones that pass the sketch; the minimum support is estimated
+    // from a sample of a text file, for a target
+    if (options->top_k < 0 || options->sketch_width < 0 ||
+        options->sample < 0 || options->sample > 1 ||
+        options->target_items < 0 || options->target_itemsets < 0 ||
+        ((options->target_items > 0 || options->target_itemsets > 0) &&
+         options->sample == 0) ||
+        (options->auto_support && options->target_items == 0 &&
+         options->target_itemsets == 0) ||
+        (options->sample > 0 &&
+         (options->window > 0 || options->update != NULL)) ||
+        ((options->top_k > 0 || options->rules != NULL) &&
+         (options->mode != MINE_ALL || options->window > 0)) ||
+        (options->top_k > 0 && options->rules != NULL) ||
+        (options->output != NULL &&
+         (options->top_k > 0 || options->window > 0)) ||
+        (options->count &&
+         (options->top_k > 0 || options->rules != NULL ||
+          options->output != NULL || options->window > 0)) ||
+        (options->sketch_width > 0 && options->save_tree != NULL)) {
+        options_usage(rank, argv[0]);
+        MPI_Finalize();
+        exit(1);
+    }
+
+    // positional arguments, moved at the end by getopt
+    int n_positional = argc - optind;
+    if (n_positional < 1) {
+        options_usage(rank, argv[0]);
+        MPI_Finalize();
+        exit(1);
+    }
+    options->filename = argv[optind];
+    if (n_positional > 1)
+        options->num_threads = atoi(argv[optind + 1]);
+    if (n_positional > 2)
+        options->min_support = atof(argv[optind + 2]);
+    if (n_positional > 3)
+        options->debug = atoi(argv[optind + 3]);
+}
@@ -0,0 +1,197 @@
+/**
+ * @file options.h
+ * @brief Command line options of the program
+ *
+ */
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "mine.h"
+#include "output.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Options of a run of the program
+ */
+typedef struct Options {
+    /**
+     * @brief Name of the file with the transactions
+     */
+    char *filename;
+    /**
+     * @brief Number of OpenMP threads of every process
+     */
+    int num_threads;
+    /**
+     * @brief Minimum support of a frequent item, as a fraction of the
+     * number of transactions
+     */
+    double min_support;
+    /**
+     * @brief Whether to print the timing log
+     */
+    bool debug;
+    /**
+     * @brief Whether to collapse identical transactions before building
+     * the tree
+     */
+    bool dedup;
+    /**
+     * @brief Maximum number of transactions inserted into the tree by a
+     * single task, 0 to choose it from the number of threads
+     */
+    int grain;
+    /**
+     * @brief Name of the file where to write the Chrome trace of the run,
+     * NULL to disable the recording of the trace
+     */
+    char *trace_file;
+    /**
+     * @brief Whether to collect the hardware counters of every phase
+     */
+    bool perf;
+    /**
+     * @brief Whether to print the memory usage of the data structures and
+     * of every phase
+     */
+    bool memory;
+    /**
+     * @brief Whether to check the results against a serial brute-force
+     * computation, see oracle.h
+     */
+    bool oracle;
+    /**
+     * @brief Whether to mine the frequent itemsets of the global tree. A
+     * tree loaded from a snapshot is always mined.
+     */
+    bool mine;
+    /**
+     * @brief Name of the file where to write the snapshot of the global
+     * tree, NULL to not write it
+     */
+    char *save_tree;
+    /**
+     * @brief Name of the snapshot to update with the transactions of
+     * filename, NULL to build the tree from scratch
+     */
+    char *update;
+    /**
+     * @brief Maximum fraction of pairs of items out of order in an updated
+     * tree, above which the tree is rebuilt
+     */
+    double max_drift;
+    /**
+     * @brief Number of transactions of the sliding window over the stream
+     * of transactions of filename, 0 to read the whole file at once
+     */
+    uint64_t window;
+    /**
+     * @brief Number of transactions of a pane of the window, 0 to use
+     * STREAM_PANES panes
+     */
+    uint64_t pane;
+    /**
+     * @brief Whether to wait for new transactions at the end of the stream
+     */
+    bool follow;
+    /**
+     * @brief Algorithm used to mine the frequent itemsets
+     */
+    MineEngine engine;
+    /**
+     * @brief Whether to choose the deduplication and the mining engine from
+     * the statistics of the transactions, see plan.h. The choices given
+     * explicitly are kept.
+     */
+    bool plan;
+    /**
+     * @brief Which frequent itemsets are mined
+     */
+    MineMode mode;
+    /**
+     * @brief Number of most frequent itemsets to mine, with min_support as
+     * a lower bound of their support, 0 to mine all the frequent itemsets
+     */
+    int top_k;
+    /**
+     * @brief Name of the file where to write the association rules of the
+     * frequent itemsets, NULL to not generate them
+     */
+    char *rules;
+    /**
+     * @brief Minimum confidence of an association rule
+     */
+    double min_confidence;
+    /**
+     * @brief Name of the file where to write the frequent itemsets, NULL to
+     * not write them
+     */
+    char *output;
+    /**
+     * @brief Format of the itemsets and of the rules written to a file
+     */
+    OutputFormat format;
+    /**
+     * @brief Whether to only count the frequent itemsets, by length
+     */
+    bool count;
+    /**
+     * @brief Whether to count the frequent itemsets by support too
+     */
+    bool histogram;
+    /**
+     * @brief Whether the FP-trees store the chains of single children with
+     * the same count in a node, and are sent and mined as chains
+     */
+    bool compact;
+    /**
+     * @brief Number of counters of every row of the Count-Min sketch that
+     * filters the items before their supports are exchanged, 0 to not use it
+     */
+    int sketch_width;
+    /**
+     * @brief Fraction of the file sampled to estimate the supports, 0 to not
+     * sample it
+     */
+    double sample;
+    /**
+     * @brief Number of frequent items for which the minimum support is
+     * estimated, 0 if none
+     */
+    int target_items;
+    /**
+     * @brief Number of frequent itemsets for which the minimum support is
+     * estimated, 0 if none
+     */
+    int target_itemsets;
+    /**
+     * @brief Whether to mine the file with the estimated minimum support,
+     * instead of exiting after the estimate
+     */
+    bool auto_support;
+} Options;
+
+/**
+ * @brief Print the usage of the program on process 0
+ *
+ * @param rank Rank of the current process
+ * @param program Name of the executable
+ */
+void options_usage(int rank, char *program);
+
+/**
+ * @brief Parse the command line.
+ *
+ * The positional arguments are filename [numthreads] [min_support] [debug],
+ * the optional flags can be placed anywhere. On invalid arguments the usage
+ * is printed and the program terminates.
+ *
+ * @param argc Number of arguments
+ * @param argv The arguments
+ * @param rank Rank of the current process
+ * @param options Where to store the parsed options
+ */
+void options_parse(int argc, char **argv, int rank, Options *options);
+
+#endif
@@ -0,0 +1,452 @@
+#include "oracle.h"
+#include "io.h"
+#include "itemset_map.h"
+#include "sort.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Data of the visit that counts the supports of the items
+ */
+typedef struct OracleSupports {
+    SupportMap support_map;
+} OracleSupports;
+
+/**
+ * @brief Data of the visit that counts the prefixes of the transactions
+ */
+typedef struct OraclePrefixes {
+    IndexMap index_map;
+    ItemsetMap *prefixes;
+    cvector_vector_type(int) keys;
+} OraclePrefixes;
+
+/**
+ * @brief Compare two integers, used to sort the item ids
+ */
+static int oracle_key_compare(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+/**
+ * @brief Call visit on the transactions of a text file, one per line with
+ * the items separated by spaces, as parsed by @see transaction_parse()
+ *
+ * @param in The file
+ * @param visit Function called on every transaction
+ * @param data Data passed to visit
+ * @return The number of transactions read
+ */
+static uint64_t oracle_scan_text(FILE *in, OracleVisitor visit, void *data) {
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    uint64_t n_transactions = 0;
+    cvector_vector_type(char *) items = NULL;
+    while ((length = getline(&line, &capacity, in)) != -1) {
+        if (length > 0 && line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+        // empty lines are skipped, lines with only spaces are empty
+        // transactions
+        if (length == 0) {
+            continue;
+        }
+        cvector_set_size(items, 0);
+        char *item = strtok(line, " ");
+        while (item != NULL) {
+            cvector_push_back(items, item);
+            item = strtok(NULL, " ");
+        }
+        visit(items, cvector_size(items), data);
+        n_transactions++;
+    }
+    cvector_free(items);
+    free(line);
+    return n_transactions;
+}
+
+/**
+ * @brief Call visit on the transactions of a file in binary format, see
+ * BinaryHeader
+ *
+ * @param in The file
+ * @param header The header of the file
+ * @param visit Function called on every transaction
+ * @param data Data passed to visit
+ * @return The number of transactions read
+ */
+static uint64_t oracle_scan_binary(FILE *in, BinaryHeader *header,
+                                   OracleVisitor visit, void *data) {
+    assert(header->version == BINARY_VERSION);
+    BinaryBlock *blocks =
+        (BinaryBlock *)malloc(header->num_blocks * sizeof(BinaryBlock));
+    assert(blocks != NULL || header->num_blocks == 0);
+    fseek(in, header->index_offset, SEEK_SET);
+    size_t n_read = fread(blocks, sizeof(BinaryBlock), header->num_blocks, in);
+    assert(n_read == header->num_blocks);
+
+    uint64_t n_transactions = 0, b;
+    cvector_vector_type(char *) items = NULL;
+    char *names = NULL;
+    for (b = 0; b < header->num_blocks; b++) {
+        uint32_t *ids = (uint32_t *)malloc(blocks[b].bytes);
+        assert(ids != NULL || blocks[b].bytes == 0);
+        fseek(in, blocks[b].offset, SEEK_SET);
+        n_read = fread(ids, 1, blocks[b].bytes, in);
+        assert(n_read == blocks[b].bytes);
+        uint64_t pos = 0, t;
+        for (t = 0; t < blocks[b].num_transactions; t++) {
+            uint32_t n_items = ids[pos++], j;
+            assert((pos + n_items) * sizeof(uint32_t) <= blocks[b].bytes);
+            // the names are stored in a single buffer, 16 bytes each
+            names = (char *)realloc(names, (n_items + 1) * 16);
+            assert(names != NULL);
+            cvector_set_size(items, 0);
+            for (j = 0; j < n_items; j++) {
+                snprintf(names + 16 * j, 16, "i%u", ids[pos++]);
+                cvector_push_back(items, names + 16 * j);
+            }
+            visit(items, n_items, data);
+            n_transactions++;
+        }
+        free(ids);
+    }
+    free(names);
+    cvector_free(items);
+    free(blocks);
+    return n_transactions;
+}
+
+/**
+ * @brief Read serially the whole file of transactions, calling visit on
+ * every transaction. Both the text and the binary formats are supported.
+ *
+ * The file is read with the standard library, independently of the
+ * functions used by the pipeline, so that a bug in the parallel reading is
+ * detected as well.
+ *
+ * @param filename Name of the file
+ * @param visit Function called on every transaction
+ * @param data Data passed to visit
+ * @return The number of transactions read
+ */
+uint64_t oracle_scan(char *filename, OracleVisitor visit, void *data) {
+    FILE *in = fopen(filename, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "oracle: cannot open %s\n", filename);
+        exit(1);
+    }
+    BinaryHeader header;
+    uint64_t n_transactions;
+    if (fread(&header, sizeof(BinaryHeader), 1, in) == 1 &&
+        memcmp(header.magic, BINARY_MAGIC, 4) == 0) {
+        n_transactions = oracle_scan_binary(in, &header, visit, data);
+    } else {
+        rewind(in);
+        n_transactions = oracle_scan_text(in, visit, data);
+    }
+    fclose(in);
+    return n_transactions;
+}
+
+/**
+ * @brief Count the occurrences of the items of a transaction
+ */
+static void oracle_count_supports(char **items, int n_items, void *data) {
+    OracleSupports *supports = (OracleSupports *)data;
+    int i;
+    for (i = 0; i < n_items; i++) {
+        int result = hashmap_increment(supports->support_map, items[i],
+                                       strlen(items[i]) + 1, 1);
+        assert(result == MAP_OK);
+    }
+}
+
+/**
+ * @brief Count every prefix of the sorted ids of the frequent items of a
+ * transaction
+ */
+static void oracle_count_prefixes(char **items, int n_items, void *data) {
+    OraclePrefixes *prefixes = (OraclePrefixes *)data;
+    cvector_set_size(prefixes->keys, 0);
+    int i, key;
+    for (i = 0; i < n_items; i++) {
+        if (hashmap_get(prefixes->index_map, items[i], strlen(items[i]) + 1,
+                        &key) == MAP_OK) {
+            cvector_push_back(prefixes->keys, key);
+        }
+    }
+    int n_keys = cvector_size(prefixes->keys);
+    if (n_keys == 0) {
+        return;
+    }
+    qsort(prefixes->keys, n_keys, sizeof(int), oracle_key_compare);
+    for (i = 1; i <= n_keys; i++) {
+        itemset_map_increment(prefixes->prefixes, prefixes->keys, i, 1);
+    }
+}
+
+/**
+ * @brief Print a mismatch, if fewer than ORACLE_MAX_REPORTED of the same
+ * kind have already been printed
+ *
+ * @param count Number of mismatches of the same kind found so far, increased
+ * @return true if the mismatch has to be printed
+ */
+static bool oracle_report(uint64_t *count) {
+    (*count)++;
+    if (*count == ORACLE_MAX_REPORTED + 1) {
+        fprintf(stderr, "oracle: ...\n");
+    }
+    return *count <= ORACLE_MAX_REPORTED;
+}
+
+/**
+ * @brief Check the frequent items and their order
+ *
+ * @return The number of mismatches
+ */
+static uint64_t oracle_check_items(SupportMap support_map, int threshold,
+                                   hashmap_element *items_count, int num_items,
+                                   int *sorted_indices) {
+    uint64_t errors = 0;
+    int i, support;
+    // every item computed by the pipeline is frequent, with the right support
+    for (i = 0; i < num_items; i++) {
+        hashmap_element *item = &items_count[i];
+        if (hashmap_get(support_map, item->key, item->key_length, &support) !=
+            MAP_OK) {
+            support = 0;
+        }
+        if (support != item->value && oracle_report(&errors)) {
+            fprintf(stderr, "oracle: item %s has support %d, expected %d\n",
+                    (char *)item->key, item->value, support);
+        }
+        if (support < threshold && oracle_report(&errors)) {
+            fprintf(stderr, "oracle: item %s is not frequent\n",
+                    (char *)item->key);
+        }
+    }
+    // no frequent item is missing
+    cvector_vector_type(hashmap_element) frequent = NULL;
+    hashmap_get_elements_with_support(support_map, &frequent, threshold);
+    if ((int)cvector_size(frequent) != num_items && oracle_report(&errors)) {
+        fprintf(stderr, "oracle: %d frequent items, expected %zu\n", num_items,
+                cvector_size(frequent));
+    }
+    cvector_free(frequent);
+
+    // the sorted indices are a permutation, in increasing order
+    bool *seen = (bool *)calloc(num_items, sizeof(bool));
+    assert(seen != NULL || num_items == 0);
+    for (i = 0; i < num_items; i++) {
+        int index = sorted_indices[i];
+        if (index < 0 || index >= num_items || seen[index]) {
+            if (oracle_report(&errors))
+                fprintf(stderr, "oracle: sorted index %d at position %d is "
+                                "invalid or repeated\n",
+                        index, i);
+            continue;
+        }
+        seen[index] = true;
+        int prev = i > 0 ? sorted_indices[i - 1] : -1;
+        if (prev >= 0 && prev < num_items &&
+            item_compare(&items_count[prev], &items_count[index]) >= 0 &&
+            oracle_report(&errors)) {
+            fprintf(stderr, "oracle: items %s and %s are not sorted\n",
+                    (char *)items_count[prev].key,
+                    (char *)items_count[index].key);
+        }
+    }
+    free(seen);
+    return errors;
+}
+
+/**
+ * @brief Print a path of item ids
+ */
+static void oracle_print_path(int *keys, int n_keys) {
+    int i;
+    fprintf(stderr, "[");
+    for (i = 0; i < n_keys; i++) {
+        fprintf(stderr, i == 0 ? "%d" : " %d", keys[i]);
+    }
+    fprintf(stderr, "]");
+}
+
+/**
+ * @brief Check that the tree has exactly one node per prefix, with the
+ * count of the prefix as value; in a compact tree, every item of the chain
+ * of a node is the end of a prefix with the value of the node
+ *
+ * @return The number of mismatches
+ */
+static uint64_t oracle_check_tree(ItemsetMap *prefixes, Tree tree) {
+    uint64_t errors = 0;
+    size_t n_nodes = cvector_size(tree), i;
+    if (n_nodes == 0 || tree[0]->key != TREE_NODE_NULL) {
+        if (oracle_report(&errors))
+            fprintf(stderr, "oracle: the tree has no root\n");
+        return errors;
+    }
+    // the longest path without cycles has all the items of the tree
+    size_t n_tree_items = 0;
+    for (i = 1; i < n_nodes; i++) {
+        n_tree_items += 1 + cvector_size(tree[i]->chain);
+    }
+    ItemsetMap *visited = itemset_map_new();
+    cvector_vector_type(int) path = NULL;
+    for (i = 1; i < n_nodes; i++) {
+        TreeNode *node = tree[i];
+        // the parent links the node with the same key
+        int child;
+        if (node->parent < 0 || node->parent >= (int)n_nodes ||
+            hashmap_get(tree[node->parent]->adj, &(node->key), sizeof(int),
+                        &child) != MAP_OK ||
+            child != (int)i) {
+            if (oracle_report(&errors))
+                fprintf(stderr,
+                        "oracle: node %zu is not a child of its parent\n", i);
+            continue;
+        }
+        // path from the root, the ids along it are increasing
+        cvector_set_size(path, 0);
+        int curr = i, j;
+        while (curr != 0 && cvector_size(path) <= n_tree_items) {
+            for (j = (int)cvector_size(tree[curr]->chain) - 1; j >= 0; j--) {
+                cvector_push_back(path, tree[curr]->chain[j]);
+            }
+            cvector_push_back(path, tree[curr]->key);
+            curr = tree[curr]->parent;
+        }
+        int n_keys = cvector_size(path);
+        if (curr != 0) {
+            if (oracle_report(&errors))
+                fprintf(stderr, "oracle: node %zu is in a cycle\n", i);
+            continue;
+        }
+        for (j = 0; j < n_keys / 2; j++) {
+            int tmp = path[j];
+            path[j] = path[n_keys - 1 - j];
+            path[n_keys - 1 - j] = tmp;
+        }
+
+        // the prefixes ending in the items of the node
+        int length;
+        for (length = n_keys - (int)cvector_size(node->chain);
+             length <= n_keys; length++) {
+            int expected;
+            if (itemset_map_get(prefixes, path, length, &expected) !=
+                MAP_OK) {
+                expected = 0;
+            }
+            if (node->value != expected && oracle_report(&errors)) {
+                fprintf(stderr, "oracle: path ");
+                oracle_print_path(path, length);
+                fprintf(stderr, " has count %d, expected %d\n", node->value,
+                        expected);
+            }
+            int index = itemset_map_increment(visited, path, length, 1);
+            if (visited->entries[index].weight > 1 && oracle_report(&errors)) {
+                fprintf(stderr, "oracle: path ");
+                oracle_print_path(path, length);
+                fprintf(stderr, " is repeated\n");
+            }
+        }
+    }
+    // every prefix has a node
+    int n_prefixes = itemset_map_length(prefixes), p;
+    for (p = 0; p < n_prefixes; p++) {
+        WeightedItemset *prefix = &prefixes->entries[p];
+        int weight;
+        if (itemset_map_get(visited, prefix->items,
+                            cvector_size(prefix->items),
+                            &weight) != MAP_OK &&
+            oracle_report(&errors)) {
+            fprintf(stderr, "oracle: path ");
+            oracle_print_path(prefix->items, cvector_size(prefix->items));
+            fprintf(stderr, " with count %d is missing\n", prefix->weight);
+        }
+    }
+    cvector_free(path);
+    itemset_map_free(visited);
+    return errors;
+}
+
+/**
+ * @brief Check the results of the pipeline against a serial computation
+ * done by direct enumeration. Meant for small inputs, it must be called
+ * by process 0 only.
+ *
+ * The oracle reads the file again, counts the support of every item and
+ * checks that the frequent items and their supports are the ones computed
+ * by the processes, and that the sorted indices order them by decreasing
+ * support, with ties broken as by @see item_compare(). It then inserts
+ * every prefix of every transaction, with the items sorted by id, into a
+ * map from itemset to count, and checks that the global tree has exactly
+ * one node per distinct prefix, whose value is the count of the prefix.
+ * The mismatches are printed on stderr.
+ *
+ * @param filename Name of the file with the transactions
+ * @param min_count Minimum support count of a frequent item, as computed by
+ * the pipeline
+ * @param num_transactions Number of transactions read by the pipeline
+ * @param items_count The array of hashmap elements having the item string as
+ * a key and the support count as a value
+ * @param num_items The number of frequent items
+ * @param sorted_indices The array of the sorted indices of the items
+ * @param tree The global tree
+ * @return The number of mismatches found, 0 if the results are correct
+ */
+uint64_t oracle_check(char *filename, int min_count,
+                      uint64_t num_transactions, hashmap_element *items_count,
+                      int num_items, int *sorted_indices, Tree tree) {
+    uint64_t errors = 0;
+
+    /*--- SUPPORTS ---*/
+    OracleSupports supports;
+    supports.support_map = hashmap_new();
+    uint64_t n_transactions =
+        oracle_scan(filename, oracle_count_supports, &supports);
+    if (n_transactions != num_transactions && oracle_report(&errors)) {
+        fprintf(stderr,
+                "oracle: %" PRIu64 " transactions, expected %" PRIu64 "\n",
+                num_transactions, n_transactions);
+    }
+    errors += oracle_check_items(supports.support_map, min_count, items_count,
+                                 num_items, sorted_indices);
+    hashmap_free(supports.support_map);
+
+    /*--- PREFIXES ---*/
+    // the ids of the pipeline, so that the paths can be compared
+    OraclePrefixes prefixes;
+    prefixes.index_map = hashmap_new();
+    prefixes.prefixes = itemset_map_new();
+    prefixes.keys = NULL;
+    int i;
+    for (i = 0; i < num_items; i++) {
+        hashmap_element *item = &items_count[sorted_indices[i]];
+        hashmap_put(prefixes.index_map, item->key, item->key_length,
+                    num_items - 1 - i);
+    }
+    oracle_scan(filename, oracle_count_prefixes, &prefixes);
+    errors += oracle_check_tree(prefixes.prefixes, tree);
+
+    if (errors == 0) {
+        fprintf(stderr,
+                "oracle: OK, %" PRIu64 " transactions, %d frequent items, "
+                "%d paths\n",
+                n_transactions, num_items,
+                itemset_map_length(prefixes.prefixes));
+    } else {
+        fprintf(stderr, "oracle: %" PRIu64 " mismatches\n", errors);
+    }
+    cvector_free(prefixes.keys);
+    itemset_map_free(prefixes.prefixes);
+    hashmap_free(prefixes.index_map);
+    return errors;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file oracle.h
+ * @brief Brute-force reference used to validate the results of the pipeline
+ *
+ */
+#ifndef ORACLE_H
+#define ORACLE_H
+
+#include "tree.h"
+#include "types.h"
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of mismatches of each kind printed by the oracle
+ */
+#define ORACLE_MAX_REPORTED 10
+
+/**
+ * @brief Function called by the oracle on every transaction of a file
+ *
+ * @param items The items of the transaction, as '\0' terminated strings
+ * @param n_items Number of items
+ * @param data Data passed to @see oracle_scan()
+ */
+typedef void (*OracleVisitor)(char **items, int n_items, void *data);
+
+/**
+ * @brief Read serially the whole file of transactions, calling visit on
+ * every transaction. Both the text and the binary formats are supported.
+ *
+ * The file is read with the standard library, independently of the
+ * functions used by the pipeline, so that a bug in the parallel reading is
+ * detected as well.
+ *
+ * @param filename Name of the file
+ * @param visit Function called on every transaction
+ * @param data Data passed to visit
+ * @return The number of transactions read
+ */
+uint64_t oracle_scan(char *filename, OracleVisitor visit, void *data);
+
+/**
+ * @brief Check the results of the pipeline against a serial computation
+ * done by direct enumeration. Meant for small inputs, it must be called
+ * by process 0 only.
+ *
+ * The oracle reads the file again, counts the support of every item and
+ * checks that the frequent items and their supports are the ones computed
+ * by the processes, and that the sorted indices order them by decreasing
+ * support, with ties broken as by @see item_compare(). It then inserts
+ * every prefix of every transaction, with the items sorted by id, into a
+ * map from itemset to count, and checks that the global tree has exactly
+ * one node per distinct prefix, whose value is the count of the prefix.
+ * The mismatches are printed on stderr.
+ *
+ * @param filename Name of the file with the transactions
+ * @param min_count Minimum support count of a frequent item, as computed by
+ * the pipeline
+ * @param num_transactions Number of transactions read by the pipeline
+ * @param items_count The array of hashmap elements having the item string as
+ * a key and the support count as a value
+ * @param num_items The number of frequent items
+ * @param sorted_indices The array of the sorted indices of the items
+ * @param tree The global tree
+ * @return The number of mismatches found, 0 if the results are correct
+ */
+uint64_t oracle_check(char *filename, int min_count,
+                      uint64_t num_transactions, hashmap_element *items_count,
+                      int num_items, int *sorted_indices, Tree tree);
+
+#endif
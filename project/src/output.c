@@ -0,0 +1,403 @@
+#include "output.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Allocate an aligned buffer
+ *
+ * @param buffer The buffer
+ * @param capacity Its capacity
+ */
+static void output_buffer_init(OutputBuffer *buffer, size_t capacity) {
+    void *data = NULL;
+    int err = posix_memalign(&data, OUTPUT_ALIGNMENT, capacity);
+    assert(err == 0 && data != NULL);
+    buffer->data = (char *)data;
+    buffer->used = 0;
+    buffer->capacity = capacity;
+}
+
+/**
+ * @brief Append bytes to the data of the process waiting to be written,
+ * doubling its aligned buffer when it is full
+ *
+ * @param writer The writer
+ * @param data The bytes
+ * @param size Number of bytes
+ */
+static void output_append_pending(OutputWriter *writer, const char *data,
+                                  size_t size) {
+    OutputBuffer *pending = &writer->pending;
+    if (pending->used + size > pending->capacity) {
+        size_t capacity = 2 * pending->capacity;
+        if (capacity < pending->used + size)
+            capacity = pending->used + size;
+        OutputBuffer grown;
+        output_buffer_init(&grown, capacity);
+        memcpy(grown.data, pending->data, pending->used);
+        grown.used = pending->used;
+        free(pending->data);
+        *pending = grown;
+    }
+    memcpy(pending->data + pending->used, data, size);
+    pending->used += size;
+}
+
+/**
+ * @brief Write bytes at an offset of the file, independently of the other
+ * processes
+ *
+ * @param writer The writer
+ * @param offset Offset in the file
+ * @param data The bytes
+ * @param size Number of bytes
+ */
+static void output_write_at(OutputWriter *writer, MPI_Offset offset,
+                            const char *data, uint64_t size) {
+    uint64_t start;
+    for (start = 0; start < size; start += OUTPUT_MAX_WRITE) {
+        uint64_t length = size - start < OUTPUT_MAX_WRITE ? size - start
+                                                          : OUTPUT_MAX_WRITE;
+        MPI_File_write_at(writer->file, offset + start, data + start,
+                          (int)length, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+}
+
+/**
+ * @brief Reserve space at the end of the file, from any process, by adding
+ * its size to the counter on process 0
+ *
+ * @param writer The writer
+ * @param size Number of bytes
+ * @return The offset of the space
+ */
+static MPI_Offset output_reserve_offset(OutputWriter *writer, uint64_t size) {
+    int64_t add = size, offset = 0;
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, writer->end);
+    MPI_Fetch_and_op(&add, &offset, MPI_INT64_T, 0, 0, MPI_SUM, writer->end);
+    MPI_Win_unlock(0, writer->end);
+    return offset;
+}
+
+/**
+ * @brief Open and truncate the output file, on every process.
+ *
+ * In binary format, process 0 writes the header first: OUTPUT_MAGIC, the
+ * number of items as a 64-bit integer and the names of the items by id,
+ * each followed by '\0'. All the numbers are stored in the native byte
+ * order, see @see output_itemset() and @see output_rule() for the records.
+ *
+ * @param writer The writer to initialize
+ * @param filename Name of the file
+ * @param format Format of the records
+ * @param names Name of every item id
+ * @param num_items Number of items
+ * @param rank Rank of the current process
+ * @param num_threads Number of threads of every process that write records
+ */
+void output_open(OutputWriter *writer, char *filename, OutputFormat format,
+                 char **names, int num_items, int rank, int num_threads) {
+    int err = MPI_File_open(MPI_COMM_WORLD, filename,
+                            MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                            &writer->file);
+    if (err != MPI_SUCCESS) {
+        if (rank == 0)
+            fprintf(stderr, "cannot open %s\n", filename);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_File_set_size(writer->file, 0);
+    writer->format = format;
+    writer->names = names;
+    writer->name_lengths = (int *)malloc((num_items + 1) * sizeof(int));
+    writer->buffers =
+        (OutputBuffer *)malloc(num_threads * sizeof(OutputBuffer));
+    assert(writer->name_lengths != NULL && writer->buffers != NULL);
+    int i;
+    for (i = 0; i < num_items; i++) {
+        writer->name_lengths[i] = strlen(names[i]);
+    }
+    writer->num_buffers = num_threads;
+    for (i = 0; i < num_threads; i++) {
+        output_buffer_init(&writer->buffers[i], OUTPUT_BUFFER_SIZE);
+    }
+    output_buffer_init(&writer->pending, OUTPUT_BUFFER_SIZE);
+    omp_init_lock(&writer->lock);
+    writer->count = 0;
+    int provided;
+    MPI_Query_thread(&provided);
+    writer->independent = provided >= MPI_THREAD_SERIALIZED;
+
+    if (format == OUTPUT_BINARY && rank == 0) {
+        uint64_t n = num_items;
+        output_append_pending(writer, OUTPUT_MAGIC, 4);
+        output_append_pending(writer, (char *)&n, sizeof(n));
+        for (i = 0; i < num_items; i++) {
+            output_append_pending(writer, names[i],
+                                  writer->name_lengths[i] + 1);
+        }
+        output_write_at(writer, 0, writer->pending.data, writer->pending.used);
+    }
+    // the records go after the header
+    int64_t *end;
+    MPI_Win_allocate(rank == 0 ? sizeof(int64_t) : 0, sizeof(int64_t),
+                     MPI_INFO_NULL, MPI_COMM_WORLD, &end, &writer->end);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, writer->end);
+        *end = writer->pending.used;
+        MPI_Win_unlock(0, writer->end);
+    }
+    writer->pending.used = 0;
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+/**
+ * @brief Space for a record in the buffer of the current thread. A buffer
+ * without enough space is moved to the data of the process first, which is
+ * written if it has reached OUTPUT_PENDING_LIMIT bytes.
+ *
+ * @param writer The writer
+ * @param size Maximum size of the record
+ * @return The buffer, with at least size bytes free
+ */
+static OutputBuffer *output_reserve(OutputWriter *writer, size_t size) {
+    int thread = omp_get_thread_num();
+    assert(thread < writer->num_buffers);
+    OutputBuffer *buffer = &writer->buffers[thread];
+    if (buffer->used + size > buffer->capacity) {
+        omp_set_lock(&writer->lock);
+        output_append_pending(writer, buffer->data, buffer->used);
+        // a round with many records does not wait for its end
+        if (writer->independent &&
+            writer->pending.used >= OUTPUT_PENDING_LIMIT) {
+            output_write_at(writer,
+                            output_reserve_offset(writer, writer->pending.used),
+                            writer->pending.data, writer->pending.used);
+            writer->pending.used = 0;
+        }
+        omp_unset_lock(&writer->lock);
+        buffer->used = 0;
+    }
+    if (size > buffer->capacity) {
+        free(buffer->data);
+        output_buffer_init(buffer, size);
+    }
+    return buffer;
+}
+
+/**
+ * @brief Append a 32-bit integer to a buffer
+ */
+static void output_put_int(OutputBuffer *buffer, int32_t value) {
+    memcpy(buffer->data + buffer->used, &value, sizeof(value));
+    buffer->used += sizeof(value);
+}
+
+/**
+ * @brief Append a 64-bit floating point number to a buffer
+ */
+static void output_put_double(OutputBuffer *buffer, double value) {
+    memcpy(buffer->data + buffer->used, &value, sizeof(value));
+    buffer->used += sizeof(value);
+}
+
+/**
+ * @brief Append the names of some items to a buffer, separated by spaces
+ *
+ * @param writer The writer
+ * @param buffer The buffer, with enough space
+ * @param items The ids of the items
+ * @param n_items Number of items
+ * @param reverse Whether to append the items from the last one
+ */
+static void output_put_names(OutputWriter *writer, OutputBuffer *buffer,
+                             const int *items, int n_items, bool reverse) {
+    int i;
+    for (i = 0; i < n_items; i++) {
+        int item = reverse ? items[n_items - 1 - i] : items[i];
+        if (i > 0)
+            buffer->data[buffer->used++] = ' ';
+        memcpy(buffer->data + buffer->used, writer->names[item],
+               writer->name_lengths[item]);
+        buffer->used += writer->name_lengths[item];
+    }
+}
+
+/**
+ * @brief Maximum size of the names of some items in text format
+ */
+static size_t output_names_size(OutputWriter *writer, const int *items,
+                                int n_items) {
+    size_t size = 0;
+    int i;
+    for (i = 0; i < n_items; i++) {
+        size += writer->name_lengths[items[i]] + 1;
+    }
+    return size;
+}
+
+/**
+ * @brief Visitor that writes an itemset, from any thread. In text format it
+ * is written as "support: items", in binary format as its support, its
+ * number of items and the item ids, as 32-bit integers. The items are
+ * written by increasing id, i.e. the most frequent first.
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the OutputWriter
+ */
+void output_itemset(const int *items, int n_items, int support, void *data) {
+    OutputWriter *writer = (OutputWriter *)data;
+    OutputBuffer *buffer;
+    int i;
+    if (writer->format == OUTPUT_BINARY) {
+        buffer = output_reserve(writer, (n_items + 2) * sizeof(int32_t));
+        output_put_int(buffer, support);
+        output_put_int(buffer, n_items);
+        for (i = n_items - 1; i >= 0; i--) {
+            output_put_int(buffer, items[i]);
+        }
+    } else {
+        buffer = output_reserve(writer,
+                                output_names_size(writer, items, n_items) + 16);
+        buffer->used += sprintf(buffer->data + buffer->used, "%d: ", support);
+        output_put_names(writer, buffer, items, n_items, true);
+        buffer->data[buffer->used++] = '\n';
+    }
+#pragma omp atomic
+    writer->count++;
+}
+
+/**
+ * @brief Write an association rule, from any thread. In text format it is
+ * written as "antecedent => consequent support confidence lift conviction",
+ * in binary format as the 32-bit support, the 64-bit floating point
+ * confidence, lift and conviction, and the two sides as a 32-bit number of
+ * items followed by the 32-bit item ids.
+ *
+ * @param writer The writer
+ * @param antecedent The ids of the items of the antecedent, written in the
+ * given order as the ones of the consequent
+ * @param n_antecedent Number of items of the antecedent
+ * @param consequent The ids of the items of the consequent
+ * @param n_consequent Number of items of the consequent
+ * @param support Support count of the rule
+ * @param confidence Confidence of the rule
+ * @param lift Lift of the rule
+ * @param conviction Conviction of the rule, infinite for a confidence of 1
+ */
+void output_rule(OutputWriter *writer, const int *antecedent,
+                 int n_antecedent, const int *consequent, int n_consequent,
+                 int support, double confidence, double lift,
+                 double conviction) {
+    OutputBuffer *buffer;
+    int i;
+    if (writer->format == OUTPUT_BINARY) {
+        buffer = output_reserve(writer,
+                                (n_antecedent + n_consequent + 3) *
+                                        sizeof(int32_t) +
+                                    3 * sizeof(double));
+        output_put_int(buffer, support);
+        output_put_double(buffer, confidence);
+        output_put_double(buffer, lift);
+        output_put_double(buffer, conviction);
+        output_put_int(buffer, n_antecedent);
+        for (i = 0; i < n_antecedent; i++) {
+            output_put_int(buffer, antecedent[i]);
+        }
+        output_put_int(buffer, n_consequent);
+        for (i = 0; i < n_consequent; i++) {
+            output_put_int(buffer, consequent[i]);
+        }
+    } else {
+        // a %f of a confidence up to 1 and of lift and conviction up to the
+        // number of transactions
+        buffer = output_reserve(
+            writer, output_names_size(writer, antecedent, n_antecedent) +
+                        output_names_size(writer, consequent, n_consequent) +
+                        128);
+        output_put_names(writer, buffer, antecedent, n_antecedent, false);
+        memcpy(buffer->data + buffer->used, " => ", 4);
+        buffer->used += 4;
+        output_put_names(writer, buffer, consequent, n_consequent, false);
+        buffer->used += sprintf(buffer->data + buffer->used, " %d %f %f %f\n",
+                                support, confidence, lift, conviction);
+    }
+#pragma omp atomic
+    writer->count++;
+}
+
+/**
+ * @brief Write the full buffers of every process to the file, collectively.
+ * Every process has to call it, outside of a parallel region.
+ *
+ * @param writer The writer
+ * @param all Whether to write the buffers that are not full too
+ */
+void output_flush(OutputWriter *writer, bool all) {
+    int i;
+    if (all) {
+        for (i = 0; i < writer->num_buffers; i++) {
+            OutputBuffer *buffer = &writer->buffers[i];
+            output_append_pending(writer, buffer->data, buffer->used);
+            buffer->used = 0;
+        }
+    }
+    uint64_t size = writer->pending.used, before = 0, total = 0;
+    MPI_Exscan(&size, &before, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // undefined on process 0
+    if (rank == 0)
+        before = 0;
+    MPI_Allreduce(&size, &total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (total == 0)
+        return;
+    MPI_Offset offset = 0;
+    if (rank == 0)
+        offset = output_reserve_offset(writer, total);
+    MPI_Bcast(&offset, 1, MPI_OFFSET, 0, MPI_COMM_WORLD);
+    // the same number of collective calls on every process
+    uint64_t calls = (size + OUTPUT_MAX_WRITE - 1) / OUTPUT_MAX_WRITE;
+    uint64_t max_calls = 0, c;
+    MPI_Allreduce(&calls, &max_calls, 1, MPI_UINT64_T, MPI_MAX,
+                  MPI_COMM_WORLD);
+    for (c = 0; c < max_calls; c++) {
+        uint64_t start = c * OUTPUT_MAX_WRITE;
+        uint64_t length = 0;
+        if (start < size)
+            length = size - start < OUTPUT_MAX_WRITE ? size - start
+                                                     : OUTPUT_MAX_WRITE;
+        MPI_File_write_at_all(writer->file,
+                              offset + before + start,
+                              writer->pending.data + (length > 0 ? start : 0),
+                              (int)length, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+    writer->pending.used = 0;
+}
+
+/**
+ * @brief Write all the buffers and close the file, collectively
+ *
+ * @param writer The writer
+ * @return The number of records written by all the processes
+ */
+uint64_t output_close(OutputWriter *writer) {
+    output_flush(writer, true);
+    MPI_File_close(&writer->file);
+    MPI_Win_free(&writer->end);
+    uint64_t total = 0;
+    MPI_Allreduce(&writer->count, &total, 1, MPI_UINT64_T, MPI_SUM,
+                  MPI_COMM_WORLD);
+    int i;
+    for (i = 0; i < writer->num_buffers; i++) {
+        free(writer->buffers[i].data);
+    }
+    free(writer->buffers);
+    free(writer->name_lengths);
+    free(writer->pending.data);
+    omp_destroy_lock(&writer->lock);
+    return total;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file output.h
+ * @brief Buffered writer of the mined itemsets and rules to a single file
+ * shared by all the processes
+ *
+ */
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <mpi.h>
+#include <omp.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "types.h"
+
+/**
+ * @brief Size of the buffer of every thread, moved to the data of the
+ * process when full
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+/**
+ * @brief Alignment of the buffers, in bytes
+ */
+#define OUTPUT_ALIGNMENT 4096
+/**
+ * @brief Maximum number of bytes written by a process in a single call
+ */
+#define OUTPUT_MAX_WRITE (1 << 30)
+/**
+ * @brief Number of bytes of the data of a process waiting to be written
+ * above which it is written at once, without waiting for the end of the
+ * round
+ */
+#define OUTPUT_PENDING_LIMIT (1 << 26)
+/**
+ * @brief First bytes of a binary output file
+ */
+#define OUTPUT_MAGIC "FPO1"
+
+/**
+ * @brief Format of the output
+ */
+typedef enum OutputFormat {
+    /**
+     * @brief A line per record, with the names of the items
+     */
+    OUTPUT_TEXT,
+    /**
+     * @brief The header with the names of the items, followed by the records
+     * with the ids of the items, see @see output_open()
+     */
+    OUTPUT_BINARY
+} OutputFormat;
+
+/**
+ * @brief Output buffer of a thread
+ */
+typedef struct OutputBuffer {
+    char *data;
+    size_t used;
+    size_t capacity;
+} OutputBuffer;
+
+/**
+ * @brief Writer of the records of every process to a shared file.
+ *
+ * Every thread formats its records into its own buffer; a full buffer is
+ * appended to the data of the process, which is written collectively by
+ * @see output_flush() at the offset of the process, computed with
+ * MPI_Exscan after the data of the processes with a lower rank. When the
+ * data of a process grows past OUTPUT_PENDING_LIMIT within a round, the
+ * thread that appends to it writes it right away with an independent
+ * write. Every write gets its space at the end of the file from a counter
+ * on process 0, incremented with MPI_Fetch_and_op, so the records of the
+ * processes can be interleaved in the file.
+ */
+typedef struct OutputWriter {
+    MPI_File file;
+    /**
+     * @brief Window of the offset of the end of the file reserved so far,
+     * a 64-bit integer on process 0
+     */
+    MPI_Win end;
+    /**
+     * @brief Whether the threads can write the data of the process, i.e.
+     * MPI supports at least MPI_THREAD_SERIALIZED
+     */
+    bool independent;
+    OutputFormat format;
+    /**
+     * @brief Name of every item id, and its length
+     */
+    char **names;
+    int *name_lengths;
+    /**
+     * @brief The buffer of every thread
+     */
+    OutputBuffer *buffers;
+    int num_buffers;
+    /**
+     * @brief The full buffers of the process, waiting to be written, in an
+     * aligned buffer that doubles when it is full, up to about
+     * OUTPUT_PENDING_LIMIT bytes
+     */
+    OutputBuffer pending;
+    omp_lock_t lock;
+    /**
+     * @brief Number of records of the current process
+     */
+    uint64_t count;
+} OutputWriter;
+
+/**
+ * @brief Open and truncate the output file, on every process.
+ *
+ * In binary format, process 0 writes the header first: OUTPUT_MAGIC, the
+ * number of items as a 64-bit integer and the names of the items by id,
+ * each followed by '\0'. All the numbers are stored in the native byte
+ * order, see @see output_itemset() and @see output_rule() for the records.
+ *
+ * @param writer The writer to initialize
+ * @param filename Name of the file
+ * @param format Format of the records
+ * @param names Name of every item id
+ * @param num_items Number of items
+ * @param rank Rank of the current process
+ * @param num_threads Number of threads of every process that write records
+ */
+void output_open(OutputWriter *writer, char *filename, OutputFormat format,
+                 char **names, int num_items, int rank, int num_threads);
+
+/**
+ * @brief Visitor that writes an itemset, from any thread. In text format it
+ * is written as "support: items", in binary format as its support, its
+ * number of items and the item ids, as 32-bit integers. The items are
+ * written by increasing id, i.e. the most frequent first.
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the OutputWriter
+ */
+void output_itemset(const int *items, int n_items, int support, void *data);
+
+/**
+ * @brief Write an association rule, from any thread. In text format it is
+ * written as "antecedent => consequent support confidence lift conviction",
+ * in binary format as the 32-bit support, the 64-bit floating point
+ * confidence, lift and conviction, and the two sides as a 32-bit number of
+ * items followed by the 32-bit item ids.
+ *
+ * @param writer The writer
+ * @param antecedent The ids of the items of the antecedent, written in the
+ * given order as the ones of the consequent
+ * @param n_antecedent Number of items of the antecedent
+ * @param consequent The ids of the items of the consequent
+ * @param n_consequent Number of items of the consequent
+ * @param support Support count of the rule
+ * @param confidence Confidence of the rule
+ * @param lift Lift of the rule
+ * @param conviction Conviction of the rule, infinite for a confidence of 1
+ */
+void output_rule(OutputWriter *writer, const int *antecedent,
+                 int n_antecedent, const int *consequent, int n_consequent,
+                 int support, double confidence, double lift,
+                 double conviction);
+
+/**
+ * @brief Write the full buffers of every process to the file, collectively.
+ * Every process has to call it, outside of a parallel region.
+ *
+ * @param writer The writer
+ * @param all Whether to write the buffers that are not full too
+ */
+void output_flush(OutputWriter *writer, bool all);
+
+/**
+ * @brief Write all the buffers and close the file, collectively
+ *
+ * @param writer The writer
+ * @return The number of records written by all the processes
+ */
+uint64_t output_close(OutputWriter *writer);
+
+#endif
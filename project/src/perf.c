@@ -0,0 +1,263 @@
+#include "perf.h"
+#include <inttypes.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief Value of a counter read with PERF_FORMAT_TOTAL_TIME_ENABLED and
+ * PERF_FORMAT_TOTAL_TIME_RUNNING
+ */
+typedef struct PerfReading {
+    uint64_t value;
+    uint64_t time_enabled;
+    uint64_t time_running;
+} PerfReading;
+
+static const char *perf_names[PERF_NUM_COUNTERS] = {
+    "cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses"};
+
+static bool perf_on = false;
+static int perf_rank = 0;
+static int perf_num_threads = 0;
+// file descriptor of every counter of every thread, -1 if not available
+static int (*perf_fds)[PERF_NUM_COUNTERS] = NULL;
+// values of the counters at the beginning of the current phase
+static uint64_t (*perf_start)[PERF_NUM_COUNTERS] = NULL;
+
+/**
+ * @brief Fill the attributes of the perf event of a counter
+ *
+ * @param counter The counter
+ * @param attr The attributes to fill
+ */
+static void perf_event_attr_init(PerfCounter counter,
+                                 struct perf_event_attr *attr) {
+    memset(attr, 0, sizeof(struct perf_event_attr));
+    attr->size = sizeof(struct perf_event_attr);
+    attr->exclude_kernel = 1;
+    attr->exclude_hv = 1;
+    attr->read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    switch (counter) {
+    case PERF_CYCLES:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_LLC_MISSES:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PERF_DTLB_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_DTLB |
+                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    default:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+}
+
+/**
+ * @brief Read a counter, scaling its value if the counter has been
+ * multiplexed with other events
+ *
+ * @param fd File descriptor of the counter, or -1
+ * @return The value of the counter, PERF_UNAVAILABLE if it can't be read
+ */
+static uint64_t perf_read(int fd) {
+    PerfReading reading;
+    if (fd < 0 || read(fd, &reading, sizeof(reading)) != sizeof(reading)) {
+        return PERF_UNAVAILABLE;
+    }
+    if (reading.time_running == 0) {
+        return 0;
+    }
+    if (reading.time_running < reading.time_enabled) {
+        return (uint64_t)((double)reading.value * reading.time_enabled /
+                          reading.time_running);
+    }
+    return reading.value;
+}
+
+/**
+ * @brief Open the counters on the threads of the OpenMP pool. Must be called
+ * by the main thread, outside of any parallel region.
+ *
+ * @param rank Rank of the current process
+ * @param num_threads Number of threads of the parallel regions of the program
+ * @param enabled Whether to collect the counters, if false all the other
+ * functions do nothing
+ */
+void perf_init(int rank, int num_threads, bool enabled) {
+    perf_on = enabled;
+    perf_rank = rank;
+    if (!enabled) {
+        return;
+    }
+    perf_num_threads = num_threads < 1 ? 1 : num_threads;
+    perf_fds = malloc(perf_num_threads * sizeof(*perf_fds));
+    perf_start = calloc(perf_num_threads, sizeof(*perf_start));
+    int opened = 0;
+
+    // the threads of the pool are reused by the following parallel regions,
+    // and the counters of every thread follow it on every CPU
+#pragma omp parallel default(none) shared(perf_fds, opened)                    \
+    num_threads(perf_num_threads)
+    {
+        int t = omp_get_thread_num();
+        int c;
+        for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+            struct perf_event_attr attr;
+            perf_event_attr_init(c, &attr);
+            perf_fds[t][c] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (perf_fds[t][c] >= 0) {
+#pragma omp atomic
+                opened++;
+            }
+        }
+    }
+    if (rank == 0) {
+        if (opened == 0) {
+            fprintf(stderr, "perf: hardware counters not available\n");
+        }
+        fprintf(stderr, "perf, rank, thread, msg");
+        int c;
+        for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+            fprintf(stderr, ", %s", perf_names[c]);
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+/**
+ * @brief Whether the counters are collected
+ *
+ * @return true if perf_init() has been called with enabled
+ */
+bool perf_enabled() { return perf_on; }
+
+/**
+ * @brief Name of a counter
+ *
+ * @param counter The counter
+ * @return The name of the counter, as printed in the log
+ */
+const char *perf_counter_name(PerfCounter counter) {
+    return perf_names[counter];
+}
+
+/**
+ * @brief Start counting the events of a phase
+ */
+void perf_phase_begin() {
+    if (!perf_on) {
+        return;
+    }
+    int t, c;
+    for (t = 0; t < perf_num_threads; t++) {
+        for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+            perf_start[t][c] = perf_read(perf_fds[t][c]);
+        }
+    }
+}
+
+/**
+ * @brief Print a line of the counters log
+ *
+ * @param thread Thread of the values, negative for the sum over the threads
+ * @param name Name of the phase
+ * @param values Values of the counters
+ */
+static void perf_print(int thread, const char *name,
+                       uint64_t values[PERF_NUM_COUNTERS]) {
+    char line[512];
+    int length;
+    if (thread < 0) {
+        length = snprintf(line, sizeof(line), "perf, %d, all, %s", perf_rank,
+                          name);
+    } else {
+        length = snprintf(line, sizeof(line), "perf, %d, %d, %s", perf_rank,
+                          thread, name);
+    }
+    int c;
+    for (c = 0; c < PERF_NUM_COUNTERS && length < (int)sizeof(line); c++) {
+        if (values[c] == PERF_UNAVAILABLE) {
+            length += snprintf(line + length, sizeof(line) - length, ", n/a");
+        } else {
+            length += snprintf(line + length, sizeof(line) - length,
+                               ", %" PRIu64, values[c]);
+        }
+    }
+    // a single write, so that the lines of the processes don't mix
+    fprintf(stderr, "%s\n", line);
+}
+
+/**
+ * @brief Stop counting the events of the current phase and print them on
+ * stderr, for every thread and summed over the threads
+ *
+ * @param name Name of the phase
+ * @param totals Where to store the values summed over the threads, set to
+ * PERF_UNAVAILABLE for the counters that are not available
+ */
+void perf_phase_end(const char *name, uint64_t totals[PERF_NUM_COUNTERS]) {
+    int t, c;
+    for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+        totals[c] = PERF_UNAVAILABLE;
+    }
+    if (!perf_on) {
+        return;
+    }
+    for (t = 0; t < perf_num_threads; t++) {
+        uint64_t values[PERF_NUM_COUNTERS];
+        for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+            uint64_t end = perf_read(perf_fds[t][c]);
+            if (end == PERF_UNAVAILABLE ||
+                perf_start[t][c] == PERF_UNAVAILABLE) {
+                values[c] = PERF_UNAVAILABLE;
+                continue;
+            }
+            values[c] = end - perf_start[t][c];
+            totals[c] = totals[c] == PERF_UNAVAILABLE ? values[c]
+                                                      : totals[c] + values[c];
+        }
+        if (perf_num_threads > 1) {
+            perf_print(t, name, values);
+        }
+    }
+    perf_print(-1, name, totals);
+}
+
+/**
+ * @brief Close the counters
+ */
+void perf_free() {
+    if (!perf_on) {
+        return;
+    }
+    int t, c;
+    for (t = 0; t < perf_num_threads; t++) {
+        for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+            if (perf_fds[t][c] >= 0) {
+                close(perf_fds[t][c]);
+            }
+        }
+    }
+    free(perf_fds);
+    free(perf_start);
+    perf_fds = NULL;
+    perf_start = NULL;
+    perf_on = false;
+}
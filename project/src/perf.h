@@ -0,0 +1,86 @@
+/**
+ * @file perf.h
+ * @brief Hardware performance counters of the phases of the program
+ *
+ * Every OpenMP thread of the process opens its own set of counters with
+ * perf_event_open, counting user-space events only. The counters are read by
+ * the main thread at the beginning and at the end of every phase, so the
+ * values of a phase are the sum of the events of all the threads of the
+ * OpenMP pool while the phase was running.
+ *
+ * When a counter can't be opened (no PMU, containers, perf_event_paranoid)
+ * its value is reported as n/a and the program runs normally.
+ */
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Value of a counter that is not available
+ */
+#define PERF_UNAVAILABLE UINT64_MAX
+
+/**
+ * @brief Hardware events counted in every phase
+ */
+typedef enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_BRANCH_MISSES,
+    /**
+     * @brief Number of counters
+     */
+    PERF_NUM_COUNTERS
+} PerfCounter;
+
+/**
+ * @brief Open the counters on the threads of the OpenMP pool. Must be called
+ * by the main thread, outside of any parallel region.
+ *
+ * @param rank Rank of the current process
+ * @param num_threads Number of threads of the parallel regions of the program
+ * @param enabled Whether to collect the counters, if false all the other
+ * functions do nothing
+ */
+void perf_init(int rank, int num_threads, bool enabled);
+
+/**
+ * @brief Whether the counters are collected
+ *
+ * @return true if perf_init() has been called with enabled
+ */
+bool perf_enabled();
+
+/**
+ * @brief Name of a counter
+ *
+ * @param counter The counter
+ * @return The name of the counter, as printed in the log
+ */
+const char *perf_counter_name(PerfCounter counter);
+
+/**
+ * @brief Start counting the events of a phase
+ */
+void perf_phase_begin();
+
+/**
+ * @brief Stop counting the events of the current phase and print them on
+ * stderr, for every thread and summed over the threads
+ *
+ * @param name Name of the phase
+ * @param totals Where to store the values summed over the threads, set to
+ * PERF_UNAVAILABLE for the counters that are not available
+ */
+void perf_phase_end(const char *name, uint64_t totals[PERF_NUM_COUNTERS]);
+
+/**
+ * @brief Close the counters
+ */
+void perf_free();
+
+#endif
@@ -0,0 +1,141 @@
+#include "plan.h"
+#include "itemset_map.h"
+#include "tree.h"
+#include <inttypes.h>
+#include <mpi.h>
+#include <stdio.h>
+
+/**
+ * @brief Collect the statistics of the transactions of all the processes.
+ * The sample is made of evenly spaced transactions of every process.
+ *
+ * @param transactions The transactions of the current process
+ * @param index_map Map from the frequent items to their id
+ * @param items_count The frequent items with their support
+ * @param num_items Number of frequent items
+ * @param num_global_transactions Number of transactions of all the processes
+ * @param distinct_items Number of distinct items, on process 0
+ * @param world_size Number of processes
+ * @param stats Where to store the statistics, the same on every process
+ */
+void plan_collect_stats(TransactionsList transactions, IndexMap index_map,
+                        hashmap_element *items_count, int num_items,
+                        uint64_t num_global_transactions,
+                        uint64_t distinct_items, int world_size,
+                        PlanStats *stats) {
+    size_t n_transactions = cvector_size(transactions), t;
+    uint64_t local[5] = {0, 0, 0, 0, 0};
+    for (t = 0; t < n_transactions; t++) {
+        local[0] += cvector_size(transactions[t]);
+    }
+
+    size_t sample_size = PLAN_SAMPLE_SIZE / world_size;
+    size_t step = n_transactions / (sample_size == 0 ? 1 : sample_size);
+    step = step == 0 ? 1 : step;
+    Tree tree = tree_new();
+    ItemsetMap *distinct = itemset_map_new();
+    cvector_vector_type(int) keys = NULL;
+    for (t = 0; t < n_transactions && local[1] < sample_size; t += step) {
+        cvector_set_size(keys, 0);
+        transaction_get_keys(transactions[t], index_map, &keys);
+        int n_keys = cvector_size(keys);
+        if (n_keys > 0) {
+            tree_add_transaction(&tree, keys, n_keys, 1, false);
+            itemset_map_increment(distinct, keys, n_keys, 1);
+        }
+        local[1]++;
+        local[3] += n_keys;
+    }
+    local[2] = itemset_map_length(distinct);
+    local[4] = cvector_size(tree) - 1;
+    cvector_free(keys);
+    itemset_map_free(distinct);
+    tree_free(&tree);
+
+    uint64_t global[5];
+    MPI_Allreduce(local, global, 5, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Bcast(&distinct_items, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    stats->num_transactions = num_global_transactions;
+    stats->occurrences = global[0];
+    stats->distinct_items = distinct_items;
+    stats->frequent_items = num_items;
+    stats->frequent_occurrences = 0;
+    int i;
+    for (i = 0; i < num_items; i++) {
+        stats->frequent_occurrences += items_count[i].value;
+    }
+    stats->sample_size = global[1];
+    stats->sample_distinct = global[2];
+    stats->sample_occurrences = global[3];
+    stats->sample_nodes = global[4];
+}
+
+/**
+ * @brief Choose the layout of the tree and the mining engine.
+ *
+ * The transactions are deduplicated when the sample has few distinct ones.
+ * The global tree is estimated to have as many nodes per frequent item as
+ * the tree of the sample, an upper bound as the tree compresses better
+ * with more transactions. FP-growth visits the ancestors of every node to
+ * build the conditional trees of the items, so it costs about the nodes
+ * times the average number of frequent items of a transaction; Eclat
+ * intersects the bitsets of every pair of frequent items, so it costs the
+ * pairs times the words of a bitset, weighted by PLAN_WORD_COST. Eclat is
+ * chosen if it is cheaper and its database fits in PLAN_ECLAT_MAX_BYTES.
+ *
+ * @param stats The statistics of the transactions
+ * @param plan Where to store the choices
+ */
+void plan_choose(PlanStats *stats, Plan *plan) {
+    double n = stats->num_transactions, k = stats->frequent_items;
+    plan->density = n > 0 && k > 0 ? stats->frequent_occurrences / (n * k) : 0;
+    plan->compression = stats->sample_occurrences > 0
+                            ? (double)stats->sample_nodes /
+                                  stats->sample_occurrences
+                            : 1;
+    plan->distinct_ratio =
+        stats->sample_size > 0
+            ? (double)stats->sample_distinct / stats->sample_size
+            : 1;
+    plan->dedup = plan->distinct_ratio < PLAN_DEDUP_RATIO;
+
+    plan->tree_nodes = plan->compression * stats->frequent_occurrences;
+    double length = n > 0 ? stats->frequent_occurrences / n : 0;
+    plan->fpgrowth_cost = plan->tree_nodes * (length > 1 ? length : 1);
+    uint64_t num_words = (stats->num_transactions + 63) / 64;
+    plan->eclat_cost = PLAN_WORD_COST * k * (k - 1) / 2 * num_words;
+    plan->eclat_bytes = stats->frequent_items * num_words * sizeof(uint64_t);
+    plan->engine = plan->eclat_cost < plan->fpgrowth_cost &&
+                           plan->eclat_bytes <= PLAN_ECLAT_MAX_BYTES
+                       ? MINE_ENGINE_ECLAT
+                       : MINE_ENGINE_FPGROWTH;
+}
+
+/**
+ * @brief Print the statistics and the choices on process 0
+ *
+ * @param rank Rank of the current process
+ * @param stats The statistics of the transactions
+ * @param plan The choices
+ */
+void plan_log(int rank, PlanStats *stats, Plan *plan) {
+    if (rank != 0) {
+        return;
+    }
+    double n = stats->num_transactions > 0 ? stats->num_transactions : 1;
+    fprintf(stderr,
+            "plan_stats: transactions %" PRIu64 ", avg_length %lf, "
+            "distinct_items %" PRIu64 ", frequent_items %" PRIu64
+            ", density %lf, sample %" PRIu64 ", "
+            "distinct_ratio %lf, compression %lf\n",
+            stats->num_transactions, stats->occurrences / n,
+            stats->distinct_items, stats->frequent_items, plan->density,
+            stats->sample_size, plan->distinct_ratio, plan->compression);
+    fprintf(stderr,
+            "plan: dedup %s, engine %s, tree_nodes %.0lf, fpgrowth_cost "
+            "%.0lf, eclat_cost %.0lf, eclat_bytes %" PRIu64 "\n",
+            plan->dedup ? "yes" : "no",
+            plan->engine == MINE_ENGINE_ECLAT ? "eclat" : "fpgrowth",
+            plan->tree_nodes, plan->fpgrowth_cost, plan->eclat_cost,
+            plan->eclat_bytes);
+}
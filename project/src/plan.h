@@ -0,0 +1,167 @@
+/**
+ * @file plan.h
+ * @brief Choice of the layout of the tree and of the mining engine from
+ * cheap statistics of the dataset
+ *
+ */
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "mine.h"
+#include "types.h"
+#include <stdint.h>
+
+/**
+ * @brief Number of transactions, over all the processes, of the sample used
+ * to estimate the compression of the tree and the fraction of distinct
+ * transactions
+ */
+#define PLAN_SAMPLE_SIZE 4096
+/**
+ * @brief Maximum fraction of distinct transactions in the sample for which
+ * the transactions are deduplicated before building the tree
+ */
+#define PLAN_DEDUP_RATIO 0.5
+/**
+ * @brief Cost of an operation on a 64-bit word of a bitset, relative to the
+ * visit of a node of the tree
+ */
+#define PLAN_WORD_COST 0.25
+/**
+ * @brief Maximum number of bytes of the vertical database of every process
+ * for which Eclat can be chosen
+ */
+#define PLAN_ECLAT_MAX_BYTES (1UL << 30)
+
+/**
+ * @brief Statistics of the transactions of all the processes
+ */
+typedef struct PlanStats {
+    uint64_t num_transactions;
+    /**
+     * @brief Number of items of all the transactions
+     */
+    uint64_t occurrences;
+    /**
+     * @brief Number of distinct items, an upper bound with the sketch, see
+     * @see get_global_map()
+     */
+    uint64_t distinct_items;
+    /**
+     * @brief Number of frequent items
+     */
+    uint64_t frequent_items;
+    /**
+     * @brief Number of frequent items of all the transactions
+     */
+    uint64_t frequent_occurrences;
+    /**
+     * @brief Number of transactions of the sample
+     */
+    uint64_t sample_size;
+    /**
+     * @brief Number of distinct transactions of the sample, considering the
+     * frequent items only
+     */
+    uint64_t sample_distinct;
+    /**
+     * @brief Number of frequent items of the transactions of the sample
+     */
+    uint64_t sample_occurrences;
+    /**
+     * @brief Number of nodes of the trees of the samples, the roots excluded
+     */
+    uint64_t sample_nodes;
+} PlanStats;
+
+/**
+ * @brief The choices of the planner, with the estimates they come from
+ */
+typedef struct Plan {
+    /**
+     * @brief Whether to collapse identical transactions before building the
+     * tree
+     */
+    bool dedup;
+    /**
+     * @brief The mining engine, never MINE_ENGINE_AUTO
+     */
+    MineEngine engine;
+    /**
+     * @brief Fraction of the pairs (transaction, frequent item) present
+     */
+    double density;
+    /**
+     * @brief Nodes of the tree of the sample per frequent item of its
+     * transactions, 1 when no prefix is shared
+     */
+    double compression;
+    /**
+     * @brief Fraction of distinct transactions in the sample
+     */
+    double distinct_ratio;
+    /**
+     * @brief Estimated number of nodes of the global tree
+     */
+    double tree_nodes;
+    /**
+     * @brief Estimated cost of FP-growth, in visits of nodes
+     */
+    double fpgrowth_cost;
+    /**
+     * @brief Estimated cost of Eclat, in visits of nodes
+     */
+    double eclat_cost;
+    /**
+     * @brief Bytes of the vertical database of every process
+     */
+    uint64_t eclat_bytes;
+} Plan;
+
+/**
+ * @brief Collect the statistics of the transactions of all the processes.
+ * The sample is made of evenly spaced transactions of every process.
+ *
+ * @param transactions The transactions of the current process
+ * @param index_map Map from the frequent items to their id
+ * @param items_count The frequent items with their support
+ * @param num_items Number of frequent items
+ * @param num_global_transactions Number of transactions of all the processes
+ * @param distinct_items Number of distinct items, on process 0
+ * @param world_size Number of processes
+ * @param stats Where to store the statistics, the same on every process
+ */
+void plan_collect_stats(TransactionsList transactions, IndexMap index_map,
+                        hashmap_element *items_count, int num_items,
+                        uint64_t num_global_transactions,
+                        uint64_t distinct_items, int world_size,
+                        PlanStats *stats);
+
+/**
+ * @brief Choose the layout of the tree and the mining engine.
+ *
+ * The transactions are deduplicated when the sample has few distinct ones.
+ * The global tree is estimated to have as many nodes per frequent item as
+ * the tree of the sample, an upper bound as the tree compresses better
+ * with more transactions. FP-growth visits the ancestors of every node to
+ * build the conditional trees of the items, so it costs about the nodes
+ * times the average number of frequent items of a transaction; Eclat
+ * intersects the bitsets of every pair of frequent items, so it costs the
+ * pairs times the words of a bitset, weighted by PLAN_WORD_COST. Eclat is
+ * chosen if it is cheaper and its database fits in PLAN_ECLAT_MAX_BYTES.
+ *
+ * @param stats The statistics of the transactions
+ * @param plan Where to store the choices
+ */
+void plan_choose(PlanStats *stats, Plan *plan);
+
+/**
+ * @brief Print the statistics and the choices on process 0
+ *
+ * @param rank Rank of the current process
+ * @param stats The statistics of the transactions
+ * @param plan The choices
+ */
+void plan_log(int rank, PlanStats *stats, Plan *plan);
+
+#endif
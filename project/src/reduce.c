@@ -1,6 +1,234 @@
 #include "reduce.h"
+#include "dedup.h"
+#include "memory.h"
+#include "sort.h"
+#include "trace.h"
 #include "utils.h"
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Number of elements of the given datatype that fit in a block of
+ * MPI_BLOCK_BYTES bytes
+ *
+ * @param datatype MPI datatype of the elements
+ * @return Number of elements per block
+ */
+static uint64_t block_count(MPI_Datatype datatype) {
+    MPI_Aint lower_bound, extent;
+    MPI_Type_get_extent(datatype, &lower_bound, &extent);
+    return max(1, MPI_BLOCK_BYTES / extent);
+}
+
+/**
+ * @brief Send a buffer of count elements of the given datatype, splitting it
+ * in blocks of at most MPI_BLOCK_BYTES bytes
+ *
+ * @param buffer The buffer to send
+ * @param count Number of elements in the buffer
+ * @param datatype MPI datatype of the elements
+ * @param dest The rank of the MPI process that will receive the buffer
+ */
+void send_buffer(void *buffer, uint64_t count, MPI_Datatype datatype,
+                 int dest) {
+    MPI_Aint lower_bound, extent;
+    MPI_Type_get_extent(datatype, &lower_bound, &extent);
+    uint64_t block = block_count(datatype);
+    uint64_t done;
+    for (done = 0; done < count; done += block) {
+        int size = (int)min64(block, count - done);
+        MPI_Send((char *)buffer + done * extent, size, datatype, dest, 0,
+                 MPI_COMM_WORLD);
+    }
+    trace_count(TRACE_BYTES_SENT, count * extent);
+    memory_track_buffer(count * extent);
+}
+
+/**
+ * @brief Receive a buffer of count elements of the given datatype, sent with
+ * @see send_buffer()
+ *
+ * @param buffer The buffer where to store the received elements
+ * @param count Number of elements to receive
+ * @param datatype MPI datatype of the elements
+ * @param source The rank of the MPI process that sends the buffer
+ */
+void recv_buffer(void *buffer, uint64_t count, MPI_Datatype datatype,
+                 int source) {
+    MPI_Aint lower_bound, extent;
+    MPI_Type_get_extent(datatype, &lower_bound, &extent);
+    uint64_t block = block_count(datatype);
+    uint64_t done;
+    for (done = 0; done < count; done += block) {
+        int size = (int)min64(block, count - done);
+        MPI_Recv((char *)buffer + done * extent, size, datatype, source, 0,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+    trace_count(TRACE_BYTES_RECV, count * extent);
+    memory_track_buffer(count * extent);
+}
+
+/**
+ * @brief Broadcast a buffer of count elements of the given datatype from
+ * process 0, splitting it in blocks of at most MPI_BLOCK_BYTES bytes
+ *
+ * @param buffer The buffer to broadcast on process 0, where to store the
+ * received elements on the other processes
+ * @param count Number of elements in the buffer
+ * @param datatype MPI datatype of the elements
+ */
+void broadcast_buffer(void *buffer, uint64_t count, MPI_Datatype datatype) {
+    MPI_Aint lower_bound, extent;
+    MPI_Type_get_extent(datatype, &lower_bound, &extent);
+    uint64_t block = block_count(datatype);
+    uint64_t done;
+    for (done = 0; done < count; done += block) {
+        int size = (int)min64(block, count - done);
+        MPI_Bcast((char *)buffer + done * extent, size, datatype, 0,
+                  MPI_COMM_WORLD);
+    }
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    trace_count(rank == 0 ? TRACE_BYTES_SENT : TRACE_BYTES_RECV,
+                count * extent);
+    memory_track_buffer(count * extent);
+}
+
+/**
+ * @brief Send a buffer to a process while receiving another buffer from a
+ * (possibly different) process, splitting both in blocks of at most
+ * MPI_BLOCK_BYTES bytes
+ *
+ * @param send The buffer to send
+ * @param send_count Number of elements to send
+ * @param dest The rank of the MPI process that will receive the buffer
+ * @param recv The buffer where to store the received elements
+ * @param recv_count Number of elements to receive
+ * @param source The rank of the MPI process that sends the buffer
+ * @param datatype MPI datatype of the elements
+ */
+void sendrecv_buffer(void *send, uint64_t send_count, int dest, void *recv,
+                     uint64_t recv_count, int source, MPI_Datatype datatype) {
+    MPI_Aint lower_bound, extent;
+    MPI_Type_get_extent(datatype, &lower_bound, &extent);
+    uint64_t block = block_count(datatype);
+    uint64_t total = max64(send_count, recv_count);
+    uint64_t done;
+    for (done = 0; done < total; done += block) {
+        // a side that has nothing left to move talks to MPI_PROC_NULL
+        int send_size = done < send_count ? min64(block, send_count - done) : 0;
+        int recv_size = done < recv_count ? min64(block, recv_count - done) : 0;
+        MPI_Sendrecv((char *)send + done * extent, send_size, datatype,
+                     send_size > 0 ? dest : MPI_PROC_NULL, 0,
+                     (char *)recv + done * extent, recv_size, datatype,
+                     recv_size > 0 ? source : MPI_PROC_NULL, 0,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+    trace_count(TRACE_BYTES_SENT, send_count * extent);
+    trace_count(TRACE_BYTES_RECV, recv_count * extent);
+    memory_track_buffer(send_count * extent);
+    memory_track_buffer(recv_count * extent);
+}
+
+/**
+ * @brief Gather the buffers of all the processes on process 0, one after the
+ * other in rank order, moving them in blocks of at most MPI_BLOCK_BYTES
+ * bytes
+ *
+ * @param send The buffer of the current process
+ * @param send_count Number of elements of the buffer
+ * @param recv Where process 0 stores the buffers, allocated with malloc and
+ * to be freed by the caller; NULL on the other processes
+ * @param recv_count Where process 0 stores the number of elements of all the
+ * buffers, 0 on the other processes
+ * @param datatype MPI datatype of the elements
+ */
+void gather_buffer(void *send, uint64_t send_count, void **recv,
+                   uint64_t *recv_count, MPI_Datatype datatype) {
+    MPI_Aint lower_bound, extent;
+    MPI_Type_get_extent(datatype, &lower_bound, &extent);
+    int rank, world_size, r;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    uint64_t *counts = NULL;
+    if (rank == 0) {
+        counts = (uint64_t *)malloc(world_size * sizeof(uint64_t));
+        assert(counts != NULL);
+    }
+    MPI_Gather(&send_count, 1, MPI_UINT64_T, counts, 1, MPI_UINT64_T, 0,
+               MPI_COMM_WORLD);
+    *recv = NULL;
+    *recv_count = 0;
+    if (rank != 0) {
+        send_buffer(send, send_count, datatype, 0);
+        return;
+    }
+    uint64_t total = 0;
+    for (r = 0; r < world_size; r++) {
+        total += counts[r];
+    }
+    char *all = (char *)malloc(total * extent + 1);
+    assert(all != NULL);
+    memcpy(all, send, send_count * extent);
+    uint64_t offset = send_count;
+    for (r = 1; r < world_size; r++) {
+        recv_buffer(all + offset * extent, counts[r], datatype, r);
+        offset += counts[r];
+    }
+    free(counts);
+    *recv = all;
+    *recv_count = total;
+}
+
+/**
+ * @brief Gather the buffers of all the processes on every process, one after
+ * the other in rank order. The buffers go around a ring of the processes,
+ * moved with @see sendrecv_buffer(), so no MPI call takes more than
+ * MPI_BLOCK_BYTES bytes.
+ *
+ * @param send The buffer of the current process
+ * @param send_count Number of elements of the buffer
+ * @param recv Where to store the buffers, allocated with malloc and to be
+ * freed by the caller
+ * @param recv_count Where to store the number of elements of all the buffers
+ * @param datatype MPI datatype of the elements
+ */
+void allgather_buffer(void *send, uint64_t send_count, void **recv,
+                      uint64_t *recv_count, MPI_Datatype datatype) {
+    MPI_Aint lower_bound, extent;
+    MPI_Type_get_extent(datatype, &lower_bound, &extent);
+    int rank, world_size, step;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    uint64_t *counts = (uint64_t *)malloc(world_size * sizeof(uint64_t));
+    uint64_t *displs = (uint64_t *)malloc(world_size * sizeof(uint64_t));
+    assert(counts != NULL && displs != NULL);
+    MPI_Allgather(&send_count, 1, MPI_UINT64_T, counts, 1, MPI_UINT64_T,
+                  MPI_COMM_WORLD);
+    uint64_t total = 0;
+    for (step = 0; step < world_size; step++) {
+        displs[step] = total;
+        total += counts[step];
+    }
+    char *all = (char *)malloc(total * extent + 1);
+    assert(all != NULL);
+    memcpy(all + displs[rank] * extent, send, send_count * extent);
+    // at every step a process passes on the buffer it received last
+    int next = (rank + 1) % world_size;
+    int prev = (rank - 1 + world_size) % world_size;
+    for (step = 1; step < world_size; step++) {
+        int out = (rank - step + 1 + world_size) % world_size;
+        int in = (rank - step + world_size) % world_size;
+        sendrecv_buffer(all + displs[out] * extent, counts[out], next,
+                        all + displs[in] * extent, counts[in], prev,
+                        datatype);
+    }
+    free(counts);
+    free(displs);
+    *recv = all;
+    *recv_count = total;
+}
 
 /**
  * @brief Define a datatype for an hashmap element in order to be able to send
@@ -67,8 +295,9 @@ MPI_Datatype define_datatype_tree_node() {
  * @param elements The array of hashmap elements to merge
  * @param size The size of the elements array
  */
-void merge_map(SupportMap *support_map, hashmap_element *elements, int size) {
-    int i;
+void merge_map(SupportMap *support_map, hashmap_element *elements,
+               uint64_t size) {
+    uint64_t i;
 
     for (i = 0; i < size; i++) {
         hashmap_increment(*support_map, elements[i].key, elements[i].key_length,
@@ -93,18 +322,19 @@ void merge_map(SupportMap *support_map, hashmap_element *elements, int size) {
 void recv_map(int rank, int world_size, int source, SupportMap *support_map,
               MPI_Datatype DT_HASHMAP_ELEMENT) {
 
-    int size;
+    uint64_t size;
     MPI_Status status;
 
-    MPI_Recv(&size, 1, MPI_INT, source, 0, MPI_COMM_WORLD, &status);
+    trace_begin("recv_map");
+    MPI_Recv(&size, 1, MPI_UINT64_T, source, 0, MPI_COMM_WORLD, &status);
     hashmap_element *elements =
         (hashmap_element *)malloc(size * sizeof(hashmap_element));
 
-    MPI_Recv(elements, size, DT_HASHMAP_ELEMENT, source, 0, MPI_COMM_WORLD,
-             MPI_STATUS_IGNORE);
+    recv_buffer(elements, size, DT_HASHMAP_ELEMENT, source);
 
     merge_map(support_map, elements, size);
     free(elements);
+    trace_end();
 }
 
 /**
@@ -121,20 +351,38 @@ void recv_map(int rank, int world_size, int source, SupportMap *support_map,
  * stored
  * @param DT_HASHMAP_ELEMENT An MPI datatype that describes the data structure
  * that has to be sent with MPI
+ * @param sketch The sketch of the global supports, the items whose estimate
+ * is below min_support are not sent; NULL to send all the items
+ * @param min_support The mininum support that an item has to have in order to
+ * be contained in the final map
  */
 void send_map(int rank, int world_size, int dest, SupportMap *support_map,
-              MPI_Datatype DT_HASHMAP_ELEMENT) {
+              MPI_Datatype DT_HASHMAP_ELEMENT, CountMinSketch *sketch,
+              int min_support) {
 
-    int size = hashmap_length(*support_map);
+    trace_begin("send_map");
+    uint64_t size = hashmap_length(*support_map);
     cvector_vector_type(hashmap_element) elements = NULL;
 
     hashmap_get_elements(*support_map, &elements);
+    if (sketch != NULL) {
+        // the items that cannot be frequent are not needed
+        uint64_t i, kept = 0;
+        for (i = 0; i < size; i++) {
+            if (sketch_estimate(sketch, elements[i].key,
+                                elements[i].key_length) >=
+                (uint64_t)min_support)
+                elements[kept++] = elements[i];
+        }
+        size = kept;
+    }
     // send size
-    MPI_Send(&size, 1, MPI_INT, dest, 0, MPI_COMM_WORLD);
+    MPI_Send(&size, 1, MPI_UINT64_T, dest, 0, MPI_COMM_WORLD);
     // send buffer
-    MPI_Send(elements, size, DT_HASHMAP_ELEMENT, dest, 0, MPI_COMM_WORLD);
+    send_buffer(elements, size, DT_HASHMAP_ELEMENT, dest);
 
     cvector_free(elements);
+    trace_end();
 }
 
 /**
@@ -161,18 +409,22 @@ void broadcast_map(int rank, int world_size, SupportMap *support_map,
     if (rank == 0) {
         cvector_vector_type(hashmap_element) elements = NULL;
         hashmap_get_elements_with_support(*support_map, &elements, min_support);
-        int size = cvector_size(elements);
-        MPI_Bcast(&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
-        MPI_Bcast(elements, size, DT_HASHMAP_ELEMENT, 0, MPI_COMM_WORLD);
+        uint64_t size = cvector_size(elements);
+        MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        broadcast_buffer(elements, size, DT_HASHMAP_ELEMENT);
         *items_count = elements;
+        // the items get int ids
+        assert(size <= INT_MAX);
         *num_items = size;
     } else {
-        int size;
-        MPI_Bcast(&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        uint64_t size;
+        MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
         hashmap_element *elements =
             (hashmap_element *)malloc(size * sizeof(hashmap_element));
-        MPI_Bcast(elements, size, DT_HASHMAP_ELEMENT, 0, MPI_COMM_WORLD);
+        assert(size == 0 || elements != NULL);
+        broadcast_buffer(elements, size, DT_HASHMAP_ELEMENT);
         *items_count = elements;
+        assert(size <= INT_MAX);
         *num_items = size;
     }
 }
@@ -191,6 +443,11 @@ void broadcast_map(int rank, int world_size, SupportMap *support_map,
  * state, it means that process 0 now has the complete map of every process and
  * can broadcast its knowledge to the whole domain.
  *
+ * If sketch_width is not 0, the processes first sum a Count-Min sketch of
+ * their supports, see @see sketch_allreduce(), and the items whose estimate
+ * is below min_support, which cannot be frequent, are not sent. The final map
+ * is the same, as an estimate is never lower than the support.
+ *
  * @param rank The rank of the process that broadcasts the data
  * @param world_size The number of MPI processes in the world
  * @param support_map The map from which to extract the elements to be sent
@@ -200,12 +457,35 @@ void broadcast_map(int rank, int world_size, SupportMap *support_map,
  * in the broadcasted map
  * @param min_support The mininum support that an item has to have in order to
  * be contained in the final map
+ * @param sketch_width Number of counters of every row of the sketch, 0 to
+ * send all the items
+ * @param distinct_items Where process 0 stores the number of distinct items
+ * of all the processes, NULL if not needed. With the sketch, the items not
+ * sent are counted once per process that has them, so it is an upper bound
  */
 void get_global_map(int rank, int world_size, SupportMap *support_map,
                     hashmap_element **items_count, int *num_items,
-                    int min_support) {
+                    int min_support, int sketch_width,
+                    uint64_t *distinct_items) {
 
     MPI_Datatype DT_HASHMAP_ELEMENT = define_datatype_hashmap_element();
+    CountMinSketch sketch;
+    if (sketch_width > 0) {
+        trace_begin("sketch");
+        sketch_init(&sketch, sketch_width);
+        sketch_add_map(&sketch, *support_map);
+        sketch_allreduce(&sketch);
+        trace_end();
+    }
+    // the items not sent never reach process 0, they are counted here
+    uint64_t dropped = 0;
+    if (sketch_width > 0 && distinct_items != NULL) {
+        uint64_t local_dropped =
+            hashmap_length(*support_map) -
+            sketch_count_reaching(&sketch, *support_map, min_support);
+        MPI_Reduce(&local_dropped, &dropped, 1, MPI_UINT64_T, MPI_SUM, 0,
+                   MPI_COMM_WORLD);
+    }
     int pow;
     bool sent = false;
     for (pow = 2; pow < 2 * world_size && !sent; pow *= 2) {
@@ -218,10 +498,20 @@ void get_global_map(int rank, int world_size, SupportMap *support_map,
             }
         } else {
             int dest = rank - pow / 2;
-            send_map(rank, world_size, dest, support_map, DT_HASHMAP_ELEMENT);
+            send_map(rank, world_size, dest, support_map, DT_HASHMAP_ELEMENT,
+                     sketch_width > 0 ? &sketch : NULL, min_support);
             sent = true;
         }
     }
+    if (distinct_items != NULL && rank == 0) {
+        *distinct_items =
+            sketch_width > 0
+                ? sketch_count_reaching(&sketch, *support_map, min_support) +
+                      dropped
+                : (uint64_t)hashmap_length(*support_map);
+    }
+    if (sketch_width > 0)
+        sketch_free(&sketch);
 
     /** REINITIALIZE MAP TO HAVE ELEMENTS IN THE SAME ORDER AS OTHER PROCESSES
      * **/
@@ -262,11 +552,9 @@ void merge_indices(int rank, int *sorted_indices, int start1, int end1,
     int i = 0, j, i1 = start1, i2 = start2;
 
     while (i1 <= end1 && i2 <= end2) {
-        int v1 = items_count[sorted_indices[i1]].value;
-        int v2 = items_count[sorted_indices[i2]].value;
-
         assert(i < tot_size);
-        if (v1 < v2) {
+        if (item_compare(&items_count[sorted_indices[i1]],
+                         &items_count[sorted_indices[i2]]) < 0) {
             tmp[i] = sorted_indices[i1];
             i1++;
         } else {
@@ -316,13 +604,16 @@ void recv_indices(int rank, int source, int *sorted_indices, int start,
 
     MPI_Status status;
 
+    trace_begin("recv_indices");
     int position = min(num_items, source * length);
     MPI_Recv(sorted_indices + position, size, MPI_INT, source, 0,
              MPI_COMM_WORLD, &status);
     MPI_Get_count(&status, MPI_INT, &size);
+    trace_count(TRACE_BYTES_RECV, size * sizeof(int));
     merge_indices(rank, sorted_indices, start, *end, position,
                   position + size - 1, items_count, num_items);
     *end = position + size - 1;
+    trace_end();
 }
 
 /**
@@ -343,6 +634,7 @@ void send_indices(int rank, int dest, int *sorted_indices, int start, int end,
     assert(size >= 0);
     // send buffer
     MPI_Send(sorted_indices + start, size, MPI_INT, dest, 0, MPI_COMM_WORLD);
+    trace_count(TRACE_BYTES_SENT, size * sizeof(int));
 }
 
 /**
@@ -415,9 +707,9 @@ void get_sorted_indices(int rank, int world_size, int *sorted_indices,
  * @param num_nodes The size of the nodes array
  * @param dest A pointer to the tree that will be created
  */
-void parse_tree(TreeNodeToSend *nodes, int num_nodes, Tree *dest) {
+void parse_tree(TreeNodeToSend *nodes, size_t num_nodes, Tree *dest) {
     *dest = tree_new();
-    for (int i = 1; i < num_nodes; i++) {
+    for (size_t i = 1; i < num_nodes; i++) {
         TreeNode *node =
             tree_node_new(nodes[i].key, nodes[i].value, nodes[i].parent);
         tree_add_node(dest, node);
@@ -432,18 +724,20 @@ void parse_tree(TreeNodeToSend *nodes, int num_nodes, Tree *dest) {
  * @param DT_TREE_NODE MPI_Datatype describing a TreeNode
  */
 void send_tree(int dest, Tree *tree, MPI_Datatype DT_TREE_NODE) {
-    int size = cvector_size((*tree));
+    trace_begin("send_tree");
     cvector_vector_type(TreeNodeToSend) nodes = NULL;
 
     tree_get_nodes(*tree, &nodes);
     tree_free(tree);
+    uint64_t size = cvector_size(nodes);
 
     // send size
-    MPI_Send(&size, 1, MPI_INT, dest, 0, MPI_COMM_WORLD);
+    MPI_Send(&size, 1, MPI_UINT64_T, dest, 0, MPI_COMM_WORLD);
     // send buffer
-    MPI_Send(nodes, size, DT_TREE_NODE, dest, 0, MPI_COMM_WORLD);
+    send_buffer(nodes, size, DT_TREE_NODE, dest);
 
     cvector_free(nodes);
+    trace_end();
 }
 
 /**
@@ -453,23 +747,77 @@ void send_tree(int dest, Tree *tree, MPI_Datatype DT_TREE_NODE) {
  * @param tree A pointer to partial tree of the current process, which will be
  * integrated by merging the received tree
  * @param DT_TREE_NODE MPI_Datatype describing a TreeNode
+ * @param num_threads The number of threads requested to merge the trees
  */
-void recv_tree(int source, Tree *tree, MPI_Datatype DT_TREE_NODE) {
+void recv_tree(int source, Tree *tree, MPI_Datatype DT_TREE_NODE,
+               int num_threads) {
 
-    int size;
+    uint64_t size;
     MPI_Status status;
-    MPI_Recv(&size, 1, MPI_INT, source, 0, MPI_COMM_WORLD, &status);
+    trace_begin("recv_tree");
+    MPI_Recv(&size, 1, MPI_UINT64_T, source, 0, MPI_COMM_WORLD, &status);
 
     TreeNodeToSend *nodes =
         (TreeNodeToSend *)malloc(size * sizeof(TreeNodeToSend));
 
-    MPI_Recv(nodes, size, DT_TREE_NODE, source, 0, MPI_COMM_WORLD,
-             MPI_STATUS_IGNORE);
+    recv_buffer(nodes, size, DT_TREE_NODE, source);
     Tree received_tree;
     parse_tree(nodes, size, &received_tree);
+    trace_end();
 
-    tree_merge(tree, received_tree);
+    trace_begin("merge trees");
+    tree_merge_parallel(tree, received_tree, num_threads);
+    tree_free(&received_tree);
     free(nodes);
+    trace_end();
+}
+
+/**
+ * @brief Send a tree to an MPI process with its chains compacted, see
+ * @see tree_get_chains(), and free up the memory
+ *
+ * @param dest The destination process that will receive the tree
+ * @param tree The tree that has to be sent
+ */
+void send_tree_chains(int dest, Tree *tree) {
+    trace_begin("send_tree");
+    cvector_vector_type(int) chains = NULL;
+    tree_get_chains(*tree, &chains);
+    tree_free(tree);
+    uint64_t size = cvector_size(chains);
+
+    // send size
+    MPI_Send(&size, 1, MPI_UINT64_T, dest, 0, MPI_COMM_WORLD);
+    // send buffer
+    send_buffer(chains, size, MPI_INT, dest);
+
+    cvector_free(chains);
+    trace_end();
+}
+
+/**
+ * @brief Receive a tree sent with @see send_tree_chains() and merge its
+ * records directly into the tree of the current process
+ *
+ * @param source The MPI process that is sending the data
+ * @param tree A pointer to partial tree of the current process, which will be
+ * integrated by merging the received tree
+ * @param num_threads The number of threads requested to merge the trees
+ */
+void recv_tree_chains(int source, Tree *tree, int num_threads) {
+    uint64_t size;
+    trace_begin("recv_tree");
+    MPI_Recv(&size, 1, MPI_UINT64_T, source, 0, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    int *chains = (int *)malloc(size * sizeof(int));
+    assert(size == 0 || chains != NULL);
+    recv_buffer(chains, size, MPI_INT, source);
+    trace_end();
+
+    trace_begin("merge trees");
+    tree_merge_chains(tree, chains, size, num_threads);
+    free(chains);
+    trace_end();
 }
 
 /**
@@ -483,22 +831,22 @@ void recv_tree(int source, Tree *tree, MPI_Datatype DT_TREE_NODE) {
 
 void broadcast_tree(int rank, Tree *tree, MPI_Datatype DT_TREE_NODE) {
     if (rank == 0) {
-        int size = cvector_size((*tree));
         cvector_vector_type(TreeNodeToSend) nodes = NULL;
         tree_get_nodes(*tree, &nodes);
+        uint64_t size = cvector_size(nodes);
         // send size
-        MPI_Bcast(&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
         // send buffer
-        MPI_Bcast(nodes, size, DT_TREE_NODE, 0, MPI_COMM_WORLD);
+        broadcast_buffer(nodes, size, DT_TREE_NODE);
 
         cvector_free(nodes);
     } else {
-        int size;
-        MPI_Bcast(&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        uint64_t size;
+        MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
         TreeNodeToSend *nodes =
             (TreeNodeToSend *)malloc(size * sizeof(TreeNodeToSend));
 
-        MPI_Bcast(nodes, size, DT_TREE_NODE, 0, MPI_COMM_WORLD);
+        broadcast_buffer(nodes, size, DT_TREE_NODE);
         Tree received_tree;
         parse_tree(nodes, size, &received_tree);
         *tree = received_tree;
@@ -507,6 +855,58 @@ void broadcast_tree(int rank, Tree *tree, MPI_Datatype DT_TREE_NODE) {
     }
 }
 
+/**
+ * @brief Broadcast the nodes of the final FP-Tree to every MPI process in the
+ * world, without rebuilding the tree on the receiving processes
+ *
+ * @param rank The rank of the current process
+ * @param tree The tree that has to be broadcasted in case the process rank is
+ * 0, ignored otherwise
+ * @param nodes Pointer to the vector where the nodes of the tree are stored
+ */
+void broadcast_tree_nodes(int rank, Tree tree,
+                          cvector_vector_type(TreeNodeToSend) * nodes) {
+    MPI_Datatype DT_TREE_NODE = define_datatype_tree_node();
+    uint64_t size = 0;
+    if (rank == 0) {
+        tree_get_nodes(tree, nodes);
+        size = cvector_size((*nodes));
+    }
+    MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    if (rank != 0) {
+        cvector_grow((*nodes), size);
+        cvector_set_size((*nodes), size);
+    }
+    broadcast_buffer(*nodes, size, DT_TREE_NODE);
+    MPI_Type_free(&DT_TREE_NODE);
+}
+
+/**
+ * @brief Broadcast the final FP-Tree to every MPI process in the world with
+ * its chains compacted, see @see tree_get_chains(), without rebuilding the
+ * tree on the receiving processes
+ *
+ * @param rank The rank of the current process
+ * @param tree The tree that has to be broadcasted in case the process rank is
+ * 0, ignored otherwise
+ * @param chains Pointer to the vector where the records of the tree are
+ * stored
+ */
+void broadcast_tree_chains(int rank, Tree tree,
+                           cvector_vector_type(int) * chains) {
+    uint64_t size = 0;
+    if (rank == 0) {
+        tree_get_chains(tree, chains);
+        size = cvector_size((*chains));
+    }
+    MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    if (rank != 0) {
+        cvector_grow((*chains), size + 1);
+        cvector_set_size((*chains), size);
+    }
+    broadcast_buffer(*chains, size, MPI_INT);
+}
+
 /**
  * @brief Get the global FP-tree on every MPI process
  *
@@ -526,9 +926,13 @@ void broadcast_tree(int rank, Tree *tree, MPI_Datatype DT_TREE_NODE) {
  * @param world_size The number of processes in the current world
  * @param tree The tree that has to be sent/received. This structure is heavily
  * manipulated during the execution of this function.
+ * @param num_threads The number of threads requested to merge the trees
+ * @param compact Whether the trees are compact, see @see TreeNode; they are
+ * sent with their chains compacted, see @see send_tree_chains()
  */
 
-void get_global_tree(int rank, int world_size, Tree *tree) {
+void get_global_tree(int rank, int world_size, Tree *tree, int num_threads,
+                     bool compact) {
     MPI_Datatype DT_TREE_NODE = define_datatype_tree_node();
     int pow;
     bool sent = false;
@@ -536,12 +940,17 @@ void get_global_tree(int rank, int world_size, Tree *tree) {
         if (rank % pow == 0) {
             // receive and merge
             int source = rank + pow / 2;
-            if (source < world_size) {
-                recv_tree(source, tree, DT_TREE_NODE);
+            if (source < world_size && compact) {
+                recv_tree_chains(source, tree, num_threads);
+            } else if (source < world_size) {
+                recv_tree(source, tree, DT_TREE_NODE, num_threads);
             }
         } else {
             int dest = rank - pow / 2;
-            send_tree(dest, tree, DT_TREE_NODE);
+            if (compact)
+                send_tree_chains(dest, tree);
+            else
+                send_tree(dest, tree, DT_TREE_NODE);
             sent = true;
         }
     }
@@ -549,4 +958,92 @@ void get_global_tree(int rank, int world_size, Tree *tree) {
     // broadcast_tree(rank, tree, DT_TREE_NODE);
 
     return;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Redistribute the weighted transactions among the MPI processes, so
+ * that identical transactions end up in the same process, and collapse them.
+ *
+ * Every transaction is assigned to the process given by its hash modulo the
+ * world size. The transactions are serialized as (length, weight, ids...)
+ * and exchanged pairwise, then the received ones are deduplicated.
+ *
+ * @param rank The rank of the current process
+ * @param world_size The number of processes in the current world
+ * @param transactions Pointer to the local list of weighted transactions,
+ * replaced by the list of transactions assigned to the current process
+ */
+void exchange_weighted_transactions(int rank, int world_size,
+                                    WeightedItemsetList *transactions) {
+    if (world_size == 1) {
+        return;
+    }
+    cvector_vector_type(int) *buffers = (cvector_vector_type(int) *)calloc(
+        world_size, sizeof(cvector_vector_type(int)));
+    size_t n_transactions = cvector_size((*transactions));
+    size_t i, j;
+    for (i = 0; i < n_transactions; i++) {
+        WeightedItemset *transaction = &((*transactions)[i]);
+        int n_items = cvector_size(transaction->items);
+        int dest = itemset_hash(transaction->items, n_items) % world_size;
+        cvector_push_back(buffers[dest], n_items);
+        cvector_push_back(buffers[dest], transaction->weight);
+        for (j = 0; j < n_items; j++) {
+            cvector_push_back(buffers[dest], transaction->items[j]);
+        }
+    }
+    weighted_itemsets_free(transactions);
+
+    uint64_t *send_counts = (uint64_t *)malloc(world_size * sizeof(uint64_t));
+    uint64_t *recv_counts = (uint64_t *)malloc(world_size * sizeof(uint64_t));
+    int p;
+    for (p = 0; p < world_size; p++) {
+        send_counts[p] = cvector_size(buffers[p]);
+    }
+    MPI_Alltoall(send_counts, 1, MPI_UINT64_T, recv_counts, 1, MPI_UINT64_T,
+                 MPI_COMM_WORLD);
+
+    // keep the transactions assigned to the current process
+    WeightedItemsetList received = NULL;
+    for (p = 0; p < world_size; p++) {
+        int *buffer;
+        uint64_t count;
+        if (p == 0) {
+            buffer = buffers[rank];
+            count = send_counts[rank];
+        } else {
+            // at round p, send to rank + p and receive from rank - p
+            int dest = (rank + p) % world_size;
+            int source = (rank - p + world_size) % world_size;
+            count = recv_counts[source];
+            buffer = (int *)malloc(count * sizeof(int));
+            assert(count == 0 || buffer != NULL);
+            sendrecv_buffer(buffers[dest], send_counts[dest], dest, buffer,
+                            count, source, MPI_INT);
+        }
+        uint64_t pos = 0;
+        while (pos < count) {
+            WeightedItemset transaction;
+            int n_items = buffer[pos];
+            transaction.weight = buffer[pos + 1];
+            transaction.items = NULL;
+            cvector_grow(transaction.items, n_items);
+            memcpy(transaction.items, buffer + pos + 2, n_items * sizeof(int));
+            cvector_set_size(transaction.items, n_items);
+            cvector_push_back(received, transaction);
+            pos += n_items + 2;
+        }
+        if (p != 0) {
+            free(buffer);
+        }
+    }
+    for (p = 0; p < world_size; p++) {
+        cvector_free(buffers[p]);
+    }
+    free(buffers);
+    free(send_counts);
+    free(recv_counts);
+
+    weighted_itemsets_dedup(&received);
+    *transactions = received;
+}
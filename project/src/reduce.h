@@ -7,9 +7,98 @@
 #define REDUCE_H
 
 #include "mpi.h"
+#include "sketch.h"
 #include "tree.h"
 #include "types.h"
 
+/**
+ * @brief Maximum number of bytes moved by a single MPI call. MPI counts are
+ * int, so larger buffers are transferred in blocks of at most this size.
+ */
+#define MPI_BLOCK_BYTES (1 << 30)
+
+/**
+ * @brief Send a buffer of count elements of the given datatype, splitting it
+ * in blocks of at most MPI_BLOCK_BYTES bytes
+ *
+ * @param buffer The buffer to send
+ * @param count Number of elements in the buffer
+ * @param datatype MPI datatype of the elements
+ * @param dest The rank of the MPI process that will receive the buffer
+ */
+void send_buffer(void *buffer, uint64_t count, MPI_Datatype datatype,
+                 int dest);
+
+/**
+ * @brief Receive a buffer of count elements of the given datatype, sent with
+ * @see send_buffer()
+ *
+ * @param buffer The buffer where to store the received elements
+ * @param count Number of elements to receive
+ * @param datatype MPI datatype of the elements
+ * @param source The rank of the MPI process that sends the buffer
+ */
+void recv_buffer(void *buffer, uint64_t count, MPI_Datatype datatype,
+                 int source);
+
+/**
+ * @brief Broadcast a buffer of count elements of the given datatype from
+ * process 0, splitting it in blocks of at most MPI_BLOCK_BYTES bytes
+ *
+ * @param buffer The buffer to broadcast on process 0, where to store the
+ * received elements on the other processes
+ * @param count Number of elements in the buffer
+ * @param datatype MPI datatype of the elements
+ */
+void broadcast_buffer(void *buffer, uint64_t count, MPI_Datatype datatype);
+
+/**
+ * @brief Send a buffer to a process while receiving another buffer from a
+ * (possibly different) process, splitting both in blocks of at most
+ * MPI_BLOCK_BYTES bytes
+ *
+ * @param send The buffer to send
+ * @param send_count Number of elements to send
+ * @param dest The rank of the MPI process that will receive the buffer
+ * @param recv The buffer where to store the received elements
+ * @param recv_count Number of elements to receive
+ * @param source The rank of the MPI process that sends the buffer
+ * @param datatype MPI datatype of the elements
+ */
+void sendrecv_buffer(void *send, uint64_t send_count, int dest, void *recv,
+                     uint64_t recv_count, int source, MPI_Datatype datatype);
+
+/**
+ * @brief Gather the buffers of all the processes on process 0, one after the
+ * other in rank order, moving them in blocks of at most MPI_BLOCK_BYTES
+ * bytes
+ *
+ * @param send The buffer of the current process
+ * @param send_count Number of elements of the buffer
+ * @param recv Where process 0 stores the buffers, allocated with malloc and
+ * to be freed by the caller; NULL on the other processes
+ * @param recv_count Where process 0 stores the number of elements of all the
+ * buffers, 0 on the other processes
+ * @param datatype MPI datatype of the elements
+ */
+void gather_buffer(void *send, uint64_t send_count, void **recv,
+                   uint64_t *recv_count, MPI_Datatype datatype);
+
+/**
+ * @brief Gather the buffers of all the processes on every process, one after
+ * the other in rank order. The buffers go around a ring of the processes,
+ * moved with @see sendrecv_buffer(), so no MPI call takes more than
+ * MPI_BLOCK_BYTES bytes.
+ *
+ * @param send The buffer of the current process
+ * @param send_count Number of elements of the buffer
+ * @param recv Where to store the buffers, allocated with malloc and to be
+ * freed by the caller
+ * @param recv_count Where to store the number of elements of all the buffers
+ * @param datatype MPI datatype of the elements
+ */
+void allgather_buffer(void *send, uint64_t send_count, void **recv,
+                      uint64_t *recv_count, MPI_Datatype datatype);
 
 /**
  * @brief Define a datatype for an hashmap element in order to be able to send
@@ -35,7 +124,8 @@ MPI_Datatype define_datatype_tree_node();
  * @param elements The array of hashmap elements to merge
  * @param size The size of the elements array
  */
-void merge_map(SupportMap *support_map, hashmap_element *elements, int size);
+void merge_map(SupportMap *support_map, hashmap_element *elements,
+               uint64_t size);
 
 /**
  * @brief Receive an array of hashmap elements with MPI
@@ -68,9 +158,14 @@ void recv_map(int rank, int world_size, int source, SupportMap *support_map,
  * stored
  * @param DT_HASHMAP_ELEMENT An MPI datatype that describes the data structure
  * that has to be sent with MPI
+ * @param sketch The sketch of the global supports, the items whose estimate
+ * is below min_support are not sent; NULL to send all the items
+ * @param min_support The mininum support that an item has to have in order to
+ * be contained in the final map
  */
 void send_map(int rank, int world_size, int dest, SupportMap *support_map,
-              MPI_Datatype DT_HASHMAP_ELEMENT);
+              MPI_Datatype DT_HASHMAP_ELEMENT, CountMinSketch *sketch,
+              int min_support);
 
 /**
  * @brief Broadcast all the elements of a SupportMap to every MPI process
@@ -108,6 +203,11 @@ void broadcast_map(int rank, int world_size, SupportMap *support_map,
  * state, it means that process 0 now has the complete map of every process and
  * can broadcast its knowledge to the whole domain.
  *
+ * If sketch_width is not 0, the processes first sum a Count-Min sketch of
+ * their supports, see @see sketch_allreduce(), and the items whose estimate
+ * is below min_support, which cannot be frequent, are not sent. The final map
+ * is the same, as an estimate is never lower than the support.
+ *
  * @param rank The rank of the process that broadcasts the data
  * @param world_size The number of MPI processes in the world
  * @param support_map The map from which to extract the elements to be sent
@@ -117,10 +217,16 @@ void broadcast_map(int rank, int world_size, SupportMap *support_map,
  * in the broadcasted map
  * @param min_support The mininum support that an item has to have in order to
  * be contained in the final map
+ * @param sketch_width Number of counters of every row of the sketch, 0 to
+ * send all the items
+ * @param distinct_items Where process 0 stores the number of distinct items
+ * of all the processes, NULL if not needed. With the sketch, the items not
+ * sent are counted once per process that has them, so it is an upper bound
  */
 void get_global_map(int rank, int world_size, SupportMap *support_map,
                     hashmap_element **items_count, int *num_items,
-                    int min_support);
+                    int min_support, int sketch_width,
+                    uint64_t *distinct_items);
 
 /**
  * @brief Merge two arrays of sorted indices into a unique array of sorted
@@ -221,7 +327,7 @@ void get_sorted_indices(int rank, int world_size, int *sorted_indices,
  * @param num_nodes The size of the nodes array
  * @param dest A pointer to the tree that will be created
  */
-void parse_tree(TreeNodeToSend *nodes, int num_nodes, Tree *dest);
+void parse_tree(TreeNodeToSend *nodes, size_t num_nodes, Tree *dest);
 
 /**
  * @brief Sends a tree to an MPI process and frees up the memory
@@ -239,8 +345,30 @@ void send_tree(int dest, Tree *tree, MPI_Datatype DT_TREE_NODE);
  * @param tree A pointer to partial tree of the current process, which will be
  * integrated by merging the received tree
  * @param DT_TREE_NODE MPI_Datatype describing a TreeNode
+ * @param num_threads The number of threads requested to merge the trees
  */
-void recv_tree(int source, Tree *tree, MPI_Datatype DT_TREE_NODE);
+void recv_tree(int source, Tree *tree, MPI_Datatype DT_TREE_NODE,
+               int num_threads);
+
+/**
+ * @brief Send a tree to an MPI process with its chains compacted, see
+ * @see tree_get_chains(), and free up the memory
+ *
+ * @param dest The destination process that will receive the tree
+ * @param tree The tree that has to be sent
+ */
+void send_tree_chains(int dest, Tree *tree);
+
+/**
+ * @brief Receive a tree sent with @see send_tree_chains() and merge its
+ * records directly into the tree of the current process
+ *
+ * @param source The MPI process that is sending the data
+ * @param tree A pointer to partial tree of the current process, which will be
+ * integrated by merging the received tree
+ * @param num_threads The number of threads requested to merge the trees
+ */
+void recv_tree_chains(int source, Tree *tree, int num_threads);
 
 /**
  * @brief Broadcast the final FP-Tree to every MPI process in the world
@@ -252,6 +380,32 @@ void recv_tree(int source, Tree *tree, MPI_Datatype DT_TREE_NODE);
  */
 void broadcast_tree(int rank, Tree *tree, MPI_Datatype DT_TREE_NODE);
 
+/**
+ * @brief Broadcast the nodes of the final FP-Tree to every MPI process in the
+ * world, without rebuilding the tree on the receiving processes
+ *
+ * @param rank The rank of the current process
+ * @param tree The tree that has to be broadcasted in case the process rank is
+ * 0, ignored otherwise
+ * @param nodes Pointer to the vector where the nodes of the tree are stored
+ */
+void broadcast_tree_nodes(int rank, Tree tree,
+                          cvector_vector_type(TreeNodeToSend) * nodes);
+
+/**
+ * @brief Broadcast the final FP-Tree to every MPI process in the world with
+ * its chains compacted, see @see tree_get_chains(), without rebuilding the
+ * tree on the receiving processes
+ *
+ * @param rank The rank of the current process
+ * @param tree The tree that has to be broadcasted in case the process rank is
+ * 0, ignored otherwise
+ * @param chains Pointer to the vector where the records of the tree are
+ * stored
+ */
+void broadcast_tree_chains(int rank, Tree tree,
+                           cvector_vector_type(int) * chains);
+
 /**
  * @brief Get the global FP-tree on every MPI process
  *
@@ -271,9 +425,29 @@ void broadcast_tree(int rank, Tree *tree, MPI_Datatype DT_TREE_NODE);
  * @param world_size The number of processes in the current world
  * @param tree The tree that has to be sent/received. This structure is heavily
  * manipulated during the execution of this function.
+ * @param num_threads The number of threads requested to merge the trees
+ * @param compact Whether the trees are compact, see @see TreeNode; they are
+ * sent with their chains compacted, see @see send_tree_chains()
  */
 
-void get_global_tree(int rank, int world_size, Tree *tree);
+void get_global_tree(int rank, int world_size, Tree *tree, int num_threads,
+                     bool compact);
+
+/**
+ * @brief Redistribute the weighted transactions among the MPI processes, so
+ * that identical transactions end up in the same process, and collapse them.
+ *
+ * Every transaction is assigned to the process given by its hash modulo the
+ * world size. The transactions are serialized as (length, weight, ids...)
+ * and exchanged pairwise, then the received ones are deduplicated.
+ *
+ * @param rank The rank of the current process
+ * @param world_size The number of processes in the current world
+ * @param transactions Pointer to the local list of weighted transactions,
+ * replaced by the list of transactions assigned to the current process
+ */
+void exchange_weighted_transactions(int rank, int world_size,
+                                    WeightedItemsetList *transactions);
 
 
 #endif
\ No newline at end of file
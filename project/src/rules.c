@@ -0,0 +1,243 @@
+#include "rules.h"
+#include "reduce.h"
+#include <assert.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief Visitor that stores the frequent itemsets in an index, with the
+ * items sorted by id
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the ItemsetMap, which stores the support as value
+ */
+void rules_collect_itemset(const int *items, int n_items, int support,
+                           void *data) {
+    ItemsetMap *itemsets = (ItemsetMap *)data;
+    int *sorted = (int *)malloc(n_items * sizeof(int)), i;
+    assert(sorted != NULL);
+    // the visitor takes the ids in decreasing order
+    for (i = 0; i < n_items; i++) {
+        sorted[i] = items[n_items - 1 - i];
+    }
+#pragma omp critical(rules_collect)
+    itemset_map_increment(itemsets, sorted, n_items, support);
+    free(sorted);
+}
+
+/**
+ * @brief Exchange the itemsets collected by every process, so that every
+ * process has the support of all the frequent itemsets. The itemsets are in
+ * the same order on every process.
+ *
+ * @param itemsets The itemsets of the current process, replaced by the ones
+ * of all the processes
+ */
+void rules_share_itemsets(ItemsetMap **itemsets) {
+    // every itemset as its support, its number of items and the ids
+    cvector_vector_type(int) local = NULL;
+    WeightedItemsetList entries = (*itemsets)->entries;
+    size_t n = cvector_size(entries), i;
+    for (i = 0; i < n; i++) {
+        size_t n_items = cvector_size(entries[i].items), j;
+        cvector_push_back(local, entries[i].weight);
+        cvector_push_back(local, (int)n_items);
+        for (j = 0; j < n_items; j++) {
+            cvector_push_back(local, entries[i].items[j]);
+        }
+    }
+    int *all;
+    uint64_t total;
+    allgather_buffer(local, cvector_size(local), (void **)&all, &total,
+                     MPI_INT);
+    cvector_free(local);
+
+    itemset_map_free(*itemsets);
+    *itemsets = itemset_map_new();
+    for (i = 0; i < total; i += all[i + 1] + 2) {
+        itemset_map_increment(*itemsets, all + i + 2, all[i + 1], all[i]);
+    }
+    free(all);
+}
+
+/**
+ * @brief Write the rule of a frequent itemset with the given consequent, if
+ * its confidence is high enough
+ *
+ * @param itemsets The frequent itemsets
+ * @param itemset The itemset
+ * @param consequent_mask Bitmask of the positions of the items of the
+ * consequent in the itemset, neither empty nor full
+ * @param writer The output file
+ * @param min_confidence Minimum confidence of a rule
+ * @param num_transactions Number of transactions
+ * @param antecedent Where to store the items of the antecedent
+ * @param consequent Where to store the items of the consequent
+ * @return Whether the rule has been written
+ */
+static bool rules_check(ItemsetMap *itemsets, WeightedItemset *itemset,
+                        uint64_t consequent_mask, OutputWriter *writer,
+                        double min_confidence,
+                        uint64_t num_transactions, int *antecedent,
+                        int *consequent) {
+    int n_items = cvector_size(itemset->items), i;
+    int n_antecedent = 0, n_consequent = 0;
+    // both sides keep the items sorted by id, as the keys of the index
+    for (i = 0; i < n_items; i++) {
+        if (consequent_mask & (1ULL << i))
+            consequent[n_consequent++] = itemset->items[i];
+        else
+            antecedent[n_antecedent++] = itemset->items[i];
+    }
+    int antecedent_support, consequent_support;
+    int found = itemset_map_get(itemsets, antecedent, n_antecedent,
+                                &antecedent_support);
+    assert(found == MAP_OK);
+    double confidence = (double)itemset->weight / antecedent_support;
+    if (confidence < min_confidence) {
+        return false;
+    }
+    found = itemset_map_get(itemsets, consequent, n_consequent,
+                            &consequent_support);
+    assert(found == MAP_OK);
+    double consequent_frequency = (double)consequent_support / num_transactions;
+    double lift = confidence / consequent_frequency;
+    double conviction = confidence < 1
+                            ? (1 - consequent_frequency) / (1 - confidence)
+                            : INFINITY;
+    output_rule(writer, antecedent, n_antecedent, consequent, n_consequent,
+                itemset->weight, confidence, lift, conviction);
+    return true;
+}
+
+/**
+ * @brief Compare two bitmasks, used to sort the consequents
+ */
+static int rules_mask_compare(const void *a, const void *b) {
+    uint64_t ma = *(const uint64_t *)a, mb = *(const uint64_t *)b;
+    return (ma > mb) - (ma < mb);
+}
+
+/**
+ * @brief Write the rules of a frequent itemset. Moving an item from the
+ * antecedent to the consequent never raises the confidence, so the
+ * consequents are grown level by level as in Apriori: a consequent is
+ * checked only if all the ones with an item less have passed.
+ *
+ * @param itemsets The frequent itemsets
+ * @param itemset The itemset, with at least 2 items
+ * @param writer The output file
+ * @param min_confidence Minimum confidence of a rule
+ * @param num_transactions Number of transactions
+ * @return The number of rules written
+ */
+static uint64_t rules_of_itemset(ItemsetMap *itemsets,
+                                 WeightedItemset *itemset,
+                                 OutputWriter *writer, double min_confidence,
+                                 uint64_t num_transactions) {
+    int n_items = cvector_size(itemset->items), i, j;
+    assert(n_items < 64);
+    uint64_t full = (1ULL << n_items) - 1, count = 0;
+    int *antecedent = (int *)malloc(n_items * sizeof(int));
+    int *consequent = (int *)malloc(n_items * sizeof(int));
+    assert(antecedent != NULL && consequent != NULL);
+    // the consequents that passed, as bitmasks of positions, by size
+    cvector_vector_type(uint64_t) level = NULL;
+    cvector_vector_type(uint64_t) next = NULL;
+    for (i = 0; i < n_items; i++) {
+        if (rules_check(itemsets, itemset, 1ULL << i, writer, min_confidence,
+                        num_transactions, antecedent, consequent)) {
+            cvector_push_back(level, 1ULL << i);
+        }
+    }
+    while (cvector_size(level) > 0) {
+        count += cvector_size(level);
+        size_t n_level = cvector_size(level), l;
+        qsort(level, n_level, sizeof(uint64_t), rules_mask_compare);
+        cvector_set_size(next, 0);
+        for (l = 0; l < n_level; l++) {
+            // every consequent is built once, adding a later position
+            for (i = 63 - __builtin_clzll(level[l]) + 1; i < n_items; i++) {
+                uint64_t candidate = level[l] | (1ULL << i);
+                if (candidate == full) {
+                    continue;
+                }
+                bool subsets = true;
+                for (j = 0; j < i && subsets; j++) {
+                    uint64_t subset = candidate & ~(1ULL << j);
+                    subsets = !(candidate & (1ULL << j)) ||
+                              bsearch(&subset, level, n_level,
+                                      sizeof(uint64_t),
+                                      rules_mask_compare) != NULL;
+                }
+                if (subsets &&
+                    rules_check(itemsets, itemset, candidate, writer,
+                                min_confidence, num_transactions, antecedent,
+                                consequent)) {
+                    cvector_push_back(next, candidate);
+                }
+            }
+        }
+        cvector_vector_type(uint64_t) tmp = level;
+        level = next;
+        next = tmp;
+    }
+    cvector_free(level);
+    cvector_free(next);
+    free(antecedent);
+    free(consequent);
+    return count;
+}
+
+/**
+ * @brief Write the association rules X => Y of the frequent itemsets whose
+ * confidence is at least min_confidence, with their support, confidence,
+ * lift and conviction, see @see output_rule().
+ *
+ * The itemsets are split cyclically among the processes and the threads;
+ * every rule of an itemset X u Y is checked with the supports of X and Y
+ * found in the index, which holds all the subsets of a frequent itemset.
+ * The processes go through the itemsets in rounds of RULES_ROUND_SIZE
+ * itemsets each, writing the rules of a round together, so the rules are
+ * never stored all at once. Every process has to call this.
+ *
+ * @param itemsets The frequent itemsets of all the processes, see @see
+ * rules_share_itemsets()
+ * @param writer The output file, open on every process
+ * @param min_confidence Minimum confidence of a rule
+ * @param num_transactions Number of transactions, to compute the lift and
+ * the conviction
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ * @return The number of rules of the current process
+ */
+uint64_t rules_write(ItemsetMap *itemsets, OutputWriter *writer,
+                     double min_confidence, uint64_t num_transactions,
+                     int rank, int world_size, int num_threads) {
+    WeightedItemsetList entries = itemsets->entries;
+    int n = cvector_size(entries), i, first;
+    int batch = RULES_ROUND_SIZE * world_size;
+    uint64_t count = 0;
+    // the same number of rounds on every process, which has all the itemsets
+    for (first = 0; first < n; first += batch) {
+        int last = first + batch < n ? first + batch : n;
+#pragma omp parallel for default(none)                                         \
+    shared(itemsets, entries, first, last, rank, world_size, writer,           \
+               min_confidence, num_transactions) reduction(+ : count)          \
+    schedule(dynamic, 64) num_threads(num_threads)
+        for (i = first + rank; i < last; i += world_size) {
+            if (cvector_size(entries[i].items) > 1) {
+                count += rules_of_itemset(itemsets, &entries[i], writer,
+                                          min_confidence, num_transactions);
+            }
+        }
+        output_flush(writer, false);
+    }
+    return count;
+}
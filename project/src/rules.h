@@ -0,0 +1,73 @@
+/**
+ * @file rules.h
+ * @brief Generation of the association rules of the frequent itemsets
+ *
+ */
+#ifndef RULES_H
+#define RULES_H
+
+#include "itemset_map.h"
+#include "output.h"
+#include "types.h"
+#include <stdint.h>
+
+/**
+ * @brief Default minimum confidence of a rule
+ */
+#define RULES_MIN_CONFIDENCE 0.5
+/**
+ * @brief Number of itemsets of every process whose rules are written
+ * together
+ */
+#define RULES_ROUND_SIZE (1 << 14)
+
+/**
+ * @brief Visitor that stores the frequent itemsets in an index, with the
+ * items sorted by id
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the ItemsetMap, which stores the support as value
+ */
+void rules_collect_itemset(const int *items, int n_items, int support,
+                           void *data);
+
+/**
+ * @brief Exchange the itemsets collected by every process, so that every
+ * process has the support of all the frequent itemsets. The itemsets are in
+ * the same order on every process.
+ *
+ * @param itemsets The itemsets of the current process, replaced by the ones
+ * of all the processes
+ */
+void rules_share_itemsets(ItemsetMap **itemsets);
+
+/**
+ * @brief Write the association rules X => Y of the frequent itemsets whose
+ * confidence is at least min_confidence, with their support, confidence,
+ * lift and conviction, see @see output_rule().
+ *
+ * The itemsets are split cyclically among the processes and the threads;
+ * every rule of an itemset X u Y is checked with the supports of X and Y
+ * found in the index, which holds all the subsets of a frequent itemset.
+ * The processes go through the itemsets in rounds of RULES_ROUND_SIZE
+ * itemsets each, writing the rules of a round together, so the rules are
+ * never stored all at once. Every process has to call this.
+ *
+ * @param itemsets The frequent itemsets of all the processes, see @see
+ * rules_share_itemsets()
+ * @param writer The output file, open on every process
+ * @param min_confidence Minimum confidence of a rule
+ * @param num_transactions Number of transactions, to compute the lift and
+ * the conviction
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ * @return The number of rules of the current process
+ */
+uint64_t rules_write(ItemsetMap *itemsets, OutputWriter *writer,
+                     double min_confidence, uint64_t num_transactions,
+                     int rank, int world_size, int num_threads);
+
+#endif
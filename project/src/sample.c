@@ -0,0 +1,219 @@
+#include "sample.h"
+#include "dedup.h"
+#include "io.h"
+#include "reduce.h"
+#include "sort.h"
+#include "topk.h"
+#include "trace.h"
+#include "tree.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief Wilson score interval of a support estimated from a sample
+ *
+ * @param count Support count in the sample
+ * @param n Number of transactions of the sample
+ * @param low Where to store the lower bound, as a fraction of the
+ * transactions
+ * @param high Where to store the upper bound
+ */
+static void sample_bounds(int count, uint64_t n, double *low, double *high) {
+    double p = (double)count / n, z2 = SAMPLE_Z * SAMPLE_Z;
+    double center = (p + z2 / (2 * n)) / (1 + z2 / n);
+    double half = SAMPLE_Z * sqrt(p * (1 - p) / n + z2 / (4.0 * n * n)) /
+                  (1 + z2 / n);
+    *low = center - half > 0 ? center - half : 0;
+    *high = center + half < 1 ? center + half : 1;
+}
+
+/**
+ * @brief Compare two support counts, used to sort them in decreasing order
+ */
+static int sample_support_compare(const void *a, const void *b) {
+    int sa = *(const int *)a, sb = *(const int *)b;
+    return (sa < sb) - (sa > sb);
+}
+
+/**
+ * @brief Support count of the k-th itemset with the highest support of the
+ * sample, mined as the top-k itemsets of the tree of the sample
+ *
+ * @param transactions The sampled transactions of the current process, freed
+ * @param items_count The sampled items with their support count, the ones
+ * that are in no top-k itemset are removed
+ * @param num_items Number of sampled items
+ * @param k Number of itemsets
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ * @return The support count on every process, 1 if the sample has less than
+ * k itemsets
+ */
+static int sample_top_k_count(TransactionsList *transactions,
+                              hashmap_element *items_count, int num_items,
+                              int k, int rank, int world_size,
+                              int num_threads) {
+    int min_count = top_k_filter_items(items_count, &num_items, 1, k), i;
+    // item -> id, ids are assigned by decreasing support
+    int *sorted_indices = (int *)malloc((num_items + 1) * sizeof(int));
+    assert(sorted_indices != NULL);
+    sort(items_count, num_items, sorted_indices, 0, num_items - 1,
+         num_threads);
+    IndexMap index_map = hashmap_new();
+    for (i = 0; i < num_items; i++) {
+        hashmap_element *item = &items_count[sorted_indices[i]];
+        hashmap_put(index_map, item->key, item->key_length,
+                    num_items - 1 - i);
+    }
+    free(sorted_indices);
+    WeightedItemsetList weighted = NULL;
+    transactions_dedup(transactions, index_map, &weighted, num_threads);
+    hashmap_free(index_map);
+    transactions_free(transactions);
+    Tree tree =
+        tree_build_from_weighted_transactions(weighted, num_threads, 0, false);
+    weighted_itemsets_free(&weighted);
+    get_global_tree(rank, world_size, &tree, num_threads, false);
+    cvector_vector_type(TreeNodeToSend) nodes = NULL;
+    broadcast_tree_nodes(rank, tree, &nodes);
+    if (tree != NULL)
+        tree_free(&tree);
+
+    TopK best;
+    top_k_mine(&best, k, nodes, cvector_size(nodes), num_items, min_count,
+               rank, world_size, num_threads);
+    cvector_free(nodes);
+    int count = 1;
+    if (rank == 0 && (int)cvector_size(best.heap) == k)
+        count = best.heap[0].weight;
+    top_k_free(&best);
+    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return count;
+}
+
+/**
+ * @brief Read a sample of the transactions of a text file, see
+ * @see transactions_sample(), and print on process 0 the estimates of the
+ * sampled supports, with their confidence bounds:
+ *
+ * - the number of items frequent with min_support: the ones with an
+ *   estimated support of at least min_support, between the ones whose lower
+ *   bound and the ones whose upper bound reach it;
+ * - the minimum support with target_items frequent items, the estimated
+ *   support of the target_items-th most frequent item;
+ * - the minimum support with target_itemsets frequent itemsets, the support
+ *   of the target_itemsets-th itemset with the highest support in the
+ *   sample, mined as the top-k itemsets of the sample.
+ *
+ * @param filename Name of the text file
+ * @param fraction Fraction of the bytes to sample, in (0, 1]
+ * @param min_support Minimum support, as a fraction of the transactions
+ * @param target_items Number of frequent items wanted, 0 if none
+ * @param target_itemsets Number of frequent itemsets wanted, 0 if none
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ * @return The highest of the minimum supports of the targets, on every
+ * process, or min_support without targets
+ */
+double sample_min_support(char *filename, double fraction, double min_support,
+                          int target_items, int target_itemsets, int rank,
+                          int world_size, int num_threads) {
+    trace_begin("sampled supports");
+    TransactionsList transactions = NULL;
+    SupportMap support_map = hashmap_new();
+    MPI_Offset local_bytes =
+        transactions_sample(&transactions, filename, fraction, rank,
+                            world_size, &support_map);
+    uint64_t local[2] = {cvector_size(transactions), local_bytes}, global[2];
+    MPI_Allreduce(local, global, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    uint64_t n = global[0];
+    MPI_File in;
+    MPI_Offset filesize = 0;
+    MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                  &in);
+    MPI_File_get_size(in, &filesize);
+    MPI_File_close(&in);
+    hashmap_element *items_count = NULL;
+    int num_items;
+    get_global_map(rank, world_size, &support_map, &items_count, &num_items,
+                   1, 0, NULL);
+    hashmap_free(support_map);
+    trace_end();
+    if (n == 0) {
+        if (rank == 0)
+            fprintf(stderr, "the sample has no transactions\n");
+        MPI_Finalize();
+        exit(1);
+    }
+
+    int *supports = (int *)malloc((num_items + 1) * sizeof(int)), i;
+    assert(supports != NULL);
+    for (i = 0; i < num_items; i++) {
+        supports[i] = items_count[i].value;
+    }
+    qsort(supports, num_items, sizeof(int), sample_support_compare);
+    double low, high, sampled = (double)global[1] / filesize;
+    if (rank == 0) {
+        fprintf(stderr, "sample_transactions: %" PRIu64 "\n", n);
+        fprintf(stderr, "sample_fraction: %f\n", sampled);
+        fprintf(stderr, "estimated_transactions: %.0f\n", n / sampled);
+        fprintf(stderr, "sample_items: %d\n", num_items);
+        if (min_support > 0) {
+            int estimate = 0, surely = 0, possibly = 0;
+            for (i = 0; i < num_items; i++) {
+                sample_bounds(supports[i], n, &low, &high);
+                estimate += supports[i] >= min_support * n;
+                surely += low >= min_support;
+                possibly += high >= min_support;
+            }
+            fprintf(stderr, "estimated_frequent_items: %d [%d, %d]\n",
+                    estimate, surely, possibly);
+        }
+    }
+
+    if (num_items == 0 && (target_items > 0 || target_itemsets > 0)) {
+        if (rank == 0)
+            fprintf(stderr, "the sample has no items, the minimum support "
+                            "cannot be estimated\n");
+        MPI_Finalize();
+        exit(1);
+    }
+    double recommended = 0;
+    if (target_items > 0) {
+        int count = supports[(target_items < num_items ? target_items
+                                                       : num_items) -
+                             1];
+        sample_bounds(count, n, &low, &high);
+        recommended = (double)count / n;
+        if (rank == 0)
+            fprintf(stderr, "items_min_support: %f [%f, %f]\n", recommended,
+                    low, high);
+    }
+    free(supports);
+    if (target_itemsets > 0) {
+        trace_begin("sampled top-k itemsets");
+        int count = sample_top_k_count(&transactions, items_count, num_items,
+                                       target_itemsets, rank, world_size,
+                                       num_threads);
+        trace_end();
+        sample_bounds(count, n, &low, &high);
+        double support = (double)count / n;
+        recommended = support > recommended ? support : recommended;
+        if (rank == 0)
+            fprintf(stderr, "itemsets_min_support: %f [%f, %f]\n", support,
+                    low, high);
+    }
+    transactions_free(&transactions);
+    if (rank != 0)
+        free(items_count);
+    else
+        cvector_free(items_count);
+    return target_items > 0 || target_itemsets > 0 ? recommended
+                                                    : min_support;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file sample.h
+ * @brief Estimate of the supports of the items and of the number of
+ * frequent items and itemsets from a sample of the transactions, used to
+ * choose the minimum support before reading the whole file
+ *
+ */
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+/**
+ * @brief Quantile of the normal distribution of the confidence bounds of the
+ * supports, 1.96 for 95%
+ */
+#define SAMPLE_Z 1.96
+
+/**
+ * @brief Read a sample of the transactions of a text file, see
+ * @see transactions_sample(), and print on process 0 the estimates of the
+ * sampled supports, with their confidence bounds:
+ *
+ * - the number of items frequent with min_support: the ones with an
+ *   estimated support of at least min_support, between the ones whose lower
+ *   bound and the ones whose upper bound reach it;
+ * - the minimum support with target_items frequent items, the estimated
+ *   support of the target_items-th most frequent item;
+ * - the minimum support with target_itemsets frequent itemsets, the support
+ *   of the target_itemsets-th itemset with the highest support in the
+ *   sample, mined as the top-k itemsets of the sample.
+ *
+ * @param filename Name of the text file
+ * @param fraction Fraction of the bytes to sample, in (0, 1]
+ * @param min_support Minimum support, as a fraction of the transactions
+ * @param target_items Number of frequent items wanted, 0 if none
+ * @param target_itemsets Number of frequent itemsets wanted, 0 if none
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ * @return The highest of the minimum supports of the targets, on every
+ * process, or min_support without targets
+ */
+double sample_min_support(char *filename, double fraction, double min_support,
+                          int target_items, int target_itemsets, int rank,
+                          int world_size, int num_threads);
+
+#endif
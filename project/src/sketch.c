@@ -0,0 +1,137 @@
+#include "sketch.h"
+#include <assert.h>
+#include <mpi.h>
+#include <stdlib.h>
+
+/**
+ * @brief 64-bit FNV-1a hash of an item
+ */
+static uint64_t sketch_hash(const void *key, size_t key_length) {
+    const uint8_t *bytes = (const uint8_t *)key;
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+    for (i = 0; i < key_length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Counter of an item in every row: the hash of row i is h1 + i * h2,
+ * with h1 and h2 the two halves of a single hash mixed further
+ *
+ * @param sketch The sketch
+ * @param key The item
+ * @param key_length Number of bytes of the item
+ * @param columns Where to store the column of every row
+ */
+static void sketch_columns(CountMinSketch *sketch, const void *key,
+                           size_t key_length, int *columns) {
+    uint64_t hash = sketch_hash(key, key_length);
+    // finalizer of MurmurHash3, so that both halves depend on every byte
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    int i;
+    for (i = 0; i < SKETCH_DEPTH; i++) {
+        columns[i] = (h1 + (uint64_t)i * h2) % (uint32_t)sketch->width;
+    }
+}
+
+/**
+ * @brief Instantiate an empty sketch
+ *
+ * @param sketch The sketch to initialize
+ * @param width Number of counters of every row
+ */
+void sketch_init(CountMinSketch *sketch, int width) {
+    assert(width > 0);
+    sketch->width = width;
+    sketch->counts =
+        (uint64_t *)calloc((size_t)width * SKETCH_DEPTH, sizeof(uint64_t));
+    assert(sketch->counts != NULL);
+}
+
+/**
+ * @brief Free a sketch
+ *
+ * @param sketch The sketch
+ */
+void sketch_free(CountMinSketch *sketch) {
+    free(sketch->counts);
+    sketch->counts = NULL;
+}
+
+/**
+ * @brief Add all the supports of a map to a sketch
+ *
+ * @param sketch The sketch
+ * @param support_map Map from item to its support
+ */
+void sketch_add_map(CountMinSketch *sketch, SupportMap support_map) {
+    int pos = 0, i, columns[SKETCH_DEPTH];
+    hashmap_element *element;
+    while ((element = hashmap_next(support_map, &pos)) != NULL) {
+        sketch_columns(sketch, element->key, element->key_length, columns);
+        for (i = 0; i < SKETCH_DEPTH; i++) {
+            sketch->counts[(size_t)i * sketch->width + columns[i]] +=
+                element->value;
+        }
+    }
+}
+
+/**
+ * @brief Estimate the support of an item, never lower than its support
+ *
+ * @param sketch The sketch
+ * @param key The item
+ * @param key_length Number of bytes of the item
+ * @return The estimated support
+ */
+uint64_t sketch_estimate(CountMinSketch *sketch, const void *key,
+                         size_t key_length) {
+    int i, columns[SKETCH_DEPTH];
+    sketch_columns(sketch, key, key_length, columns);
+    uint64_t estimate = UINT64_MAX;
+    for (i = 0; i < SKETCH_DEPTH; i++) {
+        uint64_t count = sketch->counts[(size_t)i * sketch->width + columns[i]];
+        if (count < estimate)
+            estimate = count;
+    }
+    return estimate;
+}
+
+/**
+ * @brief Count the items of a map whose estimated support reaches a minimum
+ *
+ * @param sketch The sketch
+ * @param support_map Map from item to its support
+ * @param min_support The minimum estimated support
+ * @return The number of items whose estimate is at least min_support
+ */
+uint64_t sketch_count_reaching(CountMinSketch *sketch, SupportMap support_map,
+                              uint64_t min_support) {
+    int pos = 0;
+    uint64_t count = 0;
+    hashmap_element *element;
+    while ((element = hashmap_next(support_map, &pos)) != NULL) {
+        if (sketch_estimate(sketch, element->key, element->key_length) >=
+            min_support)
+            count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Sum the sketches of all the processes, collectively; all of them
+ * need the same width
+ *
+ * @param sketch The sketch of the current process, replaced by the sum
+ */
+void sketch_allreduce(CountMinSketch *sketch) {
+    MPI_Allreduce(MPI_IN_PLACE, sketch->counts,
+                  (int)((size_t)sketch->width * SKETCH_DEPTH), MPI_UINT64_T,
+                  MPI_SUM, MPI_COMM_WORLD);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file sketch.h
+ * @brief Count-Min sketch of the supports of the items, used to skip the
+ * items that cannot be frequent before the exact supports are exchanged
+ *
+ */
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+
+/**
+ * @brief Number of rows of a sketch, i.e. of hash functions
+ */
+#define SKETCH_DEPTH 4
+
+/**
+ * @brief Count-Min sketch: SKETCH_DEPTH rows of width counters, an item adds
+ * its support to a counter of every row chosen by a different hash. The
+ * estimate of the support of an item, the minimum of its counters, is never
+ * lower than its support.
+ */
+typedef struct CountMinSketch {
+    /**
+     * @brief Number of counters of every row
+     */
+    int width;
+    /**
+     * @brief The counters, row by row
+     */
+    uint64_t *counts;
+} CountMinSketch;
+
+/**
+ * @brief Instantiate an empty sketch
+ *
+ * @param sketch The sketch to initialize
+ * @param width Number of counters of every row
+ */
+void sketch_init(CountMinSketch *sketch, int width);
+
+/**
+ * @brief Free a sketch
+ *
+ * @param sketch The sketch
+ */
+void sketch_free(CountMinSketch *sketch);
+
+/**
+ * @brief Add all the supports of a map to a sketch
+ *
+ * @param sketch The sketch
+ * @param support_map Map from item to its support
+ */
+void sketch_add_map(CountMinSketch *sketch, SupportMap support_map);
+
+/**
+ * @brief Estimate the support of an item, never lower than its support
+ *
+ * @param sketch The sketch
+ * @param key The item
+ * @param key_length Number of bytes of the item
+ * @return The estimated support
+ */
+uint64_t sketch_estimate(CountMinSketch *sketch, const void *key,
+                         size_t key_length);
+
+/**
+ * @brief Count the items of a map whose estimated support reaches a minimum
+ *
+ * @param sketch The sketch
+ * @param support_map Map from item to its support
+ * @param min_support The minimum estimated support
+ * @return The number of items whose estimate is at least min_support
+ */
+uint64_t sketch_count_reaching(CountMinSketch *sketch, SupportMap support_map,
+                              uint64_t min_support);
+
+/**
+ * @brief Sum the sketches of all the processes, collectively; all of them
+ * need the same width
+ *
+ * @param sketch The sketch of the current process, replaced by the sum
+ */
+void sketch_allreduce(CountMinSketch *sketch);
+
+#endif
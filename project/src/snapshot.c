@@ -0,0 +1,161 @@
+#include "snapshot.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Round an offset up to a multiple of 8 bytes
+ */
+static uint64_t snapshot_align(uint64_t offset) { return (offset + 7) & ~7UL; }
+
+/**
+ * @brief Write an array of items to a snapshot file
+ *
+ * @param out The file
+ * @param elements The items with their support
+ * @param n Number of items
+ */
+static void snapshot_write_items(FILE *out, hashmap_element *elements,
+                                 uint64_t n) {
+    uint64_t i;
+    for (i = 0; i < n; i++) {
+        SnapshotItem item;
+        memset(&item, 0, sizeof(item));
+        memcpy(item.key, elements[i].key, elements[i].key_length);
+        item.key_length = elements[i].key_length;
+        item.value = elements[i].value;
+        fwrite(&item, sizeof(item), 1, out);
+    }
+}
+
+/**
+ * @brief Write the global tree and its frequent items to a snapshot file
+ *
+ * @param filename Name of the file to write
+ * @param tree The global tree
+ * @param items The items of the tree with their support, the i-th one has
+ * id i
+ * @param num_items The number of items of the tree
+ * @param supports The support of every item read
+ * @param num_supports The number of items read
+ * @param num_transactions Number of transactions the tree has been built from
+ * @param min_count Minimum support count of the items of the tree
+ * @param min_support Minimum support of the items of the tree, as a
+ * fraction of the number of transactions
+ */
+void snapshot_write(char *filename, Tree tree, hashmap_element *items,
+                    int num_items, hashmap_element *supports,
+                    uint64_t num_supports, uint64_t num_transactions,
+                    uint64_t min_count, double min_support) {
+    FILE *out = fopen(filename, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Cannot write the snapshot %s\n", filename);
+        MPI_Finalize();
+        exit(1);
+    }
+    // a node per item, the chains of a compact tree being expanded
+    cvector_vector_type(TreeNodeToSend) nodes = NULL;
+    tree_get_nodes(tree, &nodes);
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+    header.version = SNAPSHOT_VERSION;
+    header.num_transactions = num_transactions;
+    header.min_count = min_count;
+    header.min_support = min_support;
+    header.num_items = num_items;
+    header.num_nodes = cvector_size(nodes);
+    header.items_offset = snapshot_align(sizeof(SnapshotHeader));
+    header.nodes_offset = snapshot_align(header.items_offset +
+                                         num_items * sizeof(SnapshotItem));
+    header.num_supports = num_supports;
+    header.supports_offset = snapshot_align(
+        header.nodes_offset + header.num_nodes * sizeof(TreeNodeToSend));
+    fwrite(&header, sizeof(header), 1, out);
+
+    fseek(out, header.items_offset, SEEK_SET);
+    snapshot_write_items(out, items, num_items);
+
+    fseek(out, header.nodes_offset, SEEK_SET);
+    size_t written = fwrite(nodes, sizeof(TreeNodeToSend), header.num_nodes, out);
+    cvector_free(nodes);
+    fseek(out, header.supports_offset, SEEK_SET);
+    snapshot_write_items(out, supports, num_supports);
+    if (written != header.num_nodes || ferror(out) || fclose(out) != 0) {
+        fprintf(stderr, "Cannot write the snapshot %s\n", filename);
+        MPI_Finalize();
+        exit(1);
+    }
+}
+
+/**
+ * @brief Map a snapshot file in memory, read-only. Every process can map the
+ * same file.
+ *
+ * @param filename Name of the file
+ * @param snapshot Where to store the mapped snapshot
+ * @return true if the file is a snapshot, false if it is not, e.g. because
+ * it is a file of transactions. The program terminates if the file is a
+ * corrupted snapshot.
+ */
+bool snapshot_open(char *filename, Snapshot *snapshot) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    char magic[4];
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SnapshotHeader) ||
+        read(fd, magic, 4) != 4 || memcmp(magic, SNAPSHOT_MAGIC, 4) != 0) {
+        close(fd);
+        return false;
+    }
+    snapshot->size = st.st_size;
+    snapshot->data = mmap(NULL, snapshot->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    assert(snapshot->data != MAP_FAILED);
+
+    const SnapshotHeader *header = (const SnapshotHeader *)snapshot->data;
+    if (header->version != SNAPSHOT_VERSION ||
+        header->items_offset + header->num_items * sizeof(SnapshotItem) >
+            snapshot->size ||
+        header->nodes_offset + header->num_nodes * sizeof(TreeNodeToSend) >
+            snapshot->size ||
+        header->supports_offset + header->num_supports * sizeof(SnapshotItem) >
+            snapshot->size ||
+        header->num_nodes == 0) {
+        fprintf(stderr, "Invalid snapshot %s\n", filename);
+        MPI_Finalize();
+        exit(2);
+    }
+    snapshot->header = header;
+    snapshot->items =
+        (const SnapshotItem *)((char *)snapshot->data + header->items_offset);
+    snapshot->nodes =
+        (const TreeNodeToSend *)((char *)snapshot->data + header->nodes_offset);
+    snapshot->supports = (const SnapshotItem *)((char *)snapshot->data +
+                                                header->supports_offset);
+    return true;
+}
+
+/**
+ * @brief Unmap a snapshot file
+ *
+ * @param snapshot The snapshot to unmap
+ */
+void snapshot_close(Snapshot *snapshot) {
+    if (snapshot->data != NULL) {
+        munmap(snapshot->data, snapshot->size);
+    }
+    snapshot->data = NULL;
+    snapshot->header = NULL;
+    snapshot->items = NULL;
+    snapshot->nodes = NULL;
+    snapshot->supports = NULL;
+}
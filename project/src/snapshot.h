@@ -0,0 +1,138 @@
+/**
+ * @file snapshot.h
+ * @brief Flat file with the global FP-tree, that can be mapped in memory to
+ * mine it again without rebuilding it
+ *
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "tree.h"
+#include "types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief First bytes of a snapshot file
+ */
+#define SNAPSHOT_MAGIC "FPTS"
+#define SNAPSHOT_VERSION 2
+
+/**
+ * @brief Header at the beginning of a snapshot file.
+ *
+ * The header is followed by the array of the num_items items of the tree,
+ * ordered by id, at items_offset, by the array of the num_nodes nodes of
+ * the tree at nodes_offset, with the root as first node, and by the support
+ * of all the num_supports items read, frequent or not, at supports_offset,
+ * so that the tree can be updated with new transactions. The ids are
+ * assigned by decreasing support when the tree is built, but may be out of
+ * order after an update, see update.h. All the values are stored in the
+ * native byte order.
+ */
+typedef struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    /**
+     * @brief Number of transactions the tree has been built from
+     */
+    uint64_t num_transactions;
+    /**
+     * @brief Minimum support count of the items of the tree
+     */
+    uint64_t min_count;
+    /**
+     * @brief Minimum support of the items of the tree, as a fraction of the
+     * number of transactions, kept when the tree is updated
+     */
+    double min_support;
+    uint64_t num_items;
+    uint64_t num_nodes;
+    uint64_t items_offset;
+    uint64_t nodes_offset;
+    uint64_t num_supports;
+    uint64_t supports_offset;
+} SnapshotHeader;
+
+/**
+ * @brief A frequent item in a snapshot file
+ */
+typedef struct SnapshotItem {
+    /**
+     * @brief The item, including the final '\0'
+     */
+    uint8_t key[KEY_STATIC_LENGTH];
+    int32_t key_length;
+    /**
+     * @brief Support count of the item
+     */
+    int32_t value;
+} SnapshotItem;
+
+/**
+ * @brief A snapshot file mapped in memory
+ */
+typedef struct Snapshot {
+    /**
+     * @brief Address where the file is mapped
+     */
+    void *data;
+    /**
+     * @brief Size of the file
+     */
+    size_t size;
+    const SnapshotHeader *header;
+    /**
+     * @brief The frequent items, the i-th one has id i
+     */
+    const SnapshotItem *items;
+    /**
+     * @brief The nodes of the tree, the first one is the root
+     */
+    const TreeNodeToSend *nodes;
+    /**
+     * @brief The support of every item read
+     */
+    const SnapshotItem *supports;
+} Snapshot;
+
+/**
+ * @brief Write the global tree and its frequent items to a snapshot file
+ *
+ * @param filename Name of the file to write
+ * @param tree The global tree
+ * @param items The items of the tree with their support, the i-th one has
+ * id i
+ * @param num_items The number of items of the tree
+ * @param supports The support of every item read
+ * @param num_supports The number of items read
+ * @param num_transactions Number of transactions the tree has been built from
+ * @param min_count Minimum support count of the items of the tree
+ * @param min_support Minimum support of the items of the tree, as a
+ * fraction of the number of transactions
+ */
+void snapshot_write(char *filename, Tree tree, hashmap_element *items,
+                    int num_items, hashmap_element *supports,
+                    uint64_t num_supports, uint64_t num_transactions,
+                    uint64_t min_count, double min_support);
+
+/**
+ * @brief Map a snapshot file in memory, read-only. Every process can map the
+ * same file.
+ *
+ * @param filename Name of the file
+ * @param snapshot Where to store the mapped snapshot
+ * @return true if the file is a snapshot, false if it is not, e.g. because
+ * it is a file of transactions. The program terminates if the file is a
+ * corrupted snapshot.
+ */
+bool snapshot_open(char *filename, Snapshot *snapshot);
+
+/**
+ * @brief Unmap a snapshot file
+ *
+ * @param snapshot The snapshot to unmap
+ */
+void snapshot_close(Snapshot *snapshot);
+
+#endif
@@ -1,4 +1,5 @@
 #include "sort.h"
+#include "trace.h"
 #include "types.h"
 #include "utils.h"
 #include <omp.h>
@@ -7,6 +8,28 @@
 
 #define INSERTION_SORT_THRESH 100
 
+/**
+ * @brief Compare two items by support. Items with the same support are
+ * compared by key, so that the order doesn't depend on the order in which
+ * the items are stored, which differs with the number of processes
+ *
+ * @param a The first item
+ * @param b The second item
+ * @return A negative number if a comes before b, positive if it comes after,
+ * 0 if they are the same item
+ */
+int item_compare(hashmap_element *a, hashmap_element *b) {
+    if (a->value != b->value) {
+        return a->value < b->value ? -1 : 1;
+    }
+    int length = min(a->key_length, b->key_length);
+    int cmp = memcmp(a->key, b->key, length);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return a->key_length - b->key_length;
+}
+
 /**
  * @brief Sort the indices contained in the array sorted_indices
  * from start to end using insertion sort. The indices are sorted
@@ -20,14 +43,13 @@
  */
 void insertion_sort(hashmap_element *items_count, int num_items,
                     int *sorted_indices, int start, int end) {
-    int i, j, i_val, j_val;
+    int i, j;
     for (i = start + 1; i <= end; i++) {
         bool stop = false;
-        i_val = items_count[sorted_indices[i]].value;
         int tmp = sorted_indices[i];
-        for (j = i; j > 0 && !stop; j--) {
-            j_val = items_count[sorted_indices[j - 1]].value;
-            if (j_val > i_val) {
+        for (j = i; j > start && !stop; j--) {
+            if (item_compare(&items_count[sorted_indices[j - 1]],
+                             &items_count[tmp]) > 0) {
                 sorted_indices[j] = sorted_indices[j - 1];
             } else {
                 stop = true;
@@ -71,12 +93,10 @@ void swap(int *a, int i, int j) {
 int pivot(hashmap_element *items_count, int num_items, int *sorted_indices,
           int start, int end, int m) {
     swap(sorted_indices, start, m);
-    int i, j = start, i_value, pivot = sorted_indices[start], pivot_value;
-    // i_key_length = ulength(keys[pivot]);
-    pivot_value = items_count[pivot].value;
+    int i, j = start, pivot = sorted_indices[start];
     for (i = j + 1; i <= end; i++) {
-        i_value = items_count[sorted_indices[i]].value;
-        if (i_value < pivot_value) {
+        if (item_compare(&items_count[sorted_indices[i]],
+                         &items_count[pivot]) < 0) {
             j++;
             swap(sorted_indices, i, j);
         }
@@ -105,21 +125,24 @@ int pivot(hashmap_element *items_count, int num_items, int *sorted_indices,
 int choose_pivot(hashmap_element *items_count, int num_items,
                  int *sorted_indices, int start, int end) {
     int m = (start + end) / 2;
-    int v[3];
-    v[0] = items_count[sorted_indices[start]].value;
-    v[1] = items_count[sorted_indices[m]].value;
-    v[2] = items_count[sorted_indices[end]].value;
+    hashmap_element *v[3];
+    v[0] = &items_count[sorted_indices[start]];
+    v[1] = &items_count[sorted_indices[m]];
+    v[2] = &items_count[sorted_indices[end]];
 
-    if (v[0] > v[2]) {
-        swap(v, 0, 2);
+    if (item_compare(v[0], v[2]) > 0) {
+        hashmap_element *tmp = v[0];
+        v[0] = v[2];
+        v[2] = tmp;
         swap(sorted_indices, start, end);
     }
-    if (v[1] > v[2]) {
-        swap(v, 1, 2);
+    if (item_compare(v[1], v[2]) > 0) {
+        hashmap_element *tmp = v[1];
+        v[1] = v[2];
+        v[2] = tmp;
         swap(sorted_indices, m, end);
     }
-    if (v[1] > v[0]) {
-        swap(v, 1, 0);
+    if (item_compare(v[1], v[0]) > 0) {
         swap(sorted_indices, m, start);
     }
     return start;
@@ -207,6 +230,7 @@ void sort(hashmap_element *items_count, int num_items, int *sorted_indices,
     int num_busy_threads = 0;
     int i;
 
+    trace_begin("sort");
 #pragma omp parallel default(none)                                             \
     shared(items_count, num_items, sorted_indices, start, end, stack,          \
            num_threads, num_busy_threads) private(i) num_threads(num_threads)
@@ -224,4 +248,5 @@ void sort(hashmap_element *items_count, int num_items, int *sorted_indices,
         }
     }
     cvector_free(stack);
+    trace_end();
 }
\ No newline at end of file
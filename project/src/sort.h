@@ -11,6 +11,18 @@
 
 #define INSERTION_SORT_THRESH 100
 
+/**
+ * @brief Compare two items by support. Items with the same support are
+ * compared by key, so that the order doesn't depend on the order in which
+ * the items are stored, which differs with the number of processes
+ *
+ * @param a The first item
+ * @param b The second item
+ * @return A negative number if a comes before b, positive if it comes after,
+ * 0 if they are the same item
+ */
+int item_compare(hashmap_element *a, hashmap_element *b);
+
 /**
  * @brief Sort the indices contained in the array sorted_indices
  * from start to end using insertion sort. The indices are sorted
@@ -0,0 +1,510 @@
+#include "stream.h"
+#include "itemset_map.h"
+#include "memory.h"
+#include "mine.h"
+#include "reduce.h"
+#include "trace.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <mpi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Compare two integers, used to sort the item ids
+ */
+static int stream_key_compare(const void *a, const void *b) {
+    int ka = *(const int *)a, kb = *(const int *)b;
+    return (ka > kb) - (ka < kb);
+}
+
+/**
+ * @brief Instantiate an empty window
+ *
+ * @param window The window to initialize
+ * @param num_panes Number of panes kept in the window
+ */
+void stream_window_init(StreamWindow *window, int num_panes) {
+    assert(num_panes > 0);
+    window->tree = tree_new();
+    window->free_nodes = NULL;
+    window->index_map = hashmap_new();
+    window->supports = NULL;
+    window->items = NULL;
+    window->free_ids = NULL;
+    window->panes = (StreamPane *)calloc(num_panes, sizeof(StreamPane));
+    assert(window->panes != NULL);
+    window->num_panes = num_panes;
+    window->first_pane = 0;
+    window->used_panes = 0;
+    window->num_transactions = 0;
+}
+
+/**
+ * @brief Free a window and its panes
+ *
+ * @param window The window
+ */
+void stream_window_free(StreamWindow *window) {
+    int i;
+    for (i = 0; i < window->num_panes; i++) {
+        weighted_itemsets_free(&(window->panes[i].transactions));
+    }
+    free(window->panes);
+    window->panes = NULL;
+    tree_free(&(window->tree));
+    cvector_free(window->free_nodes);
+    cvector_free(window->supports);
+    size_t n_ids = cvector_size(window->items), id;
+    for (id = 0; id < n_ids; id++) {
+        free(window->items[id]);
+    }
+    cvector_free(window->items);
+    cvector_free(window->free_ids);
+    window->free_nodes = NULL;
+    window->supports = NULL;
+    window->items = NULL;
+    window->free_ids = NULL;
+    hashmap_free(window->index_map);
+}
+
+/**
+ * @brief Id of an item of the window, a free id is assigned to the items
+ * not in the window
+ *
+ * @param window The window
+ * @param key The item, with the trailing '\0'
+ * @param key_length Length of the item
+ * @return The id of the item
+ */
+int stream_window_item_id(StreamWindow *window, char *key, int key_length) {
+    int id;
+    if (hashmap_get(window->index_map, key, key_length, &id) == MAP_OK) {
+        return id;
+    }
+    size_t n_free = cvector_size(window->free_ids);
+    id = n_free > 0 ? window->free_ids[n_free - 1]
+                    : (int)cvector_size(window->supports);
+    if (hashmap_put(window->index_map, key, key_length, id) ==
+        MAP_KEY_TOO_LONG) {
+        // the other processes are waiting for the next window
+        fprintf(stderr, "Item %s is too long\n", key);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (n_free > 0) {
+        cvector_pop_back(window->free_ids);
+    } else {
+        cvector_push_back(window->supports, 0);
+        cvector_push_back(window->items, NULL);
+    }
+    window->items[id] = strdup(key);
+    assert(window->items[id] != NULL);
+    return id;
+}
+
+/**
+ * @brief Free the ids of the items of a pane that are not in the window any
+ * more, so that new items reuse them
+ *
+ * @param window The window
+ * @param pane The pane, removed from the window
+ */
+static void stream_window_release_items(StreamWindow *window,
+                                        StreamPane *pane) {
+    size_t n = cvector_size(pane->transactions), t;
+    for (t = 0; t < n; t++) {
+        WeightedItemset *transaction = &(pane->transactions[t]);
+        int n_keys = cvector_size(transaction->items), j;
+        for (j = 0; j < n_keys; j++) {
+            int key = transaction->items[j];
+            char *item = window->items[key];
+            if (window->supports[key] > 0 || item == NULL) {
+                continue;
+            }
+            hashmap_remove(window->index_map, item, strlen(item) + 1);
+            free(item);
+            window->items[key] = NULL;
+            cvector_push_back(window->free_ids, key);
+        }
+    }
+}
+
+/**
+ * @brief Add a child to a node of the window, in a free slot if there is
+ * one
+ *
+ * @param window The window
+ * @param key The id of the child
+ * @param parent Index of the parent
+ * @return Index of the child
+ */
+static int stream_window_add_node(StreamWindow *window, int key, int parent) {
+    TreeNode *node = tree_node_new(key, 0, parent);
+    size_t n_free = cvector_size(window->free_nodes);
+    if (n_free == 0) {
+        return tree_add_node(&(window->tree), node);
+    }
+    int index = window->free_nodes[n_free - 1];
+    cvector_pop_back(window->free_nodes);
+    window->tree[index] = node;
+    hashmap_put(window->tree[parent]->adj, &(node->key), sizeof(int), index);
+    return index;
+}
+
+/**
+ * @brief Insert the transactions of a pane into the tree of the window
+ *
+ * @param window The window
+ * @param pane The pane
+ */
+static void stream_window_insert(StreamWindow *window, StreamPane *pane) {
+    size_t n = cvector_size(pane->transactions), t;
+    for (t = 0; t < n; t++) {
+        WeightedItemset *transaction = &(pane->transactions[t]);
+        int n_keys = cvector_size(transaction->items), j, curr = 0;
+        for (j = 0; j < n_keys; j++) {
+            int key = transaction->items[j], next;
+            if (hashmap_get(window->tree[curr]->adj, &key, sizeof(int),
+                            &next) != MAP_OK) {
+                next = stream_window_add_node(window, key, curr);
+            }
+            window->tree[next]->value += transaction->weight;
+            window->supports[key] += transaction->weight;
+            curr = next;
+        }
+    }
+    window->num_transactions += pane->num_transactions;
+}
+
+/**
+ * @brief Remove the transactions of a pane from the tree of the window,
+ * freeing the nodes whose value drops to 0.
+ *
+ * The value of a node is at least the sum of the ones of its children, so
+ * when it drops to 0 the children on the other paths have already been
+ * removed, and the ones on this path are removed next.
+ *
+ * @param window The window
+ * @param pane The pane, inserted before
+ */
+static void stream_window_remove(StreamWindow *window, StreamPane *pane) {
+    size_t n = cvector_size(pane->transactions), t;
+    for (t = 0; t < n; t++) {
+        WeightedItemset *transaction = &(pane->transactions[t]);
+        int n_keys = cvector_size(transaction->items), j, curr = 0;
+        for (j = 0; j < n_keys; j++) {
+            int key = transaction->items[j], next;
+            int found = hashmap_get(window->tree[curr]->adj, &key,
+                                    sizeof(int), &next);
+            assert(found == MAP_OK);
+            TreeNode *node = window->tree[next];
+            node->value -= transaction->weight;
+            window->supports[key] -= transaction->weight;
+            assert(node->value >= 0);
+            if (node->value == 0) {
+                hashmap_remove(window->tree[curr]->adj, &key, sizeof(int));
+            }
+            if (curr != 0 && window->tree[curr]->value == 0) {
+                tree_node_free(window->tree[curr]);
+                window->tree[curr] = NULL;
+                cvector_push_back(window->free_nodes, curr);
+            }
+            curr = next;
+        }
+        if (curr != 0 && window->tree[curr]->value == 0) {
+            tree_node_free(window->tree[curr]);
+            window->tree[curr] = NULL;
+            cvector_push_back(window->free_nodes, curr);
+        }
+    }
+    window->num_transactions -= pane->num_transactions;
+}
+
+/**
+ * @brief Insert a pane into the window. When the window is full, the oldest
+ * pane is removed from the tree first, and the ids of its items that are
+ * not in the new window are freed. The window becomes the owner of the
+ * transactions of the pane.
+ *
+ * @param window The window
+ * @param pane The pane
+ */
+void stream_window_push(StreamWindow *window, StreamPane pane) {
+    int slot;
+    StreamPane removed = {NULL, 0};
+    if (window->used_panes == window->num_panes) {
+        slot = window->first_pane;
+        stream_window_remove(window, &(window->panes[slot]));
+        removed = window->panes[slot];
+        window->first_pane = (window->first_pane + 1) % window->num_panes;
+    } else {
+        slot = (window->first_pane + window->used_panes) % window->num_panes;
+        window->used_panes++;
+    }
+    window->panes[slot] = pane;
+    stream_window_insert(window, &(window->panes[slot]));
+    // the new pane got its ids before the removal, so the items of the
+    // removed pane still with no support have left the window
+    stream_window_release_items(window, &removed);
+    weighted_itemsets_free(&(removed.transactions));
+}
+
+/**
+ * @brief Number of nodes of the tree of the window, the root included
+ *
+ * @param window The window
+ * @return The number of nodes that have not been removed
+ */
+size_t stream_window_size(StreamWindow *window) {
+    return cvector_size(window->tree) - cvector_size(window->free_nodes);
+}
+
+/**
+ * @brief Flatten the tree of the window, skipping the removed nodes. A
+ * parent can follow its children, as the slots are reused.
+ *
+ * @param window The window
+ * @param nodes Vector where the nodes are stored, the first one is the root
+ */
+void stream_window_get_nodes(StreamWindow *window,
+                             cvector_vector_type(TreeNodeToSend) * nodes) {
+    size_t size = cvector_size(window->tree), i;
+    int *remap = (int *)malloc(size * sizeof(int));
+    assert(remap != NULL);
+    int n = 0;
+    for (i = 0; i < size; i++) {
+        remap[i] = window->tree[i] != NULL ? n++ : TREE_NODE_NULL;
+    }
+    cvector_set_size((*nodes), 0);
+    cvector_grow((*nodes), n);
+    for (i = 0; i < size; i++) {
+        TreeNode *node = window->tree[i];
+        if (node != NULL) {
+            TreeNodeToSend to_send = {node->key, node->value,
+                                      remap[node->parent]};
+            cvector_push_back((*nodes), to_send);
+        }
+    }
+    free(remap);
+}
+
+/**
+ * @brief Read the next line of a stream. When following a file, the end of
+ * the file is polled until a complete line is available.
+ *
+ * @param in The stream
+ * @param follow Whether to wait for new lines at the end of the file
+ * @param line Buffer of the line, as in getline()
+ * @param capacity Capacity of the buffer, as in getline()
+ * @param partial Buffer of the start of a line still being written
+ * @return The length of the line without the newline, -1 at the end of the
+ * stream
+ */
+static ssize_t stream_read_line(FILE *in, bool follow, char **line,
+                                size_t *capacity,
+                                cvector_vector_type(char) * partial) {
+    ssize_t length;
+    while (true) {
+        length = getline(line, capacity, in);
+        if (length > 0 && ((*line)[length - 1] == '\n' || !follow)) {
+            break;
+        }
+        if (length == -1 && !follow) {
+            return -1;
+        }
+        // the writer has not finished the line yet
+        ssize_t i;
+        for (i = 0; i < length; i++) {
+            cvector_push_back((*partial), (*line)[i]);
+        }
+        clearerr(in);
+        usleep(STREAM_FOLLOW_INTERVAL);
+    }
+    size_t n_partial = cvector_size((*partial));
+    if (n_partial > 0) {
+        if (*capacity < n_partial + length + 1) {
+            *capacity = n_partial + length + 1;
+            *line = (char *)realloc(*line, *capacity);
+            assert(*line != NULL);
+        }
+        memmove(*line + n_partial, *line, length + 1);
+        memcpy(*line, *partial, n_partial);
+        length += n_partial;
+        cvector_set_size((*partial), 0);
+    }
+    if ((*line)[length - 1] == '\n') {
+        (*line)[--length] = '\0';
+    }
+    return length;
+}
+
+/**
+ * @brief Read the next pane of a stream. The transactions are parsed as in
+ * @see transaction_parse(): empty lines are skipped, lines with only spaces
+ * are empty transactions.
+ *
+ * @param in The stream
+ * @param follow Whether to wait for new lines at the end of the file
+ * @param pane_size Number of transactions of a pane
+ * @param window The window, which assigns the ids of the items
+ * @param pane Where to store the pane
+ * @return true if the pane has transactions, false at the end of the stream
+ */
+static bool stream_read_pane(FILE *in, bool follow, uint64_t pane_size,
+                             StreamWindow *window, StreamPane *pane) {
+    static char *line = NULL;
+    static size_t capacity = 0;
+    static cvector_vector_type(char) partial = NULL;
+    ItemsetMap *map = itemset_map_new();
+    cvector_vector_type(int) keys = NULL;
+    pane->num_transactions = 0;
+    ssize_t length = 0;
+    while (pane->num_transactions < pane_size &&
+           (length = stream_read_line(in, follow, &line, &capacity,
+                                      &partial)) != -1) {
+        if (length == 0) {
+            continue;
+        }
+        cvector_set_size(keys, 0);
+        char *item = strtok(line, " ");
+        while (item != NULL) {
+            cvector_push_back(keys, stream_window_item_id(window, item,
+                                                          strlen(item) + 1));
+            item = strtok(NULL, " ");
+        }
+        // ids increase from the root, repeated items are counted once
+        int n_keys = cvector_size(keys), i, n_distinct = 0;
+        qsort(keys, n_keys, sizeof(int), stream_key_compare);
+        for (i = 0; i < n_keys; i++) {
+            if (i == 0 || keys[i] != keys[i - 1]) {
+                keys[n_distinct++] = keys[i];
+            }
+        }
+        if (n_distinct > 0) {
+            itemset_map_increment(map, keys, n_distinct, 1);
+        }
+        pane->num_transactions++;
+    }
+    cvector_free(keys);
+    pane->transactions = itemset_map_take_entries(map);
+    itemset_map_free(map);
+    if (length == -1) {
+        free(line);
+        cvector_free(partial);
+        line = NULL;
+        capacity = 0;
+        partial = NULL;
+    }
+    return pane->num_transactions > 0;
+}
+
+/**
+ * @brief Mine the frequent itemsets of the last transactions of a stream.
+ *
+ * Process 0 reads the transactions, one per line, in panes of pane_size
+ * transactions. After every pane it updates the window, made of the last
+ * window_size / pane_size panes, and broadcasts its tree; then every
+ * process mines its share of the itemsets of the window, as in
+ * @see mine_frequent_itemsets(). A line per pane is printed on stderr.
+ *
+ * @param filename Name of the file, "-" for the standard input
+ * @param window_size Number of transactions of the window
+ * @param pane_size Number of transactions of a pane, 0 to use
+ * STREAM_PANES panes
+ * @param follow Whether to wait for new lines at the end of the file, like
+ * tail -f, instead of stopping
+ * @param min_support Minimum support of a frequent itemset, as a fraction of
+ * the transactions of the window
+ * @param mode Which frequent itemsets are counted
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ */
+void stream_mine(char *filename, uint64_t window_size, uint64_t pane_size,
+                 bool follow, double min_support, MineMode mode, int rank,
+                 int world_size, int num_threads) {
+    if (pane_size == 0) {
+        pane_size = window_size / STREAM_PANES;
+    }
+    pane_size = pane_size == 0 ? 1 : pane_size;
+    int num_panes = window_size / pane_size;
+    num_panes = num_panes == 0 ? 1 : num_panes;
+
+    FILE *in = NULL;
+    StreamWindow window;
+    if (rank == 0) {
+        in = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+        if (in == NULL) {
+            fprintf(stderr, "Couldn't open file %s\n", filename);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        stream_window_init(&window, num_panes);
+        fprintf(stderr,
+                "stream: %d panes of %" PRIu64 " transactions, "
+                "pane, transactions, window_transactions, tree_size, "
+                "%s_itemsets, mine_time\n",
+                num_panes, pane_size, mine_mode_name(mode));
+    }
+
+    MPI_Datatype DT_TREE_NODE = define_datatype_tree_node();
+    cvector_vector_type(TreeNodeToSend) nodes = NULL;
+    uint64_t num_panes_read = 0, num_transactions = 0;
+    while (true) {
+        // number of nodes, 0 at the end of the stream, number of ids and
+        // minimum support count
+        uint64_t header[3] = {0, 0, 0};
+        if (rank == 0) {
+            trace_begin("inserted pane");
+            StreamPane pane;
+            if (stream_read_pane(in, follow, pane_size, &window, &pane)) {
+                stream_window_push(&window, pane);
+                stream_window_get_nodes(&window, &nodes);
+                num_transactions += pane.num_transactions;
+                int min_count = min_support * window.num_transactions;
+                header[0] = cvector_size(nodes);
+                header[1] = cvector_size(window.supports);
+                header[2] = min_count < 1 ? 1 : min_count;
+                memory_log("window_tree", tree_memory(window.tree));
+            } else {
+                weighted_itemsets_free(&(pane.transactions));
+            }
+            trace_end();
+        }
+        MPI_Bcast(header, 3, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+        if (header[0] == 0) {
+            break;
+        }
+
+        trace_begin("mined window");
+        double start = MPI_Wtime();
+        if (rank != 0) {
+            cvector_grow(nodes, header[0]);
+            cvector_set_size(nodes, header[0]);
+        }
+        broadcast_buffer(nodes, header[0], DT_TREE_NODE);
+        uint64_t count = 0, total = 0;
+        MineContext context = {header[2], mine_count_itemset, &count, mode};
+        mine_frequent_itemsets(&context, nodes, header[0], header[1], rank,
+                               world_size, num_threads);
+        MPI_Reduce(&count, &total, 1, MPI_UINT64_T, MPI_SUM, 0,
+                   MPI_COMM_WORLD);
+        double elapsed = MPI_Wtime() - start;
+        trace_end();
+        if (rank == 0)
+            fprintf(stderr,
+                    "stream: %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %zu, "
+                    "%" PRIu64 ", %lf\n",
+                    num_panes_read, num_transactions,
+                    window.num_transactions, stream_window_size(&window),
+                    total, elapsed);
+        num_panes_read++;
+    }
+    MPI_Type_free(&DT_TREE_NODE);
+    cvector_free(nodes);
+    if (rank == 0) {
+        if (in != stdin)
+            fclose(in);
+        stream_window_free(&window);
+    }
+}
@@ -0,0 +1,173 @@
+/**
+ * @file stream.h
+ * @brief Frequent itemsets of a sliding window over a stream of transactions
+ *
+ */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "mine.h"
+#include "tree.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @brief Default number of panes of a window, used when the pane size is
+ * not given
+ */
+#define STREAM_PANES 10
+/**
+ * @brief Microseconds waited at the end of a followed file before reading
+ * it again
+ */
+#define STREAM_FOLLOW_INTERVAL 100000
+
+/**
+ * @brief A batch of consecutive transactions of the stream, inserted into
+ * and removed from the window together
+ */
+typedef struct StreamPane {
+    /**
+     * @brief The distinct transactions of the pane as sorted item ids, with
+     * the number of times they occur
+     */
+    WeightedItemsetList transactions;
+    /**
+     * @brief Number of transactions of the pane, empty ones included
+     */
+    uint64_t num_transactions;
+} StreamPane;
+
+/**
+ * @brief FP-Tree of the last panes of a stream.
+ *
+ * The ids of the items are assigned in order of first occurrence and do not
+ * change while the items are in the window, so the paths of a pane can be
+ * removed exactly as they have been inserted. The id of an item that leaves
+ * the window is freed and given to the next new item, so the ids, and the
+ * cost of mining the window, are bounded by the items of the window rather
+ * than by the ones of the whole stream. The nodes whose value drops to 0
+ * are freed, their slots in the tree are set to NULL and reused by the next
+ * insertions.
+ */
+typedef struct StreamWindow {
+    /**
+     * @brief The tree, with NULL in the slots of the removed nodes
+     */
+    Tree tree;
+    /**
+     * @brief Indices of the NULL slots of the tree
+     */
+    cvector_vector_type(int) free_nodes;
+    /**
+     * @brief Map from item to its id
+     */
+    IndexMap index_map;
+    /**
+     * @brief Support of every id in the window
+     */
+    cvector_vector_type(int) supports;
+    /**
+     * @brief Item of every id, NULL for the free ids
+     */
+    cvector_vector_type(char *) items;
+    /**
+     * @brief The ids whose item has left the window
+     */
+    cvector_vector_type(int) free_ids;
+    /**
+     * @brief Ring of the panes of the window, the oldest one is first_pane
+     */
+    StreamPane *panes;
+    int num_panes;
+    int first_pane;
+    int used_panes;
+    /**
+     * @brief Number of transactions in the window
+     */
+    uint64_t num_transactions;
+} StreamWindow;
+
+/**
+ * @brief Instantiate an empty window
+ *
+ * @param window The window to initialize
+ * @param num_panes Number of panes kept in the window
+ */
+void stream_window_init(StreamWindow *window, int num_panes);
+
+/**
+ * @brief Free a window and its panes
+ *
+ * @param window The window
+ */
+void stream_window_free(StreamWindow *window);
+
+/**
+ * @brief Id of an item of the window, a free id is assigned to the items
+ * not in the window
+ *
+ * @param window The window
+ * @param key The item, with the trailing '\0'
+ * @param key_length Length of the item
+ * @return The id of the item
+ */
+int stream_window_item_id(StreamWindow *window, char *key, int key_length);
+
+/**
+ * @brief Insert a pane into the window. When the window is full, the oldest
+ * pane is removed from the tree first, and the ids of its items that are
+ * not in the new window are freed. The window becomes the owner of the
+ * transactions of the pane.
+ *
+ * @param window The window
+ * @param pane The pane
+ */
+void stream_window_push(StreamWindow *window, StreamPane pane);
+
+/**
+ * @brief Number of nodes of the tree of the window, the root included
+ *
+ * @param window The window
+ * @return The number of nodes that have not been removed
+ */
+size_t stream_window_size(StreamWindow *window);
+
+/**
+ * @brief Flatten the tree of the window, skipping the removed nodes. A
+ * parent can follow its children, as the slots are reused.
+ *
+ * @param window The window
+ * @param nodes Vector where the nodes are stored, the first one is the root
+ */
+void stream_window_get_nodes(StreamWindow *window,
+                             cvector_vector_type(TreeNodeToSend) * nodes);
+
+/**
+ * @brief Mine the frequent itemsets of the last transactions of a stream.
+ *
+ * Process 0 reads the transactions, one per line, in panes of pane_size
+ * transactions. After every pane it updates the window, made of the last
+ * window_size / pane_size panes, and broadcasts its tree; then every
+ * process mines its share of the itemsets of the window, as in
+ * @see mine_frequent_itemsets(). A line per pane is printed on stderr.
+ *
+ * @param filename Name of the file, "-" for the standard input
+ * @param window_size Number of transactions of the window
+ * @param pane_size Number of transactions of a pane, 0 to use
+ * STREAM_PANES panes
+ * @param follow Whether to wait for new lines at the end of the file, like
+ * tail -f, instead of stopping
+ * @param min_support Minimum support of a frequent itemset, as a fraction of
+ * the transactions of the window
+ * @param mode Which frequent itemsets are counted
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ */
+void stream_mine(char *filename, uint64_t window_size, uint64_t pane_size,
+                 bool follow, double min_support, MineMode mode, int rank,
+                 int world_size, int num_threads);
+
+#endif
@@ -0,0 +1,177 @@
+#include "subset.h"
+#include <assert.h>
+#include <stdlib.h>
+
+/**
+ * @brief Signature of an itemset, with the bits of its ids modulo 64
+ */
+static uint64_t subset_signature(const int *items, int n_items) {
+    uint64_t signature = 0;
+    int i;
+    for (i = 0; i < n_items; i++) {
+        signature |= 1UL << (items[i] % 64);
+    }
+    return signature;
+}
+
+/**
+ * @brief List of the itemsets with an item and a support, in an index by
+ * support
+ *
+ * @param index The index
+ * @param item The item id
+ * @param support The support count
+ * @param add Whether to add the list if it is missing
+ * @return The index of the list, or -1 if it is missing
+ */
+static int subset_bucket(SubsetIndex *index, int item, int support,
+                         bool add) {
+    int key[2] = {item, support}, bucket;
+    if (hashmap_get(index->buckets, key, sizeof(key), &bucket) == MAP_OK) {
+        return bucket;
+    }
+    if (!add) {
+        return -1;
+    }
+    bucket = cvector_size(index->lists);
+    cvector_push_back(index->lists, NULL);
+    hashmap_put(index->buckets, key, sizeof(key), bucket);
+    return bucket;
+}
+
+/**
+ * @brief Instantiate an empty index
+ *
+ * @param index The index to initialize
+ * @param num_keys Number of items, every id is in [0, num_keys)
+ * @param by_support Whether to split the lists of the items by support, to
+ * look for the supersets with a given support only
+ */
+void subset_index_init(SubsetIndex *index, int num_keys, bool by_support) {
+    index->items = NULL;
+    index->starts = NULL;
+    index->supports = NULL;
+    index->signatures = NULL;
+    index->lists = NULL;
+    index->buckets = by_support ? hashmap_new() : NULL;
+    index->num_keys = num_keys;
+    int i;
+    for (i = 0; i < num_keys && !by_support; i++) {
+        cvector_push_back(index->lists, NULL);
+    }
+    cvector_push_back(index->starts, 0);
+}
+
+/**
+ * @brief Free an index
+ *
+ * @param index The index
+ */
+void subset_index_free(SubsetIndex *index) {
+    size_t n = cvector_size(index->lists), i;
+    for (i = 0; i < n; i++) {
+        cvector_free(index->lists[i]);
+    }
+    cvector_free(index->lists);
+    if (index->buckets != NULL)
+        hashmap_free(index->buckets);
+    cvector_free(index->items);
+    cvector_free(index->starts);
+    cvector_free(index->supports);
+    cvector_free(index->signatures);
+    index->lists = NULL;
+    index->buckets = NULL;
+    index->items = NULL;
+    index->starts = NULL;
+    index->supports = NULL;
+    index->signatures = NULL;
+}
+
+/**
+ * @brief Number of itemsets of an index
+ *
+ * @param index The index
+ * @return The number of itemsets
+ */
+int subset_index_length(SubsetIndex *index) {
+    return cvector_size(index->supports);
+}
+
+/**
+ * @brief Add an itemset to an index
+ *
+ * @param index The index
+ * @param items The sorted ids of the items
+ * @param n_items Number of items, at least 1
+ * @param support Support count of the itemset
+ */
+void subset_index_add(SubsetIndex *index, const int *items, int n_items,
+                      int support) {
+    assert(n_items > 0);
+    int id = cvector_size(index->supports), i;
+    for (i = 0; i < n_items; i++) {
+        assert(items[i] >= 0 && items[i] < index->num_keys);
+        cvector_push_back(index->items, items[i]);
+        int bucket = index->buckets == NULL
+                         ? items[i]
+                         : subset_bucket(index, items[i], support, true);
+        cvector_push_back(index->lists[bucket], id);
+    }
+    cvector_push_back(index->starts, cvector_size(index->items));
+    cvector_push_back(index->supports, support);
+    cvector_push_back(index->signatures, subset_signature(items, n_items));
+}
+
+/**
+ * @brief Whether an itemset of the index contains the given one. Only the
+ * itemsets in the shortest list of its items are considered, with its
+ * support if the index is by support.
+ *
+ * @param index The index
+ * @param items The sorted ids of the items
+ * @param n_items Number of items, at least 1
+ * @param support Support count of the itemset
+ * @return true if a superset is found, which can be the itemset itself
+ */
+bool subset_index_has_superset(SubsetIndex *index, const int *items,
+                               int n_items, int support) {
+    assert(n_items > 0);
+    int i;
+    cvector_vector_type(int) list = NULL;
+    for (i = 0; i < n_items; i++) {
+        int bucket = index->buckets == NULL
+                         ? items[i]
+                         : subset_bucket(index, items[i], support, false);
+        if (bucket < 0) {
+            return false;
+        }
+        if (i == 0 ||
+            cvector_size(index->lists[bucket]) < cvector_size(list)) {
+            list = index->lists[bucket];
+        }
+    }
+    uint64_t signature = subset_signature(items, n_items);
+    size_t n = cvector_size(list), l;
+    for (l = 0; l < n; l++) {
+        int id = list[l];
+        size_t start = index->starts[id], end = index->starts[id + 1];
+        if ((signature & ~index->signatures[id]) != 0 ||
+            end - start < (size_t)n_items) {
+            continue;
+        }
+        // both are sorted
+        const int *other = index->items + start;
+        size_t n_other = end - start, j = 0;
+        for (i = 0; i < n_items && j < n_other; j++) {
+            if (other[j] == items[i]) {
+                i++;
+            } else if (other[j] > items[i]) {
+                break;
+            }
+        }
+        if (i == n_items) {
+            return true;
+        }
+    }
+    return false;
+}
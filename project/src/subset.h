@@ -0,0 +1,106 @@
+/**
+ * @file subset.h
+ * @brief Set of itemsets indexed by item, to find the supersets of an
+ * itemset
+ *
+ */
+#ifndef SUBSET_H
+#define SUBSET_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Set of itemsets with their support, with the list of the itemsets
+ * that contain every item or, if they are indexed by support, the list of
+ * the itemsets with every item and support. Every itemset has a signature with the
+ * bits of its ids modulo 64, so that most itemsets that do not contain
+ * another are discarded without merging them.
+ */
+typedef struct SubsetIndex {
+    /**
+     * @brief The ids of the items of all the itemsets, one after the other,
+     * each itemset sorted
+     */
+    cvector_vector_type(int) items;
+    /**
+     * @brief Position in items of the first id of every itemset, followed by
+     * the total number of ids
+     */
+    cvector_vector_type(size_t) starts;
+    /**
+     * @brief Support count of every itemset
+     */
+    cvector_vector_type(int) supports;
+    /**
+     * @brief Signature of every itemset
+     */
+    cvector_vector_type(uint64_t) signatures;
+    /**
+     * @brief Indices of the itemsets that contain every item id, or every
+     * pair of item id and support
+     */
+    cvector_vector_type(cvector_vector_type(int)) lists;
+    /**
+     * @brief Map from a pair of item id and support to its list, if the
+     * itemsets are indexed by support
+     */
+    map_t buckets;
+    /**
+     * @brief The ids of the items are in [0, num_keys)
+     */
+    int num_keys;
+} SubsetIndex;
+
+/**
+ * @brief Instantiate an empty index
+ *
+ * @param index The index to initialize
+ * @param num_keys Number of items, every id is in [0, num_keys)
+ * @param by_support Whether to split the lists of the items by support, to
+ * look for the supersets with a given support only
+ */
+void subset_index_init(SubsetIndex *index, int num_keys, bool by_support);
+
+/**
+ * @brief Free an index
+ *
+ * @param index The index
+ */
+void subset_index_free(SubsetIndex *index);
+
+/**
+ * @brief Number of itemsets of an index
+ *
+ * @param index The index
+ * @return The number of itemsets
+ */
+int subset_index_length(SubsetIndex *index);
+
+/**
+ * @brief Add an itemset to an index
+ *
+ * @param index The index
+ * @param items The sorted ids of the items
+ * @param n_items Number of items, at least 1
+ * @param support Support count of the itemset
+ */
+void subset_index_add(SubsetIndex *index, const int *items, int n_items,
+                      int support);
+
+/**
+ * @brief Whether an itemset of the index contains the given one. Only the
+ * itemsets in the shortest list of its items are considered, with its
+ * support if the index is by support.
+ *
+ * @param index The index
+ * @param items The sorted ids of the items
+ * @param n_items Number of items, at least 1
+ * @param support Support count of the itemset
+ * @return true if a superset is found, which can be the itemset itself
+ */
+bool subset_index_has_superset(SubsetIndex *index, const int *items,
+                               int n_items, int support);
+
+#endif
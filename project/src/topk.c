@@ -0,0 +1,265 @@
+#include "topk.h"
+#include "reduce.h"
+#include <assert.h>
+#include <mpi.h>
+#include <stdlib.h>
+
+/**
+ * @brief Instantiate an empty top-k
+ *
+ * @param top_k The top-k to initialize
+ * @param k Number of itemsets kept
+ * @param context The mining whose minimum support count is raised, NULL if
+ * none
+ */
+void top_k_init(TopK *top_k, int k, MineContext *context) {
+    assert(k > 0);
+    top_k->k = k;
+    top_k->heap = NULL;
+    top_k->context = context;
+    omp_init_lock(&top_k->lock);
+}
+
+/**
+ * @brief Free a top-k and its itemsets
+ *
+ * @param top_k The top-k
+ */
+void top_k_free(TopK *top_k) {
+    size_t n = cvector_size(top_k->heap), i;
+    for (i = 0; i < n; i++) {
+        cvector_free(top_k->heap[i].items);
+    }
+    cvector_free(top_k->heap);
+    top_k->heap = NULL;
+    omp_destroy_lock(&top_k->lock);
+}
+
+/**
+ * @brief Swap two itemsets of the heap
+ */
+static void top_k_swap(WeightedItemset *heap, int i, int j) {
+    WeightedItemset tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+}
+
+/**
+ * @brief Add an itemset to the heap if it is not full, or replace the root
+ * if the itemset has a higher support
+ *
+ * @param top_k The top-k
+ * @param items The ids of the items of the itemset, in decreasing order
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ */
+static void top_k_insert(TopK *top_k, const int *items, int n_items,
+                         int support) {
+    WeightedItemset *heap = top_k->heap;
+    int size = cvector_size(heap), i;
+    if (size == top_k->k && support <= heap[0].weight) {
+        return;
+    }
+    WeightedItemset itemset = {NULL, support};
+    for (i = n_items - 1; i >= 0; i--) {
+        cvector_push_back(itemset.items, items[i]);
+    }
+    if (size < top_k->k) {
+        // sift up
+        cvector_push_back(top_k->heap, itemset);
+        heap = top_k->heap;
+        for (i = size; i > 0 && heap[(i - 1) / 2].weight > heap[i].weight;
+             i = (i - 1) / 2) {
+            top_k_swap(heap, i, (i - 1) / 2);
+        }
+        return;
+    }
+    // sift down
+    cvector_free(heap[0].items);
+    heap[0] = itemset;
+    i = 0;
+    while (true) {
+        int smallest = i, child;
+        for (child = 2 * i + 1; child <= 2 * i + 2 && child < size; child++) {
+            if (heap[child].weight < heap[smallest].weight) {
+                smallest = child;
+            }
+        }
+        if (smallest == i) {
+            break;
+        }
+        top_k_swap(heap, i, smallest);
+        i = smallest;
+    }
+}
+
+/**
+ * @brief Visitor that offers an itemset to a top-k, and raises the minimum
+ * support count of the mining once the heap is full
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the TopK
+ */
+void top_k_visit(const int *items, int n_items, int support, void *data) {
+    TopK *top_k = (TopK *)data;
+    // the itemsets below the threshold are not kept anyway
+    if (top_k->context != NULL &&
+        support < mine_min_count(top_k->context)) {
+        return;
+    }
+    omp_set_lock(&top_k->lock);
+    top_k_insert(top_k, items, n_items, support);
+    if (top_k->context != NULL && (int)cvector_size(top_k->heap) == top_k->k) {
+        mine_raise_min_count(top_k->context, top_k->heap[0].weight + 1);
+    }
+    omp_unset_lock(&top_k->lock);
+}
+
+/**
+ * @brief Compare two support counts, used to sort them in decreasing order
+ */
+static int top_k_support_compare(const void *a, const void *b) {
+    int sa = *(const int *)a, sb = *(const int *)b;
+    return (sa < sb) - (sa > sb);
+}
+
+/**
+ * @brief Minimum support count of the top-k itemsets that can be derived
+ * from the supports of the single items: the k-th highest one, since there
+ * are at least k itemsets with that support. The items below it are removed.
+ *
+ * @param items_count The frequent items with their support count
+ * @param num_items Number of frequent items, updated
+ * @param min_count Minimum support count of the items
+ * @param k Number of itemsets kept
+ * @return The minimum support count, at least min_count
+ */
+int top_k_filter_items(hashmap_element *items_count, int *num_items,
+                       int min_count, int k) {
+    int n = *num_items, i, j;
+    if (n >= k) {
+        int *supports = (int *)malloc(n * sizeof(int));
+        assert(supports != NULL);
+        for (i = 0; i < n; i++) {
+            supports[i] = items_count[i].value;
+        }
+        qsort(supports, n, sizeof(int), top_k_support_compare);
+        min_count = supports[k - 1] > min_count ? supports[k - 1] : min_count;
+        free(supports);
+    }
+    // the order of the items left is kept, so it is the same on every
+    // process
+    for (i = 0, j = 0; i < n; i++) {
+        if (items_count[i].value >= min_count) {
+            items_count[j++] = items_count[i];
+        }
+    }
+    *num_items = j;
+    return min_count;
+}
+
+/**
+ * @brief Gather the itemsets of the top-k of every process into the one of
+ * process 0
+ *
+ * @param top_k The top-k of the current process
+ */
+void top_k_gather(TopK *top_k) {
+    // every itemset as its support, its number of items and the ids
+    cvector_vector_type(int) local = NULL;
+    size_t n = cvector_size(top_k->heap), i;
+    for (i = 0; i < n; i++) {
+        int n_items = cvector_size(top_k->heap[i].items), j;
+        cvector_push_back(local, top_k->heap[i].weight);
+        cvector_push_back(local, n_items);
+        // decreasing, as given to the visitor
+        for (j = n_items - 1; j >= 0; j--) {
+            cvector_push_back(local, top_k->heap[i].items[j]);
+        }
+    }
+    int *all;
+    uint64_t total, j;
+    gather_buffer(local, cvector_size(local), (void **)&all, &total, MPI_INT);
+    // the itemsets of process 0 are already in its heap, and first
+    for (j = cvector_size(local); j < total; j += all[j + 1] + 2) {
+        top_k_insert(top_k, all + j + 2, all[j + 1], all[j]);
+    }
+    free(all);
+    cvector_free(local);
+}
+
+/**
+ * @brief Compare two itemsets by decreasing support, then by size and ids
+ */
+static int top_k_itemset_compare(const void *a, const void *b) {
+    const WeightedItemset *ia = (const WeightedItemset *)a;
+    const WeightedItemset *ib = (const WeightedItemset *)b;
+    if (ia->weight != ib->weight) {
+        return (ia->weight < ib->weight) - (ia->weight > ib->weight);
+    }
+    int na = cvector_size(ia->items), nb = cvector_size(ib->items), i;
+    if (na != nb) {
+        return (na > nb) - (na < nb);
+    }
+    for (i = 0; i < na; i++) {
+        if (ia->items[i] != ib->items[i]) {
+            return (ia->items[i] > ib->items[i]) -
+                   (ia->items[i] < ib->items[i]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Print the itemsets of a top-k by decreasing support, one per line
+ * as the support count followed by the items. The heap is sorted, so no
+ * itemset can be added afterwards.
+ *
+ * @param top_k The top-k
+ * @param names Name of every item id, NULL to print the ids
+ * @param file Where to print
+ */
+void top_k_print(TopK *top_k, char **names, FILE *file) {
+    size_t n = cvector_size(top_k->heap), i, j;
+    qsort(top_k->heap, n, sizeof(WeightedItemset), top_k_itemset_compare);
+    for (i = 0; i < n; i++) {
+        WeightedItemset *itemset = &top_k->heap[i];
+        fprintf(file, "%d:", itemset->weight);
+        for (j = 0; j < cvector_size(itemset->items); j++) {
+            if (names != NULL)
+                fprintf(file, " %s", names[itemset->items[j]]);
+            else
+                fprintf(file, " %d", itemset->items[j]);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+/**
+ * @brief Mine the k itemsets with the highest support of a tree that every
+ * process has, raising the minimum support count as they are found, and
+ * gather them on process 0
+ *
+ * @param top_k The top-k to initialize, to be freed with @see top_k_free()
+ * @param k Number of itemsets kept
+ * @param nodes The nodes of the tree, the first one is the root
+ * @param num_nodes Number of nodes
+ * @param num_items Number of items, every node has an id in [0, num_items)
+ * @param min_count Minimum support count of the itemsets
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the tree
+ * @param num_threads Number of threads of every process
+ */
+void top_k_mine(TopK *top_k, int k, const TreeNodeToSend *nodes,
+                size_t num_nodes, int num_items, int min_count, int rank,
+                int world_size, int num_threads) {
+    MineContext context = {min_count, top_k_visit, top_k, MINE_ALL, true};
+    top_k_init(top_k, k, &context);
+    mine_frequent_itemsets(&context, nodes, num_nodes, num_items, rank,
+                           world_size, num_threads);
+    // the context is not needed once the itemsets are mined
+    top_k->context = NULL;
+    top_k_gather(top_k);
+}
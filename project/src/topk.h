@@ -0,0 +1,121 @@
+/**
+ * @file topk.h
+ * @brief Mining of the k most frequent itemsets, raising the minimum
+ * support while they are found
+ *
+ */
+#ifndef TOPK_H
+#define TOPK_H
+
+#include "mine.h"
+#include "types.h"
+#include <omp.h>
+#include <stdio.h>
+
+/**
+ * @brief The k itemsets with the highest support found so far, as a min-heap
+ * on the support. Once the heap is full, only an itemset with a higher
+ * support than its root can enter, so the minimum support count of the
+ * mining is raised above it.
+ */
+typedef struct TopK {
+    /**
+     * @brief Number of itemsets kept
+     */
+    int k;
+    /**
+     * @brief The heap, the weight of an itemset is its support count and the
+     * root has the lowest one
+     */
+    cvector_vector_type(WeightedItemset) heap;
+    /**
+     * @brief The mining whose minimum support count is raised, NULL if none
+     */
+    MineContext *context;
+    /**
+     * @brief Lock of the heap, taken by the visitor
+     */
+    omp_lock_t lock;
+} TopK;
+
+/**
+ * @brief Instantiate an empty top-k
+ *
+ * @param top_k The top-k to initialize
+ * @param k Number of itemsets kept
+ * @param context The mining whose minimum support count is raised, NULL if
+ * none
+ */
+void top_k_init(TopK *top_k, int k, MineContext *context);
+
+/**
+ * @brief Free a top-k and its itemsets
+ *
+ * @param top_k The top-k
+ */
+void top_k_free(TopK *top_k);
+
+/**
+ * @brief Visitor that offers an itemset to a top-k, and raises the minimum
+ * support count of the mining once the heap is full
+ *
+ * @param items The ids of the items of the itemset
+ * @param n_items Number of items
+ * @param support Support count of the itemset
+ * @param data Pointer to the TopK
+ */
+void top_k_visit(const int *items, int n_items, int support, void *data);
+
+/**
+ * @brief Minimum support count of the top-k itemsets that can be derived
+ * from the supports of the single items: the k-th highest one, since there
+ * are at least k itemsets with that support. The items below it are removed.
+ *
+ * @param items_count The frequent items with their support count
+ * @param num_items Number of frequent items, updated
+ * @param min_count Minimum support count of the items
+ * @param k Number of itemsets kept
+ * @return The minimum support count, at least min_count
+ */
+int top_k_filter_items(hashmap_element *items_count, int *num_items,
+                       int min_count, int k);
+
+/**
+ * @brief Gather the itemsets of the top-k of every process into the one of
+ * process 0
+ *
+ * @param top_k The top-k of the current process
+ */
+void top_k_gather(TopK *top_k);
+
+/**
+ * @brief Print the itemsets of a top-k by decreasing support, one per line
+ * as the support count followed by the items. The heap is sorted, so no
+ * itemset can be added afterwards.
+ *
+ * @param top_k The top-k
+ * @param names Name of every item id, NULL to print the ids
+ * @param file Where to print
+ */
+void top_k_print(TopK *top_k, char **names, FILE *file);
+
+/**
+ * @brief Mine the k itemsets with the highest support of a tree that every
+ * process has, raising the minimum support count as they are found, and
+ * gather them on process 0
+ *
+ * @param top_k The top-k to initialize, to be freed with @see top_k_free()
+ * @param k Number of itemsets kept
+ * @param nodes The nodes of the tree, the first one is the root
+ * @param num_nodes Number of nodes
+ * @param num_items Number of items, every node has an id in [0, num_items)
+ * @param min_count Minimum support count of the itemsets
+ * @param rank Rank of the current process
+ * @param world_size Number of processes that mine the tree
+ * @param num_threads Number of threads of every process
+ */
+void top_k_mine(TopK *top_k, int k, const TreeNodeToSend *nodes,
+                size_t num_nodes, int num_items, int min_count, int rank,
+                int world_size, int num_threads);
+
+#endif
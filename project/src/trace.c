@@ -0,0 +1,343 @@
+#include "trace.h"
+#include "memory.h"
+#include "perf.h"
+#include "cvector/cvector.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <mpi.h>
+#include <omp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Span open on a thread
+ */
+typedef struct TraceSpan {
+    const char *name;
+    double start;
+    uint64_t counters[TRACE_NUM_COUNTERS];
+} TraceSpan;
+
+/**
+ * @brief Closed span
+ */
+typedef struct TraceEvent {
+    const char *name;
+    double start;
+    double duration;
+    uint64_t counters[TRACE_NUM_COUNTERS];
+    /**
+     * @brief Hardware counters of the phase, only for the phases
+     */
+    uint64_t perf[PERF_NUM_COUNTERS];
+    bool has_perf;
+    /**
+     * @brief Resident set size at the end of the phase, only for the phases
+     */
+    uint64_t rss;
+    /**
+     * @brief Peak resident set size at the end of the phase
+     */
+    uint64_t peak_rss;
+    bool has_memory;
+} TraceEvent;
+
+/**
+ * @brief Tracing state of a thread
+ */
+typedef struct TraceThread {
+    int tid;
+    int depth;
+    TraceSpan stack[TRACE_MAX_DEPTH];
+    uint64_t counters[TRACE_NUM_COUNTERS];
+    cvector_vector_type(TraceEvent) events;
+} TraceThread;
+
+static int trace_rank = 0;
+static bool trace_debug = false;
+static bool trace_record = false;
+static double trace_origin = 0;
+static TraceThread *trace_threads[TRACE_MAX_THREADS];
+static int trace_num_threads = 0;
+static __thread TraceThread *trace_self = NULL;
+static __thread uint64_t trace_allocs = 0;
+
+/*
+ * The executable is linked with --wrap=malloc,--wrap=calloc,--wrap=realloc,
+ * so that the allocations made by the program are counted per thread.
+ */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    trace_allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    trace_allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    trace_allocs++;
+    return __real_realloc(ptr, size);
+}
+
+/**
+ * @brief Get the tracing state of the current thread, registering the
+ * thread on its first span
+ *
+ * @return The tracing state, or NULL if too many threads are tracing
+ */
+static TraceThread *trace_thread() {
+    if (trace_self == NULL) {
+        TraceThread *self = (TraceThread *)calloc(1, sizeof(TraceThread));
+        assert(self != NULL);
+#pragma omp critical(trace_register)
+        {
+            if (trace_num_threads < TRACE_MAX_THREADS) {
+                self->tid = trace_num_threads;
+                trace_threads[trace_num_threads++] = self;
+                trace_self = self;
+            }
+        }
+        if (trace_self == NULL) {
+            free(self);
+        }
+    }
+    return trace_self;
+}
+
+/**
+ * @brief Initialize the tracing of the current process. Must be called by
+ * all the processes, before any span is opened.
+ *
+ * @param rank Rank of the current process
+ * @param debug Whether to print the duration of the phases
+ * @param record Whether to record the events to write them with
+ * @see trace_write()
+ */
+void trace_init(int rank, bool debug, bool record) {
+    trace_rank = rank;
+    trace_debug = debug;
+    trace_record = record;
+    // the main thread is thread 0
+    trace_thread();
+    // align the time origins of the processes
+    MPI_Barrier(MPI_COMM_WORLD);
+    trace_origin = MPI_Wtime();
+    if (debug && rank == 0) {
+        printf("rank, time, msg\n");
+    }
+}
+
+/**
+ * @brief Open a span on the current thread
+ *
+ * @param name Name of the span, must be a string that outlives the trace
+ */
+void trace_begin(const char *name) {
+    TraceThread *self = trace_thread();
+    if (self == NULL) {
+        return;
+    }
+    assert(self->depth < TRACE_MAX_DEPTH);
+    bool phase = self->tid == 0 && self->depth == 0;
+    TraceSpan *span = &(self->stack[self->depth++]);
+    self->counters[TRACE_ALLOCS] = trace_allocs;
+    span->name = name;
+    memcpy(span->counters, self->counters, sizeof(span->counters));
+    if (phase) {
+        memory_phase_begin(name);
+        perf_phase_begin();
+    }
+    span->start = MPI_Wtime();
+}
+
+/**
+ * @brief Close the innermost span open on the current thread
+ *
+ * @return Duration of the span in seconds
+ */
+double trace_end() {
+    double end = MPI_Wtime();
+    TraceThread *self = trace_thread();
+    if (self == NULL) {
+        return 0;
+    }
+    assert(self->depth > 0);
+    TraceSpan *span = &(self->stack[--self->depth]);
+    self->counters[TRACE_ALLOCS] = trace_allocs;
+    double duration = end - span->start;
+    bool phase = self->tid == 0 && self->depth == 0;
+
+    TraceEvent event;
+    event.has_perf = phase && perf_enabled();
+    event.has_memory = phase && memory_enabled();
+    if (phase) {
+        perf_phase_end(span->name, event.perf);
+        memory_phase_end(&event.rss, &event.peak_rss);
+    }
+    if (trace_record) {
+        event.name = span->name;
+        event.start = span->start - trace_origin;
+        event.duration = duration;
+        int i;
+        for (i = 0; i < TRACE_NUM_COUNTERS; i++) {
+            event.counters[i] = self->counters[i] - span->counters[i];
+        }
+        cvector_push_back(self->events, event);
+    }
+    if (trace_debug && phase) {
+        printf("%d, %lf, %s\n", trace_rank, duration, span->name);
+    }
+    return duration;
+}
+
+/**
+ * @brief Increase a counter of the current thread
+ *
+ * @param counter The counter to increase
+ * @param amount Amount to add to the counter
+ */
+void trace_count(TraceCounter counter, uint64_t amount) {
+    TraceThread *self = trace_thread();
+    if (self != NULL) {
+        self->counters[counter] += amount;
+    }
+}
+
+/**
+ * @brief Append formatted text to a character vector
+ *
+ * @param buffer The vector
+ * @param format The printf format
+ */
+static void buffer_printf(cvector_vector_type(char) * buffer,
+                          const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    size_t size = cvector_size((*buffer));
+    if (cvector_capacity((*buffer)) < size + length + 1) {
+        cvector_grow((*buffer), 2 * (size + length + 1));
+    }
+    va_start(args, format);
+    vsnprintf((*buffer) + size, length + 1, format, args);
+    va_end(args);
+    cvector_set_size((*buffer), size + length);
+}
+
+/**
+ * @brief Write the events recorded by all the processes in a single Chrome
+ * trace JSON file. Must be called by all the processes; the events are
+ * gathered and written by process 0.
+ *
+ * @param filename Name of the file to write
+ */
+void trace_write(const char *filename) {
+    int world_size;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    // serialize the events of the current process
+    cvector_vector_type(char) buffer = NULL;
+    int t;
+    size_t i;
+    for (t = 0; t < trace_num_threads; t++) {
+        TraceThread *thread = trace_threads[t];
+        for (i = 0; i < cvector_size(thread->events); i++) {
+            TraceEvent *e = &(thread->events[i]);
+            buffer_printf(&buffer,
+                          "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,"
+                          "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{"
+                          "\"bytes_sent\":%" PRIu64 ",\"bytes_recv\":%" PRIu64
+                          ",\"allocs\":%" PRIu64,
+                          cvector_empty(buffer) ? "" : ",\n", e->name,
+                          trace_rank, thread->tid, e->start * 1e6,
+                          e->duration * 1e6, e->counters[TRACE_BYTES_SENT],
+                          e->counters[TRACE_BYTES_RECV],
+                          e->counters[TRACE_ALLOCS]);
+            int c;
+            for (c = 0; e->has_perf && c < PERF_NUM_COUNTERS; c++) {
+                if (e->perf[c] == PERF_UNAVAILABLE) {
+                    buffer_printf(&buffer, ",\"%s\":null",
+                                  perf_counter_name(c));
+                } else {
+                    buffer_printf(&buffer, ",\"%s\":%" PRIu64,
+                                  perf_counter_name(c), e->perf[c]);
+                }
+            }
+            if (e->has_memory) {
+                buffer_printf(&buffer,
+                              ",\"rss\":%" PRIu64 ",\"peak_rss\":%" PRIu64,
+                              e->rss, e->peak_rss);
+            }
+            buffer_printf(&buffer, "}}");
+        }
+    }
+    // name the processes after the ranks
+    buffer_printf(&buffer,
+                  "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                  "\"args\":{\"name\":\"rank %d\"}}",
+                  cvector_empty(buffer) ? "" : ",\n", trace_rank, trace_rank);
+
+    int length = cvector_size(buffer);
+    int *lengths = NULL, *displacements = NULL;
+    char *all = NULL;
+    if (trace_rank == 0) {
+        lengths = (int *)malloc(world_size * sizeof(int));
+        displacements = (int *)malloc(world_size * sizeof(int));
+    }
+    MPI_Gather(&length, 1, MPI_INT, lengths, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (trace_rank == 0) {
+        int total = 0, r;
+        for (r = 0; r < world_size; r++) {
+            displacements[r] = total;
+            total += lengths[r];
+        }
+        all = (char *)malloc(total + 1);
+        assert(all != NULL);
+    }
+    MPI_Gatherv(buffer, length, MPI_CHAR, all, lengths, displacements,
+                MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (trace_rank == 0) {
+        FILE *out = fopen(filename, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Couldn't write trace %s\n", filename);
+        } else {
+            int r;
+            fprintf(out, "{\"traceEvents\":[\n");
+            for (r = 0; r < world_size; r++) {
+                fprintf(out, "%s%.*s", r == 0 ? "" : ",\n", lengths[r],
+                        all + displacements[r]);
+            }
+            fprintf(out, "\n]}\n");
+            fclose(out);
+        }
+        free(all);
+        free(lengths);
+        free(displacements);
+    }
+    cvector_free(buffer);
+}
+
+/**
+ * @brief Free the events recorded by the current process
+ */
+void trace_free() {
+    int t;
+    for (t = 0; t < trace_num_threads; t++) {
+        cvector_free(trace_threads[t]->events);
+        free(trace_threads[t]);
+        trace_threads[t] = NULL;
+    }
+    trace_num_threads = 0;
+    trace_self = NULL;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file trace.h
+ * @brief Instrumentation of the phases of the program with nested spans
+ *
+ * Every thread keeps a stack of open spans. When a span is closed, an event
+ * with its start time, duration and the counters accumulated by the thread
+ * while it was open is recorded. At the end of the run the events of all
+ * the threads of all the processes are written to a single file in the
+ * Chrome trace event format (chrome://tracing, Perfetto), where the process
+ * id is the MPI rank.
+ *
+ * The spans opened by the main thread outside of any other span are the
+ * phases of the program: when the debug log is enabled their duration is
+ * also printed as a "rank, time, msg" line, and the hardware counters (see
+ * perf.h) and the memory usage (see memory.h) are collected for every phase
+ * when enabled.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum nesting of the spans of a thread
+ */
+#define TRACE_MAX_DEPTH 32
+/**
+ * @brief Maximum number of threads of a process that can record spans
+ */
+#define TRACE_MAX_THREADS 256
+
+/**
+ * @brief Counters accumulated by the threads and attached to the spans
+ */
+typedef enum TraceCounter {
+    /**
+     * @brief Bytes sent to other processes
+     */
+    TRACE_BYTES_SENT,
+    /**
+     * @brief Bytes received from other processes
+     */
+    TRACE_BYTES_RECV,
+    /**
+     * @brief Number of calls to malloc, calloc and realloc
+     */
+    TRACE_ALLOCS,
+    /**
+     * @brief Number of counters
+     */
+    TRACE_NUM_COUNTERS
+} TraceCounter;
+
+/**
+ * @brief Initialize the tracing of the current process. Must be called by
+ * all the processes, before any span is opened.
+ *
+ * @param rank Rank of the current process
+ * @param debug Whether to print the duration of the phases
+ * @param record Whether to record the events to write them with
+ * @see trace_write()
+ */
+void trace_init(int rank, bool debug, bool record);
+
+/**
+ * @brief Open a span on the current thread
+ *
+ * @param name Name of the span, must be a string that outlives the trace
+ */
+void trace_begin(const char *name);
+
+/**
+ * @brief Close the innermost span open on the current thread
+ *
+ * @return Duration of the span in seconds
+ */
+double trace_end();
+
+/**
+ * @brief Increase a counter of the current thread
+ *
+ * @param counter The counter to increase
+ * @param amount Amount to add to the counter
+ */
+void trace_count(TraceCounter counter, uint64_t amount);
+
+/**
+ * @brief Write the events recorded by all the processes in a single Chrome
+ * trace JSON file. Must be called by all the processes; the events are
+ * gathered and written by process 0.
+ *
+ * @param filename Name of the file to write
+ */
+void trace_write(const char *filename);
+
+/**
+ * @brief Free the events recorded by the current process
+ */
+void trace_free();
+
+#endif
@@ -1,6 +1,9 @@
 #include "tree.h"
 #include "io.h"
-#include "sort.h"
+#include "memory.h"
+#include "trace.h"
+#include "utils.h"
+#include <limits.h>
 #include <omp.h>
 #include <stdio.h>
 #include <string.h>
@@ -21,6 +24,7 @@ TreeNode *tree_node_new(int key, int value, int parent) {
     node->parent = parent;
     node->adj = hashmap_new();
     assert(node->adj != NULL);
+    node->chain = NULL;
     return node;
 }
 
@@ -32,6 +36,7 @@ TreeNode *tree_node_new(int key, int value, int parent) {
 void tree_node_free(TreeNode *node) {
     if (node != NULL) {
         hashmap_free(node->adj);
+        cvector_free(node->chain);
         free(node);
     }
 }
@@ -55,8 +60,8 @@ Tree tree_new() {
  */
 void tree_free(Tree *tree) {
     if (*tree != NULL) {
-        int n_nodes = cvector_size((*tree));
-        int i;
+        size_t n_nodes = cvector_size((*tree));
+        size_t i;
         for (i = 0; i < n_nodes; i++) {
             tree_node_free((*tree)[i]);
         }
@@ -65,6 +70,25 @@ void tree_free(Tree *tree) {
     }
 }
 
+/**
+ * @brief Number of bytes allocated by a tree, including the adjacency map
+ * of every node
+ *
+ * @param tree The tree
+ * @return The number of bytes
+ */
+size_t tree_memory(Tree tree) {
+    size_t bytes = cvector_memory(tree);
+    size_t i;
+    for (i = 0; i < cvector_size(tree); i++) {
+        if (tree[i] != NULL) {
+            bytes += sizeof(TreeNode) + hashmap_memory(tree[i]->adj) +
+                     cvector_memory(tree[i]->chain);
+        }
+    }
+    return bytes;
+}
+
 /**
  * @brief Add a node to the tree
  *
@@ -73,6 +97,8 @@ void tree_free(Tree *tree) {
  * @return The id of the node in the tree
  */
 int tree_add_node(Tree *tree, TreeNode *node) {
+    // node ids are int: refuse to silently overflow them
+    assert(cvector_size((*tree)) < INT_MAX);
     cvector_push_back((*tree), node);
     assert(*tree != NULL); // the malloc has not failed
     int new_id = cvector_size((*tree)) - 1;
@@ -82,35 +108,343 @@ int tree_add_node(Tree *tree, TreeNode *node) {
     return new_id;
 }
 
+/**
+ * @brief Number of items of a node, i.e. its key and its chain
+ *
+ * @param node The node
+ * @return The number of items
+ */
+static inline int node_length(TreeNode *node) {
+    return 1 + cvector_size(node->chain);
+}
+
+/**
+ * @brief Get an item of a node
+ *
+ * @param node The node
+ * @param j Position of the item, 0 being the key
+ * @return The id of the item
+ */
+static inline int node_item(TreeNode *node, int j) {
+    return j == 0 ? node->key : node->chain[j - 1];
+}
+
+/**
+ * @brief Remove the first items of a node, which becomes the node of the
+ * items left
+ *
+ * @param node The node
+ * @param length Number of items to remove, less than the length of the node
+ */
+static void node_drop_items(TreeNode *node, int length) {
+    int n = cvector_size(node->chain);
+    assert(length > 0 && length <= n);
+    node->key = node->chain[length - 1];
+    if (length == n) {
+        cvector_free(node->chain);
+        node->chain = NULL;
+    } else {
+        memmove(node->chain, node->chain + length,
+                (n - length) * sizeof(int));
+        cvector_set_size(node->chain, n - length);
+    }
+}
+
+/**
+ * @brief Pending operation of an iterative merge
+ */
+typedef struct MergeStep {
+    /**
+     * @brief Id of the node in the destination tree
+     */
+    int nd;
+    /**
+     * @brief Id of the node in the source tree, or TREE_NODE_NULL if the
+     * node has already been moved to the destination tree in position nd
+     */
+    int ns;
+} MergeStep;
+
+/**
+ * @brief Destination of the nodes moved by a merge.
+ *
+ * Nodes with id lower than base live in the destination tree, while the
+ * moved nodes are appended to extra, the node with id i being
+ * extra[i - base]. A sequential merge appends directly to the destination
+ * tree (extra is the destination and base is 0). The tasks of a parallel
+ * merge append to private vectors, spliced into the destination at the end.
+ */
+typedef struct MergeTarget {
+    /**
+     * @brief The destination tree
+     */
+    Tree *dest;
+    /**
+     * @brief The vector where moved nodes are appended
+     */
+    Tree *extra;
+    /**
+     * @brief Id of the first node of extra
+     */
+    int base;
+} MergeTarget;
+
+/**
+ * @brief Get the node with the given id in the merge target
+ *
+ * @param target The merge target
+ * @param id Id of the node
+ * @return Pointer to the node
+ */
+static inline TreeNode *target_node(MergeTarget *target, int id) {
+    return id < target->base ? (*target->dest)[id]
+                             : (*target->extra)[id - target->base];
+}
+
+/**
+ * @brief Append a node to the merge target
+ *
+ * @param target The merge target
+ * @param node The node to append
+ * @return The id of the node
+ */
+static inline int target_push(MergeTarget *target, TreeNode *node) {
+    // node ids are int: refuse to silently overflow them
+    assert(target->base + cvector_size((*target->extra)) < INT_MAX);
+    cvector_push_back((*target->extra), node);
+    return target->base + cvector_size((*target->extra)) - 1;
+}
+
+/**
+ * @brief Split the chain of the node id of the merge target after its first
+ * length items: the items left become a new node, child of the node, that
+ * takes the value and the children of the node.
+ *
+ * The new node is appended to the merge target and linked in the adjacency
+ * map of the node, which is a new one; it is linked again when spliced if
+ * the node is in the destination tree.
+ *
+ * @param target The merge target
+ * @param id Id of the node
+ * @param length Number of items kept by the node, less than its length
+ */
+static void target_split_node(MergeTarget *target, int id, int length) {
+    TreeNode *node = target_node(target, id);
+    int n = node_length(node), j;
+    assert(length > 0 && length < n);
+    TreeNode *bottom = tree_node_new(node_item(node, length), node->value, id);
+    for (j = length + 1; j < n; j++) {
+        cvector_push_back(bottom->chain, node_item(node, j));
+    }
+    if (length == 1) {
+        cvector_free(node->chain);
+        node->chain = NULL;
+    } else {
+        cvector_set_size(node->chain, length - 1);
+    }
+    map_t adj = bottom->adj;
+    bottom->adj = node->adj;
+    node->adj = adj;
+    int bottom_id = target_push(target, bottom);
+    hashmap_put(node->adj, &(bottom->key), sizeof(int), bottom_id);
+    int pos = 0;
+    hashmap_element *el;
+    while ((el = hashmap_next(bottom->adj, &pos)) != NULL) {
+        target_node(target, el->value)->parent = bottom_id;
+    }
+}
+
+/**
+ * @brief Move the node ns of the source tree as a child of the node nd of
+ * the merge target, and push the step that moves its children.
+ *
+ * The node is linked in the adjacency map of nd only if nd has been moved
+ * too; children of the destination tree nodes are linked when the extra
+ * nodes are spliced into the destination tree.
+ *
+ * @param target The merge target
+ * @param source The source tree
+ * @param nd Id of the new parent in the merge target
+ * @param ns Id of the node in the source tree
+ * @param stack The stack of pending operations
+ */
+static void target_move_node(MergeTarget *target, Tree source, int nd, int ns,
+                             cvector_vector_type(MergeStep) * stack) {
+    TreeNode *node = source[ns];
+    source[ns] = NULL;
+    node->parent = nd;
+    int id = target_push(target, node);
+    if (nd >= target->base) {
+        hashmap_put(target_node(target, nd)->adj, &(node->key), sizeof(int),
+                    id);
+    }
+    MergeStep step = {id, TREE_NODE_NULL};
+    cvector_push_back((*stack), step);
+}
+
+/**
+ * @brief Move the children of the node nd of the merge target, which has
+ * been moved from the source tree and still has the source ids in its
+ * adjacency map, and push them on the stack to move their own children.
+ *
+ * The adjacency map of the node is kept, and its values are updated in
+ * place with the ids of the children in the merge target.
+ *
+ * @param target The merge target
+ * @param source The source tree
+ * @param nd Id of the moved node in the merge target
+ * @param stack The stack of pending operations
+ */
+static void target_move_children(MergeTarget *target, Tree source, int nd,
+                                 cvector_vector_type(MergeStep) * stack) {
+    int pos = 0;
+    hashmap_element *el;
+    while ((el = hashmap_next(target_node(target, nd)->adj, &pos)) != NULL) {
+        TreeNode *child = source[el->value];
+        assert(child != NULL);
+        source[el->value] = NULL;
+        child->parent = nd;
+        el->value = target_push(target, child);
+        MergeStep step = {el->value, TREE_NODE_NULL};
+        cvector_push_back((*stack), step);
+    }
+}
+
+/**
+ * @brief Merge the node ns of the source tree into the children of the node
+ * nd of the merge target, and push the step that merges its children.
+ *
+ * The items of the node are matched against the chain of the child with the
+ * same key, which is split where they differ or where the node ends. The
+ * items left after the child, if any, are merged into the children of the
+ * child in the same way, dropping the matched items from the source node.
+ * The node is moved when no child has its first item left.
+ *
+ * @param target The merge target
+ * @param source The source tree
+ * @param nd Id of the node in the merge target
+ * @param ns Id of the node in the source tree
+ * @param stack The stack of pending operations
+ */
+static void target_merge_node(MergeTarget *target, Tree source, int nd, int ns,
+                              cvector_vector_type(MergeStep) * stack) {
+    TreeNode *node = source[ns];
+    while (true) {
+        int dest_pos;
+        // if no node with the same key(item) is present in the children of
+        // nd, move the node and the subtree rooted in it to the node nd
+        if (hashmap_get(target_node(target, nd)->adj, &(node->key),
+                        sizeof(int), &dest_pos) != MAP_OK) {
+            target_move_node(target, source, nd, ns, stack);
+            return;
+        }
+        // otherwise increment the counter of the common items
+        TreeNode *dest_node = target_node(target, dest_pos);
+        int length = node_length(node), dest_length = node_length(dest_node);
+        int common = 1;
+        while (common < length && common < dest_length &&
+               node_item(node, common) == node_item(dest_node, common)) {
+            common++;
+        }
+        if (common < dest_length) {
+            target_split_node(target, dest_pos, common);
+        }
+        dest_node->value += node->value;
+        if (common == length) {
+            MergeStep next = {dest_pos, ns};
+            cvector_push_back((*stack), next);
+            return;
+        }
+        node_drop_items(node, common);
+        nd = dest_pos;
+    }
+}
+
+/**
+ * @brief Run the pending operations of the stack until it is empty.
+ *
+ * An operation with a source node merges the children of the source node
+ * into the children of the destination node. An operation without a source
+ * node moves the children of an already moved node.
+ *
+ * @param target The merge target
+ * @param source The source tree
+ * @param stack The stack of pending operations
+ */
+static void target_merge_steps(MergeTarget *target, Tree source,
+                               cvector_vector_type(MergeStep) * stack) {
+    while (!cvector_empty((*stack))) {
+        MergeStep step = (*stack)[cvector_size((*stack)) - 1];
+        cvector_pop_back((*stack));
+        if (step.ns == TREE_NODE_NULL) {
+            target_move_children(target, source, step.nd, stack);
+            continue;
+        }
+        int pos = 0;
+        hashmap_element *el;
+        // foreach child of node ns in source
+        while ((el = hashmap_next(source[step.ns]->adj, &pos)) != NULL) {
+            assert(el->value != step.ns);
+            target_merge_node(target, source, step.nd, el->value, stack);
+        }
+    }
+}
+
+/**
+ * @brief Append the nodes moved by a task of a parallel merge to the
+ * destination tree, remapping their ids, and link the moved subtrees to
+ * their parents in the destination tree. The children in the destination
+ * tree of the nodes split from it get the new id of their parent.
+ *
+ * @param dest Pointer to the destination tree
+ * @param extra The nodes moved by the task
+ * @param base Id of the first node of extra during the merge
+ */
+static void tree_splice(Tree *dest, Tree extra, int base) {
+    int offset = cvector_size((*dest));
+    int n_extra = cvector_size(extra);
+    int i;
+    for (i = 0; i < n_extra; i++) {
+        TreeNode *node = extra[i];
+        int pos = 0;
+        hashmap_element *el;
+        while ((el = hashmap_next(node->adj, &pos)) != NULL) {
+            if (el->value >= base) {
+                el->value += offset - base;
+            } else {
+                (*dest)[el->value]->parent = offset + i;
+            }
+        }
+        if (node->parent >= base) {
+            node->parent += offset - base;
+            cvector_push_back((*dest), node);
+        } else {
+            // root of a moved subtree
+            assert(tree_add_node(dest, node) == offset + i);
+        }
+    }
+}
+
 /**
  * @brief Add the subtree rooted in the ns(th) node of the tree
  * source as a child of the nd(th) node of the tree dest. The
  * source tree is modified, as the nodes are moved to the
  * destination tree.
  *
+ * The nodes are relinked with an explicit stack: they keep their adjacency
+ * maps, whose values are remapped in place to the new ids.
+ *
  * @param dest Pointer to the destination tree
  * @param source Pointer to the source tree
  * @param nd Id of the node in the destination tree
  * @param ns Id of the node in the source tree
  */
 void tree_add_subtree(Tree *dest, Tree source, int nd, int ns) {
-    // add node ns
-    cvector_vector_type(hashmap_element) neighbours = NULL;
-    hashmap_get_elements(source[ns]->adj, &neighbours);
-    hashmap_free(source[ns]->adj);
-    source[ns]->adj = hashmap_new();
-    source[ns]->parent = nd;
-    int new_pos = tree_add_node(dest, source[ns]);
-    int num_adj_s = cvector_size(neighbours);
-
-    // recursively add children
-    int i;
-    for (i = 0; i < num_adj_s; i++) {
-        assert(neighbours[i].value != ns);
-        tree_add_subtree(dest, source, new_pos, neighbours[i].value);
-    }
-    source[ns] = NULL;
-    cvector_free(neighbours);
+    MergeTarget target = {dest, dest, 0};
+    cvector_vector_type(MergeStep) stack = NULL;
+    target_move_node(&target, source, nd, ns, &stack);
+    target_merge_steps(&target, source, &stack);
+    cvector_free(stack);
 }
 
 /**
@@ -118,63 +452,475 @@ void tree_add_subtree(Tree *dest, Tree source, int nd, int ns) {
  * with the subtree of source rooted in ns and store the result in dest.
  * Also the source tree is modified.
  *
+ * The visit uses an explicit stack, so its depth is not bounded by the
+ * call stack, and moves the nodes without copying the adjacency maps.
+ *
  * @param dest The destination tree
  * @param source The source tree
  * @param nd Id of the node in the destination tree
  * @param ns Id of the node in the source tree
  */
 void tree_merge_dfs(Tree *dest, Tree source, int nd, int ns) {
+    MergeTarget target = {dest, dest, 0};
+    cvector_vector_type(MergeStep) stack = NULL;
+    MergeStep step = {nd, ns};
+    cvector_push_back(stack, step);
+    target_merge_steps(&target, source, &stack);
+    cvector_free(stack);
+}
+
+/**
+ * @brief Merge the trees dest and source and store the result in dest.
+ * The source tree is modified. It is a wrapper for @see tree_merge_dfs()
+ *
+ * @param dest The destination tree
+ * @param source The source tree
+ */
+void tree_merge(Tree *dest, Tree source) { tree_merge_dfs(dest, source, 0, 0); }
+
+/**
+ * @brief Merge the subtree rooted in the root child ns of source into the
+ * destination tree, as a task of a parallel merge
+ *
+ * @param dest The destination tree, which is not resized by the task
+ * @param source The source tree
+ * @param ns Id of the child of the root in the source tree
+ * @param extra Private vector where the moved nodes are appended
+ * @param base Number of nodes of the destination tree
+ */
+static void tree_merge_root_child(Tree *dest, Tree source, int ns,
+                                  Tree *extra, int base) {
+    MergeTarget target = {dest, extra, base};
+    cvector_vector_type(MergeStep) stack = NULL;
+    target_merge_node(&target, source, 0, ns, &stack);
+    target_merge_steps(&target, source, &stack);
+    cvector_free(stack);
+}
+
+/**
+ * @brief Merge the trees dest and source in parallel and store the result
+ * in dest. The source tree is modified.
+ *
+ * The subtrees rooted in the children of the root of source, i.e. the paths
+ * starting with different items, are disjoint, so they are merged by
+ * independent OpenMP tasks. The nodes moved by each task are appended to a
+ * private vector, then spliced into dest once all the tasks are done. If
+ * called inside a parallel region the tasks are run by the current team,
+ * otherwise a team of num_threads threads is started.
+ *
+ * @param dest The destination tree
+ * @param source The source tree
+ * @param num_threads The number of threads requested to perform the merge
+ */
+void tree_merge_parallel(Tree *dest, Tree source, int num_threads) {
+    if (num_threads <= 1 && !omp_in_parallel()) {
+        tree_merge(dest, source);
+        return;
+    }
+    cvector_vector_type(int) children = NULL;
+    int pos = 0;
+    hashmap_element *el;
+    while ((el = hashmap_next(source[0]->adj, &pos)) != NULL) {
+        cvector_push_back(children, el->value);
+    }
+    int n_children = cvector_size(children);
+    int base = cvector_size((*dest));
+    Tree *extras = (Tree *)calloc(n_children, sizeof(Tree));
     int i;
-    cvector_vector_type(hashmap_element) neighbours = NULL;
-    hashmap_get_elements(source[ns]->adj, &neighbours);
-    int num_adj_s = cvector_size(neighbours);
-    // foreach neighbour of node ns in source
-    for (i = 0; i < num_adj_s; i++) {
-        int source_pos = neighbours[i].value;
-        assert(ns != neighbours[i].value);
-        // if a node with the same key(item) is already present in the
-        // children of nd, just increment the counter
-        int dest_pos;
-        if (hashmap_get((*dest)[nd]->adj, neighbours[i].key, sizeof(int),
-                        &dest_pos) == MAP_OK) {
 
-            (*dest)[dest_pos]->value += source[source_pos]->value;
+    if (omp_in_parallel()) {
+        for (i = 0; i < n_children; i++) {
+#pragma omp task default(none) firstprivate(i)                                 \
+    shared(dest, source, children, extras, base)
+            tree_merge_root_child(dest, source, children[i], &(extras[i]),
+                                  base);
+        }
+#pragma omp taskwait
+    } else {
+#pragma omp parallel default(none) private(i)                                  \
+    shared(dest, source, children, extras, base, n_children)                   \
+        num_threads(num_threads)
+#pragma omp single
+        for (i = 0; i < n_children; i++) {
+#pragma omp task default(none) firstprivate(i)                                 \
+    shared(dest, source, children, extras, base)
+            tree_merge_root_child(dest, source, children[i], &(extras[i]),
+                                  base);
+        }
+    }
 
-            tree_merge_dfs(dest, source, dest_pos, source_pos);
+    for (i = 0; i < n_children; i++) {
+        tree_splice(dest, extras[i], base);
+        cvector_free(extras[i]);
+    }
+    free(extras);
+    cvector_free(children);
+}
 
-        } else {
-            // otherwise add the child and the subtree rooted in it to
-            // the node nd in dest
-            tree_add_subtree(dest, source, nd, source_pos);
+/**
+ * @brief Serialize a tree with its chains compacted, in the style of a
+ * Patricia trie: every node is a record, and a node whose only child has
+ * the same value absorbs it, so a chain of such nodes is a single record
+ * made of the position of the record of its parent (0 for the root, the
+ * records start from 1), the value, the number of items and their ids from
+ * the top of the chain.
+ *
+ * The records are in depth-first order, so every record comes after the one
+ * of its parent and the subtree of every child of the root is a contiguous
+ * range of records. They are merged into compact trees, see
+ * @see tree_merge_chains(), and mined as they are, see
+ * @see mine_frequent_itemsets_chains().
+ *
+ * @param tree The tree
+ * @param chains The vector where the records are appended
+ * @return The number of records
+ */
+uint64_t tree_get_chains(Tree tree, cvector_vector_type(int) * chains) {
+    // pairs of the head of a chain and the record of its parent
+    cvector_vector_type(int) stack = NULL;
+    uint64_t num_records = 0;
+    int pos = 0;
+    hashmap_element *el;
+    while ((el = hashmap_next(tree[0]->adj, &pos)) != NULL) {
+        cvector_push_back(stack, el->value);
+        cvector_push_back(stack, 0);
+    }
+    while (!cvector_empty(stack)) {
+        size_t top = cvector_size(stack);
+        int curr = stack[top - 2], parent = stack[top - 1];
+        cvector_set_size(stack, top - 2);
+        int record = ++num_records;
+        cvector_push_back((*chains), parent);
+        cvector_push_back((*chains), tree[curr]->value);
+        size_t length = cvector_size((*chains));
+        cvector_push_back((*chains), 0);
+        int j;
+        for (j = 0; j < node_length(tree[curr]); j++) {
+            cvector_push_back((*chains), node_item(tree[curr], j));
+        }
+        while (hashmap_length(tree[curr]->adj) == 1) {
+            pos = 0;
+            int child = hashmap_next(tree[curr]->adj, &pos)->value;
+            if (tree[child]->value != tree[curr]->value) {
+                break;
+            }
+            curr = child;
+            for (j = 0; j < node_length(tree[curr]); j++) {
+                cvector_push_back((*chains), node_item(tree[curr], j));
+            }
+        }
+        (*chains)[length] = cvector_size((*chains)) - length - 1;
+        pos = 0;
+        while ((el = hashmap_next(tree[curr]->adj, &pos)) != NULL) {
+            cvector_push_back(stack, el->value);
+            cvector_push_back(stack, record);
         }
     }
-    cvector_free(neighbours);
+    cvector_free(stack);
+    return num_records;
 }
 
 /**
- * @brief Merge the trees dest and source and store the result in dest.
- * The source tree is modified. It is a wrapper for @see tree_merge_dfs()
+ * @brief Expand the compacted records of a tree, see @see tree_get_chains(),
+ * into a node per item
+ *
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param nodes The vector where the nodes are appended, the first one being
+ * the root
+ */
+void tree_chains_to_nodes(const int *chains, uint64_t size,
+                          cvector_vector_type(TreeNodeToSend) * nodes) {
+    // the node at the bottom of every chain, the root for record 0
+    cvector_vector_type(int) ends = NULL;
+    cvector_push_back(ends, 0);
+    TreeNodeToSend root = {TREE_NODE_NULL, -1, 0};
+    size_t base = cvector_size((*nodes));
+    cvector_push_back((*nodes), root);
+    uint64_t i = 0;
+    while (i < size) {
+        int curr = ends[chains[i]], value = chains[i + 1];
+        int length = chains[i + 2], j;
+        for (j = 0; j < length; j++) {
+            TreeNodeToSend node = {chains[i + 3 + j], value, curr};
+            cvector_push_back((*nodes), node);
+            curr = cvector_size((*nodes)) - 1 - base;
+        }
+        cvector_push_back(ends, curr);
+        i += length + 3;
+    }
+    cvector_free(ends);
+}
+
+/**
+ * @brief Add a path of items below the node curr of the merge target,
+ * adding value to the nodes of the items already there. A chain that the
+ * path leaves, or ends in, is split there.
+ *
+ * A node of the destination tree gets a new child once at most when the
+ * added paths are distinct, so the children linked only when spliced are
+ * never looked up again.
+ *
+ * @param target The merge target
+ * @param curr Id of the node where the path starts
+ * @param keys The ids of the items of the path
+ * @param n_keys Number of ids
+ * @param value The value to add
+ * @param compact Whether the items that are not in the merge target become
+ * a single chain node, instead of a node per item
+ * @return Id of the node of the last item of the path
+ */
+static int target_add_items(MergeTarget *target, int curr, const int *keys,
+                            int n_keys, int value, bool compact) {
+    int i = 0, next;
+    while (i < n_keys && hashmap_get(target_node(target, curr)->adj,
+                                     (void *)&(keys[i]), sizeof(int),
+                                     &next) == MAP_OK) {
+        TreeNode *node = target_node(target, next);
+        int length = node_length(node), common = 1;
+        while (common < length && i + common < n_keys &&
+               node_item(node, common) == keys[i + common]) {
+            common++;
+        }
+        if (common < length) {
+            target_split_node(target, next, common);
+        }
+        node->value += value;
+        i += common;
+        curr = next;
+    }
+    while (i < n_keys) {
+        TreeNode *node = tree_node_new(keys[i], value, curr);
+        int length = compact ? n_keys - i : 1, j;
+        for (j = 1; j < length; j++) {
+            cvector_push_back(node->chain, keys[i + j]);
+        }
+        next = target_push(target, node);
+        if (curr >= target->base) {
+            hashmap_put(target_node(target, curr)->adj, &(node->key),
+                        sizeof(int), next);
+        }
+        i += length;
+        curr = next;
+    }
+    return curr;
+}
+
+/**
+ * @brief Add the paths of a range of compacted records to the merge target,
+ * adding the value of every record to the nodes of its items
+ *
+ * @param target The merge target
+ * @param chains The records
+ * @param start Position of the first record of the range
+ * @param end Position after the last record of the range
+ * @param first Index of the first record of the range
+ * @param ends The node at the bottom of every record, filled for the range
+ */
+static void target_merge_chains(MergeTarget *target, const int *chains,
+                                uint64_t start, uint64_t end, int first,
+                                int *ends) {
+    uint64_t i;
+    int record = first;
+    for (i = start; i < end; i += chains[i + 2] + 3, record++) {
+        // the paths of the records are distinct, and a record ends where a
+        // chain is split, so the node at the bottom of its parent is kept
+        ends[record] = target_add_items(target, ends[chains[i]], chains + i + 3,
+                                        chains[i + 2], chains[i + 1], true);
+    }
+}
+
+/**
+ * @brief Merge a range of compacted records into the destination tree, as a
+ * task of a parallel merge
+ *
+ * @param dest The destination tree, which is not resized by the task
+ * @param chains The records
+ * @param start Position of the first record of the range
+ * @param end Position after the last record of the range
+ * @param first Index of the first record of the range
+ * @param ends The node at the bottom of every record, filled for the range
+ * @param extra Private vector where the new nodes are appended
+ * @param base Number of nodes of the destination tree
+ */
+static void tree_merge_chain_range(Tree *dest, const int *chains,
+                                   uint64_t start, uint64_t end, int first,
+                                   int *ends, Tree *extra, int base) {
+    MergeTarget target = {dest, extra, base};
+    target_merge_chains(&target, chains, start, end, first, ends);
+}
+
+/**
+ * @brief Merge the compacted records of a tree, see @see tree_get_chains(),
+ * into a tree, without building the tree of the records first. The part of
+ * a record that is not in the tree yet becomes a single chain node.
+ *
+ * The subtrees of the children of the root are contiguous ranges of records
+ * that touch disjoint subtrees of dest, so they are merged by independent
+ * OpenMP tasks as in @see tree_merge_parallel().
  *
  * @param dest The destination tree
- * @param source The source tree
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param num_threads The number of threads requested to perform the merge
  */
-void tree_merge(Tree *dest, Tree source) { tree_merge_dfs(dest, source, 0, 0); }
+void tree_merge_chains(Tree *dest, const int *chains, uint64_t size,
+                       int num_threads) {
+    // the ranges of the children of the root, with the index of their first
+    // record
+    cvector_vector_type(uint64_t) starts = NULL;
+    cvector_vector_type(int) firsts = NULL;
+    uint64_t i;
+    int num_records = 0;
+    for (i = 0; i < size; i += chains[i + 2] + 3) {
+        num_records++;
+        if (chains[i] == 0) {
+            cvector_push_back(starts, i);
+            cvector_push_back(firsts, num_records);
+        }
+    }
+    cvector_push_back(starts, size);
+    int *ends = (int *)malloc((num_records + 1) * sizeof(int));
+    assert(ends != NULL);
+    ends[0] = 0;
+    int n_ranges = cvector_size(firsts), r;
+
+    if (num_threads <= 1 && !omp_in_parallel()) {
+        MergeTarget target = {dest, dest, 0};
+        target_merge_chains(&target, chains, 0, size, 1, ends);
+    } else {
+        int base = cvector_size((*dest));
+        Tree *extras = (Tree *)calloc(n_ranges, sizeof(Tree));
+        assert(n_ranges == 0 || extras != NULL);
+        if (omp_in_parallel()) {
+            for (r = 0; r < n_ranges; r++) {
+#pragma omp task default(none) firstprivate(r)                                 \
+    shared(dest, chains, starts, firsts, ends, extras, base)
+                tree_merge_chain_range(dest, chains, starts[r], starts[r + 1],
+                                       firsts[r], ends, &(extras[r]), base);
+            }
+#pragma omp taskwait
+        } else {
+#pragma omp parallel default(none) private(r)                                  \
+    shared(dest, chains, starts, firsts, ends, extras, base, n_ranges)         \
+        num_threads(num_threads)
+#pragma omp single
+            for (r = 0; r < n_ranges; r++) {
+#pragma omp task default(none) firstprivate(r)                                 \
+    shared(dest, chains, starts, firsts, ends, extras, base)
+                tree_merge_chain_range(dest, chains, starts[r],
+                                       starts[r + 1], firsts[r], ends,
+                                       &(extras[r]), base);
+            }
+        }
+        for (r = 0; r < n_ranges; r++) {
+            tree_splice(dest, extras[r], base);
+            cvector_free(extras[r]);
+        }
+        free(extras);
+    }
+    free(ends);
+    cvector_free(firsts);
+    cvector_free(starts);
+}
 
 /**
- * @brief Inserts into the vector nodes the nodes to send
+ * @brief Inserts into the vector nodes the nodes to send, a node per item:
+ * the chains of a compact tree are expanded, in depth-first order so that
+ * every node comes after its parent
  *
  * @param tree The trees from which to get the nodes
  * @param nodes The vector in which the nodes are put
  */
 void tree_get_nodes(Tree tree, cvector_vector_type(TreeNodeToSend) * nodes) {
-    int num_nodes = cvector_size(tree);
-    for (int i = 0; i < num_nodes; i++) {
-        TreeNodeToSend node;
-        node.key = tree[i]->key;
-        node.value = tree[i]->value;
-        node.parent = tree[i]->parent;
-        cvector_push_back((*nodes), node);
+    size_t num_nodes = cvector_size(tree);
+    bool ordered = true;
+    for (size_t i = 1; i < num_nodes && ordered; i++) {
+        ordered = tree[i]->chain == NULL && tree[i]->parent < (int)i;
+    }
+    if (ordered) {
+        for (size_t i = 0; i < num_nodes; i++) {
+            TreeNodeToSend node;
+            node.key = tree[i]->key;
+            node.value = tree[i]->value;
+            node.parent = tree[i]->parent;
+            cvector_push_back((*nodes), node);
+        }
+        return;
+    }
+    // pairs of a node and the position of its parent among the nodes sent
+    size_t base = cvector_size((*nodes));
+    TreeNodeToSend root = {TREE_NODE_NULL, -1, 0};
+    cvector_push_back((*nodes), root);
+    cvector_vector_type(int) stack = NULL;
+    int pos = 0;
+    hashmap_element *el;
+    while ((el = hashmap_next(tree[0]->adj, &pos)) != NULL) {
+        cvector_push_back(stack, el->value);
+        cvector_push_back(stack, 0);
+    }
+    while (!cvector_empty(stack)) {
+        size_t top = cvector_size(stack);
+        int curr = stack[top - 2], parent = stack[top - 1], j;
+        cvector_set_size(stack, top - 2);
+        for (j = 0; j < node_length(tree[curr]); j++) {
+            TreeNodeToSend node = {node_item(tree[curr], j),
+                                   tree[curr]->value, parent};
+            cvector_push_back((*nodes), node);
+            parent = cvector_size((*nodes)) - 1 - base;
+        }
+        pos = 0;
+        while ((el = hashmap_next(tree[curr]->adj, &pos)) != NULL) {
+            cvector_push_back(stack, el->value);
+            cvector_push_back(stack, parent);
+        }
+    }
+    cvector_free(stack);
+}
+
+/**
+ * @brief Convert a tree back into the distinct transactions it has been
+ * built from: every node whose value is larger than the sum of the values
+ * of its children is the end of (value - sum) transactions, made of the ids
+ * along the path from the root.
+ *
+ * @param tree The tree
+ * @param paths The list where the weighted transactions are appended, each
+ * with the ids in increasing order
+ */
+void tree_get_paths(Tree tree, WeightedItemsetList *paths) {
+    size_t num_nodes = cvector_size(tree), i;
+    int *ends = (int *)malloc(num_nodes * sizeof(int));
+    assert(ends != NULL);
+    for (i = 0; i < num_nodes; i++) {
+        ends[i] = tree[i]->value;
+    }
+    for (i = 1; i < num_nodes; i++) {
+        ends[tree[i]->parent] -= tree[i]->value;
+    }
+    for (i = 1; i < num_nodes; i++) {
+        if (ends[i] <= 0) {
+            continue;
+        }
+        WeightedItemset path;
+        path.items = NULL;
+        path.weight = ends[i];
+        int curr, j;
+        for (curr = i; curr != 0; curr = tree[curr]->parent) {
+            for (j = node_length(tree[curr]) - 1; j >= 0; j--) {
+                cvector_push_back(path.items, node_item(tree[curr], j));
+            }
+        }
+        // collected from the leaf, the ids decrease
+        int n = cvector_size(path.items);
+        for (j = 0; j < n / 2; j++) {
+            int tmp = path.items[j];
+            path.items[j] = path.items[n - 1 - j];
+            path.items[n - 1 - j] = tmp;
+        }
+        cvector_push_back((*paths), path);
     }
+    free(ends);
 }
 
 /**
@@ -186,11 +932,73 @@ void tree_print(Tree tree) {
     int n_nodes = cvector_size(tree);
 
     for (int i = 0; i < n_nodes; i++) {
-        printf("Node (%d: %d)\n", tree[i]->key, tree[i]->value);
+        printf("Node (%d: %d)", tree[i]->key, tree[i]->value);
+        for (int j = 1; j < node_length(tree[i]); j++) {
+            printf(" %d", node_item(tree[i], j));
+        }
+        printf("\n");
         hashmap_print(tree[i]->adj);
     }
 }
 
+/**
+ * @brief Compare two item ids, used to sort the ids of a transaction
+ *
+ * @param a Pointer to the first id
+ * @param b Pointer to the second id
+ * @return Negative, zero or positive if a is smaller, equal or greater than b
+ */
+static int key_compare(const void *a, const void *b) {
+    int ka = *(const int *)a, kb = *(const int *)b;
+    return (ka > kb) - (ka < kb);
+}
+
+/**
+ * @brief Compute the sorted ids of the frequent items of a transaction.
+ *
+ * Items not in the index map (i.e. with support lower than the minimum) are
+ * discarded. Ids are assigned by decreasing support, so sorting them in
+ * increasing order puts the most frequent items first.
+ *
+ * @param transaction The transaction
+ * @param index_map The map from item to the corresponding id
+ * @param keys The vector where the sorted ids are appended
+ */
+void transaction_get_keys(Transaction transaction, IndexMap index_map,
+                          cvector_vector_type(int) * keys) {
+    size_t n_items = cvector_size(transaction);
+    size_t i;
+    for (i = 0; i < n_items; i++) {
+        int key;
+        // consider only items with support >= min_support (in index map)
+        if (hashmap_get(index_map, transaction[i],
+                        cvector_size(transaction[i]), &key) == MAP_OK) {
+            cvector_push_back((*keys), key);
+        }
+    }
+    if (*keys != NULL) {
+        qsort(*keys, cvector_size((*keys)), sizeof(int), key_compare);
+    }
+}
+
+/**
+ * @brief Insert the path of a transaction in the tree, adding weight to the
+ * value of every node along it. A chain that the path leaves, or ends in,
+ * is split there, see @see TreeNode.
+ *
+ * @param tree Pointer to the tree
+ * @param keys The sorted ids of the items of the transaction
+ * @param n_keys Number of ids
+ * @param weight Number of occurrences of the transaction
+ * @param compact Whether the items that are not in the tree yet become a
+ * single chain node, instead of a node per item
+ */
+void tree_add_transaction(Tree *tree, int *keys, int n_keys, int weight,
+                          bool compact) {
+    MergeTarget target = {tree, tree, 0};
+    target_add_items(&target, 0, keys, n_keys, weight, compact);
+}
+
 /**
  * @brief Build a tree given a transaction
  *
@@ -209,56 +1017,172 @@ Tree tree_build_from_transaction(int rank, int world_size,
                                  hashmap_element *items_count, int num_items,
                                  int *sorted_indices) {
 
-    int n_items = cvector_size((*transaction));
-    cvector_vector_type(hashmap_element) elements = NULL;
+    cvector_vector_type(int) keys = NULL;
+    transaction_get_keys(*transaction, index_map, &keys);
+    transaction_free(transaction);
 
-    for (int i = 0; i < n_items; i++) {
-        int item_size = cvector_size((*transaction)[i]);
-        hashmap_element element;
-        // consider only items with support >= min_support (in index map)
-        if (hashmap_get(index_map, (*transaction)[i], item_size,
-                        &(element.value)) == MAP_OK) {
-            element.key_length = item_size;
-            memcpy(element.key, (*transaction)[i], item_size);
-            cvector_push_back(elements, element);
+    Tree tree = tree_new();
+    tree_add_transaction(&tree, keys, cvector_size(keys), 1, false);
+    cvector_free(keys);
+    return tree;
+}
+
+/**
+ * @brief Function inserting the i-th element of a list into a tree
+ */
+typedef void (*TreeInserter)(void *data, int i, Tree *tree);
+
+/**
+ * @brief Build the tree of the elements from start to end (excluded) as a
+ * tree of OpenMP tasks.
+ *
+ * Ranges of at most grain elements are inserted sequentially into a single
+ * tree. Larger ranges are split in two halves built by two tasks, and the
+ * smaller of the two trees is merged into the larger one as soon as both
+ * are done. The merges of the first levels, which have fewer concurrent
+ * merges than threads, are themselves split in tasks.
+ *
+ * @param start First element of the range
+ * @param end End of the range (excluded)
+ * @param insert Function inserting an element into a tree
+ * @param data Data passed to the insert function
+ * @param grain Maximum number of elements inserted by a single task
+ * @param parallel_depth Number of levels whose merges are parallel
+ * @return The built tree
+ */
+static Tree tree_build_range(int start, int end, TreeInserter insert,
+                             void *data, int grain, int parallel_depth) {
+    Tree tree;
+    if (end - start <= grain) {
+        trace_begin("insert transactions");
+        tree = tree_new();
+        int i;
+        for (i = start; i < end; i++) {
+            insert(data, i, &tree);
         }
+        trace_end();
+        return tree;
     }
-    transaction_free(transaction);
+    int mid = start + (end - start) / 2;
+    Tree left, right;
+#pragma omp task default(none) shared(left)                                    \
+    firstprivate(start, mid, insert, data, grain, parallel_depth)
+    left = tree_build_range(start, mid, insert, data, grain,
+                            parallel_depth - 1);
+#pragma omp task default(none) shared(right)                                   \
+    firstprivate(mid, end, insert, data, grain, parallel_depth)
+    right = tree_build_range(mid, end, insert, data, grain,
+                             parallel_depth - 1);
+#pragma omp taskwait
+
+    // the cost of a merge is proportional to the size of the source
+    if (cvector_size(left) < cvector_size(right)) {
+        tree = left;
+        left = right;
+        right = tree;
+    }
+    trace_begin("merge trees");
+    if (parallel_depth > 0) {
+        tree_merge_parallel(&left, right, 0);
+    } else {
+        tree_merge(&left, right);
+    }
+    tree_free(&right);
+    trace_end();
+    return left;
+}
+
+/**
+ * @brief Build the tree of the n elements of a list with a task-based
+ * reduction, see @see tree_build_range()
+ *
+ * @param n Number of elements
+ * @param insert Function inserting an element into a tree
+ * @param data Data passed to the insert function
+ * @param num_threads The number of threads requested to perform the building
+ * @param grain Maximum number of elements inserted by a single task, or 0
+ * to use TREE_BUILD_TASKS_PER_THREAD tasks per thread
+ * @return The built tree
+ */
+static Tree tree_build_reduce(int n, TreeInserter insert, void *data,
+                              int num_threads, int grain) {
+    if (grain <= 0) {
+        grain = n / (num_threads * TREE_BUILD_TASKS_PER_THREAD);
+    }
+    grain = max(grain, 1);
+    // merges at depth < log2(num_threads) run concurrently with fewer
+    // other merges than threads
+    int parallel_depth = 0;
+    while ((1 << parallel_depth) < num_threads) {
+        parallel_depth++;
+    }
+    Tree res;
 
-    n_items = cvector_size(elements);
+#pragma omp parallel default(none)                                             \
+    shared(n, insert, data, grain, parallel_depth, res)                        \
+        num_threads(num_threads)
+#pragma omp single
+    res = tree_build_range(0, n, insert, data, grain, parallel_depth);
 
-    int *transaction_sorted_indices = (int *)malloc(n_items * sizeof(int));
-    sort(elements, n_items, transaction_sorted_indices, 0, n_items - 1, 1);
+    return res;
+}
 
-    Tree tree = tree_new();
-    for (int i = 0; i < n_items; i++) {
-        assert(transaction_sorted_indices[i] >= 0);
-        assert(transaction_sorted_indices[i] < n_items);
-        Item item = elements[transaction_sorted_indices[i]].key;
-        int item_size = elements[transaction_sorted_indices[i]].key_length;
-
-        int pos;
-        assert(hashmap_get(index_map, item, item_size, &pos) == MAP_OK);
-        assert(pos >= 0);
-        assert(pos < num_items);
-        assert(sorted_indices[pos] >= 0);
-        assert(sorted_indices[pos] < num_items);
-
-        TreeNode *node = tree_node_new(sorted_indices[pos], 1, i);
-        assert(node != NULL);
-        assert(tree_add_node(&tree, node) == i + 1);
-    }
-    cvector_free(elements);
-
-    free(transaction_sorted_indices);
-    return tree;
+/**
+ * @brief Arguments of the tree building of a list of transactions
+ */
+typedef struct TransactionsBuildData {
+    TransactionsList transactions;
+    IndexMap index_map;
+    bool compact;
+} TransactionsBuildData;
+
+/**
+ * @brief Arguments of the tree building of a list of weighted transactions
+ */
+typedef struct WeightedBuildData {
+    WeightedItemsetList transactions;
+    bool compact;
+} WeightedBuildData;
+
+/**
+ * @brief Insert the i-th transaction of a TransactionsBuildData into a tree,
+ * then free the transaction
+ *
+ * @param data Pointer to the TransactionsBuildData
+ * @param i Position of the transaction
+ * @param tree Pointer to the tree
+ */
+static void insert_transaction(void *data, int i, Tree *tree) {
+    TransactionsBuildData *d = (TransactionsBuildData *)data;
+    cvector_vector_type(int) keys = NULL;
+    transaction_get_keys(d->transactions[i], d->index_map, &keys);
+    transaction_free(&(d->transactions[i]));
+    tree_add_transaction(tree, keys, cvector_size(keys), 1, d->compact);
+    cvector_free(keys);
+}
+
+/**
+ * @brief Insert the i-th transaction of a WeightedBuildData into a tree
+ *
+ * @param data Pointer to the WeightedBuildData
+ * @param i Position of the transaction
+ * @param tree Pointer to the tree
+ */
+static void insert_weighted_transaction(void *data, int i, Tree *tree) {
+    WeightedBuildData *d = (WeightedBuildData *)data;
+    WeightedItemset *transaction = &(d->transactions[i]);
+    tree_add_transaction(tree, transaction->items,
+                         cvector_size(transaction->items), transaction->weight,
+                         d->compact);
 }
 
 /**
  * @brief Build a tree given a list of transactions
  *
- * First, we build the trees for the single transactions.
- * Then, we merge them in a binary-tree-like fashion.
+ * The transactions are split in ranges of at most grain transactions, each
+ * inserted into its own tree by an OpenMP task. The trees are then merged
+ * pairwise in a binary-tree-like fashion, every merge starting as soon as
+ * the two trees it needs are built.
  *
  * @param rank The rank of the process
  * @param world_size The number of processes in the world
@@ -269,39 +1193,38 @@ Tree tree_build_from_transaction(int rank, int world_size,
  * @param num_items The number of items in the sorted_indices array
  * @param sorted_indices The array of the sorted indices of the items
  * @param num_threads The number of threads requested to perform the building
+ * @param grain Maximum number of transactions inserted by a single task, or 0
+ * to choose it from the number of threads
+ * @param compact Whether to build a compact tree, see @see TreeNode
  * @return The built tree
  */
 Tree tree_build_from_transactions(int rank, int world_size,
                                   TransactionsList transactions,
                                   IndexMap index_map,
                                   hashmap_element *items_count, int num_items,
-                                  int *sorted_indices, int num_threads) {
-
-    int n_transactions = cvector_size(transactions);
-    Tree *trees = (Tree *)malloc(n_transactions * sizeof(Tree));
-    int i, pow;
+                                  int *sorted_indices, int num_threads,
+                                  int grain, bool compact) {
+    TransactionsBuildData data = {transactions, index_map, compact};
+    return tree_build_reduce(cvector_size(transactions), insert_transaction,
+                             &data, num_threads, grain);
+}
 
-#pragma omp parallel default(none)                                             \
-    shared(n_transactions, trees, rank, world_size, transactions, index_map,   \
-           items_count, num_items, sorted_indices) private(pow, i)             \
-        num_threads(num_threads)
-    for (pow = 1; pow < 2 * n_transactions; pow *= 2) {
-        int start = pow == 1 ? 0 : pow / 2;
-#pragma omp for schedule(runtime)
-        for (i = start; i < n_transactions; i += pow) {
-            if (pow > 1) {
-                // at levels > 1, merge two subtrees
-                tree_merge(&trees[i - pow / 2], trees[i]);
-                tree_free(&(trees[i]));
-            } else {
-                // at first level, build the transaction trees
-                trees[i] = tree_build_from_transaction(
-                    rank, world_size, &(transactions[i]), index_map,
-                    items_count, num_items, sorted_indices);
-            }
-        }
-    }
-    Tree res = trees[0];
-    free(trees);
-    return res;
+/**
+ * @brief Build a tree given a list of deduplicated transactions, inserting
+ * each of them with its weight. See @see tree_build_from_transactions()
+ *
+ * @param transactions The list of weighted transactions, as sorted item ids
+ * @param num_threads The number of threads requested to perform the building
+ * @param grain Maximum number of transactions inserted by a single task, or 0
+ * to choose it from the number of threads
+ * @param compact Whether to build a compact tree, see @see TreeNode
+ * @return The built tree
+ */
+Tree tree_build_from_weighted_transactions(WeightedItemsetList transactions,
+                                           int num_threads, int grain,
+                                           bool compact) {
+    WeightedBuildData data = {transactions, compact};
+    return tree_build_reduce(cvector_size(transactions),
+                             insert_weighted_transaction, &data, num_threads,
+                             grain);
 }
@@ -6,6 +6,11 @@
 #ifndef TREE_H
 #define TREE_H
 #define TREE_NODE_NULL -1
+/**
+ * @brief Number of tasks per thread used to build a tree, when the grain
+ * is not given
+ */
+#define TREE_BUILD_TASKS_PER_THREAD 4
 #include "types.h"
 
 /**
@@ -31,6 +36,13 @@ typedef struct TreeNode {
      *        the keys are the ids of the corresponding items 
      */
     map_t adj;
+    /**
+     * @brief In a compact tree, the items that follow key in a chain of
+     *        single children with the same value, which are stored in this
+     *        node only; the children of the node are the ones of its last
+     *        item. NULL if the node has only key
+     */
+    cvector_vector_type(int) chain;
 } TreeNode;
 
 /**
@@ -89,6 +101,15 @@ Tree tree_new();
  */
 void tree_free(Tree *tree);
 
+/**
+ * @brief Number of bytes allocated by a tree, including the adjacency map
+ * of every node
+ *
+ * @param tree The tree
+ * @return The number of bytes
+ */
+size_t tree_memory(Tree tree);
+
 /**
  * @brief Add a node to the tree
  *
@@ -104,6 +125,9 @@ int tree_add_node(Tree *tree, TreeNode *node);
  * source tree is modified, as the nodes are moved to the
  * destination tree.
  *
+ * The nodes are relinked with an explicit stack: they keep their adjacency
+ * maps, whose values are remapped in place to the new ids.
+ *
  * @param dest Pointer to the destination tree
  * @param source Pointer to the source tree
  * @param nd Id of the node in the destination tree
@@ -116,6 +140,9 @@ void tree_add_subtree(Tree *dest, Tree source, int nd, int ns);
  * with the subtree of source rooted in ns and store the result in dest.
  * Also the source tree is modified.
  *
+ * The visit uses an explicit stack, so its depth is not bounded by the
+ * call stack, and moves the nodes without copying the adjacency maps.
+ *
  * @param dest The destination tree
  * @param source The source tree
  * @param nd Id of the node in the destination tree
@@ -133,13 +160,93 @@ void tree_merge_dfs(Tree *dest, Tree source, int nd, int ns);
 void tree_merge(Tree *dest, Tree source);
 
 /**
- * @brief Inserts into the vector nodes the nodes to send
+ * @brief Merge the trees dest and source in parallel and store the result
+ * in dest. The source tree is modified.
+ *
+ * The subtrees rooted in the children of the root of source, i.e. the paths
+ * starting with different items, are disjoint, so they are merged by
+ * independent OpenMP tasks. The nodes moved by each task are appended to a
+ * private vector, then spliced into dest once all the tasks are done. If
+ * called inside a parallel region the tasks are run by the current team,
+ * otherwise a team of num_threads threads is started.
+ *
+ * @param dest The destination tree
+ * @param source The source tree
+ * @param num_threads The number of threads requested to perform the merge
+ */
+void tree_merge_parallel(Tree *dest, Tree source, int num_threads);
+
+/**
+ * @brief Serialize a tree with its chains compacted, in the style of a
+ * Patricia trie: every node is a record, and a node whose only child has
+ * the same value absorbs it, so a chain of such nodes is a single record
+ * made of the position of the record of its parent (0 for the root, the
+ * records start from 1), the value, the number of items and their ids from
+ * the top of the chain.
+ *
+ * The records are in depth-first order, so every record comes after the one
+ * of its parent and the subtree of every child of the root is a contiguous
+ * range of records. They are merged into compact trees, see
+ * @see tree_merge_chains(), and mined as they are, see
+ * @see mine_frequent_itemsets_chains().
+ *
+ * @param tree The tree
+ * @param chains The vector where the records are appended
+ * @return The number of records
+ */
+uint64_t tree_get_chains(Tree tree, cvector_vector_type(int) * chains);
+
+/**
+ * @brief Expand the compacted records of a tree, see @see tree_get_chains(),
+ * into a node per item
+ *
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param nodes The vector where the nodes are appended, the first one being
+ * the root
+ */
+void tree_chains_to_nodes(const int *chains, uint64_t size,
+                          cvector_vector_type(TreeNodeToSend) * nodes);
+
+/**
+ * @brief Merge the compacted records of a tree, see @see tree_get_chains(),
+ * into a tree, without building the tree of the records first. The part of
+ * a record that is not in the tree yet becomes a single chain node.
+ *
+ * The subtrees of the children of the root are contiguous ranges of records
+ * that touch disjoint subtrees of dest, so they are merged by independent
+ * OpenMP tasks as in @see tree_merge_parallel().
+ *
+ * @param dest The destination tree
+ * @param chains The records
+ * @param size Number of ints of the records
+ * @param num_threads The number of threads requested to perform the merge
+ */
+void tree_merge_chains(Tree *dest, const int *chains, uint64_t size,
+                       int num_threads);
+
+/**
+ * @brief Inserts into the vector nodes the nodes to send, a node per item:
+ * the chains of a compact tree are expanded, in depth-first order so that
+ * every node comes after its parent
  *
  * @param tree The trees from which to get the nodes
  * @param nodes The vector in which the nodes are put
  */
 void tree_get_nodes(Tree tree, cvector_vector_type(TreeNodeToSend) * nodes);
 
+/**
+ * @brief Convert a tree back into the distinct transactions it has been
+ * built from: every node whose value is larger than the sum of the values
+ * of its children is the end of (value - sum) transactions, made of the ids
+ * along the path from the root.
+ *
+ * @param tree The tree
+ * @param paths The list where the weighted transactions are appended, each
+ * with the ids in increasing order
+ */
+void tree_get_paths(Tree tree, WeightedItemsetList *paths);
+
 /**
  * @brief Print the tree
  *
@@ -147,6 +254,35 @@ void tree_get_nodes(Tree tree, cvector_vector_type(TreeNodeToSend) * nodes);
  */
 void tree_print(Tree tree);
 
+/**
+ * @brief Compute the sorted ids of the frequent items of a transaction.
+ *
+ * Items not in the index map (i.e. with support lower than the minimum) are
+ * discarded. Ids are assigned by decreasing support, so sorting them in
+ * increasing order puts the most frequent items first.
+ *
+ * @param transaction The transaction
+ * @param index_map The map from item to the corresponding id
+ * @param keys The vector where the sorted ids are appended
+ */
+void transaction_get_keys(Transaction transaction, IndexMap index_map,
+                          cvector_vector_type(int) * keys);
+
+/**
+ * @brief Insert the path of a transaction in the tree, adding weight to the
+ * value of every node along it. A chain that the path leaves, or ends in,
+ * is split there, see @see TreeNode.
+ *
+ * @param tree Pointer to the tree
+ * @param keys The sorted ids of the items of the transaction
+ * @param n_keys Number of ids
+ * @param weight Number of occurrences of the transaction
+ * @param compact Whether the items that are not in the tree yet become a
+ * single chain node, instead of a node per item
+ */
+void tree_add_transaction(Tree *tree, int *keys, int n_keys, int weight,
+                          bool compact);
+
 /**
  * @brief Build a tree given a transaction
  *
@@ -168,8 +304,10 @@ Tree tree_build_from_transaction(int rank, int world_size,
 /**
  * @brief Build a tree given a list of transactions
  *
- * First, we build the trees for the single transactions.
- * Then, we merge them in a binary-tree-like fashion.
+ * The transactions are split in ranges of at most grain transactions, each
+ * inserted into its own tree by an OpenMP task. The trees are then merged
+ * pairwise in a binary-tree-like fashion, every merge starting as soon as
+ * the two trees it needs are built.
  *
  * @param rank The rank of the process
  * @param world_size The number of processes in the world
@@ -180,12 +318,31 @@ Tree tree_build_from_transaction(int rank, int world_size,
  * @param num_items The number of items in the sorted_indices array
  * @param sorted_indices The array of the sorted indices of the items
  * @param num_threads The number of threads requested to perform the building
+ * @param grain Maximum number of transactions inserted by a single task, or 0
+ * to choose it from the number of threads
+ * @param compact Whether to build a compact tree, see @see TreeNode
  * @return The built tree
  */
 Tree tree_build_from_transactions(int rank, int world_size,
                                   TransactionsList transactions,
                                   IndexMap index_map,
                                   hashmap_element *items_count, int num_items,
-                                  int *sorted_indices, int num_threads);
+                                  int *sorted_indices, int num_threads,
+                                  int grain, bool compact);
+
+/**
+ * @brief Build a tree given a list of deduplicated transactions, inserting
+ * each of them with its weight. See @see tree_build_from_transactions()
+ *
+ * @param transactions The list of weighted transactions, as sorted item ids
+ * @param num_threads The number of threads requested to perform the building
+ * @param grain Maximum number of transactions inserted by a single task, or 0
+ * to choose it from the number of threads
+ * @param compact Whether to build a compact tree, see @see TreeNode
+ * @return The built tree
+ */
+Tree tree_build_from_weighted_transactions(WeightedItemsetList transactions,
+                                           int num_threads, int grain,
+                                           bool compact);
 
 #endif
\ No newline at end of file
@@ -32,4 +32,23 @@ typedef cvector_vector_type(Item) Transaction;
  */
 typedef cvector_vector_type(Transaction) TransactionsList;
 
+/**
+ * @brief Set of item ids together with a weight, e.g. a transaction and the
+ * number of times it occurs
+ */
+typedef struct WeightedItemset {
+    /**
+     * @brief Ids of the items, sorted
+     */
+    cvector_vector_type(int) items;
+    /**
+     * @brief Weight of the itemset
+     */
+    int weight;
+} WeightedItemset;
+/**
+ * @brief List of weighted itemsets
+ */
+typedef cvector_vector_type(WeightedItemset) WeightedItemsetList;
+
 #endif
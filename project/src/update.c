@@ -0,0 +1,476 @@
+#include "update.h"
+#include "dedup.h"
+#include "io.h"
+#include "itemset_map.h"
+#include "memory.h"
+#include "reduce.h"
+#include "sort.h"
+#include "trace.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Compare two items by decreasing support, see @see item_compare()
+ */
+static int item_compare_decreasing(const void *a, const void *b) {
+    return item_compare((hashmap_element *)b, (hashmap_element *)a);
+}
+
+/**
+ * @brief Compare two integers, used to sort the item ids
+ */
+static int update_key_compare(const void *a, const void *b) {
+    int ka = *(const int *)a, kb = *(const int *)b;
+    return (ka > kb) - (ka < kb);
+}
+
+/**
+ * @brief Sort a range of supports in decreasing order with a merge sort,
+ * counting the pairs of elements out of order
+ *
+ * @param values The supports
+ * @param tmp Buffer with the same size
+ * @param start First index of the range
+ * @param end Last index of the range (excluded)
+ * @return The number of pairs i < j with values[i] < values[j]
+ */
+static uint64_t count_inversions(int *values, int *tmp, int start, int end) {
+    if (end - start < 2) {
+        return 0;
+    }
+    int mid = (start + end) / 2;
+    uint64_t count = count_inversions(values, tmp, start, mid) +
+                     count_inversions(values, tmp, mid, end);
+    int i = start, j = mid, k = start;
+    while (i < mid && j < end) {
+        if (values[i] >= values[j]) {
+            tmp[k++] = values[i++];
+        } else {
+            // values[j] is larger than all the remaining ones on the left
+            count += mid - i;
+            tmp[k++] = values[j++];
+        }
+    }
+    while (i < mid) {
+        tmp[k++] = values[i++];
+    }
+    while (j < end) {
+        tmp[k++] = values[j++];
+    }
+    memcpy(values + start, tmp + start, (end - start) * sizeof(int));
+    return count;
+}
+
+/**
+ * @brief Fraction of the pairs of items whose ids are not in decreasing
+ * order of support, i.e. the normalized number of inversions
+ *
+ * @param items The items, the i-th one has id i
+ * @param num_items Number of items
+ * @return The fraction, 0 if the ids are sorted by decreasing support
+ */
+double items_order_drift(hashmap_element *items, int num_items) {
+    if (num_items < 2) {
+        return 0;
+    }
+    int *values = (int *)malloc(num_items * sizeof(int));
+    int *tmp = (int *)malloc(num_items * sizeof(int));
+    assert(values != NULL && tmp != NULL);
+    int i;
+    for (i = 0; i < num_items; i++) {
+        values[i] = items[i].value;
+    }
+    uint64_t inversions = count_inversions(values, tmp, 0, num_items);
+    free(values);
+    free(tmp);
+    return (double)inversions / ((double)num_items * (num_items - 1) / 2);
+}
+
+/**
+ * @brief Sort the items of a tree by decreasing support
+ *
+ * @param items The items, the i-th one has id i, reordered
+ * @param num_items Number of items
+ * @return The new id of every old id, to be freed
+ */
+static int *items_sort(hashmap_element *items, int num_items) {
+    hashmap_element *order =
+        (hashmap_element *)malloc(num_items * sizeof(hashmap_element));
+    int *new_ids = (int *)malloc(num_items * sizeof(int));
+    assert(num_items == 0 || (order != NULL && new_ids != NULL));
+    memcpy(order, items, num_items * sizeof(hashmap_element));
+    // sort the items, then find where every item went by its key
+    qsort(order, num_items, sizeof(hashmap_element), item_compare_decreasing);
+    IndexMap index_map = hashmap_new();
+    int i;
+    for (i = 0; i < num_items; i++) {
+        hashmap_put(index_map, items[i].key, items[i].key_length, i);
+    }
+    for (i = 0; i < num_items; i++) {
+        int old_id;
+        hashmap_get(index_map, order[i].key, order[i].key_length, &old_id);
+        new_ids[old_id] = i;
+    }
+    hashmap_free(index_map);
+    memcpy(items, order, num_items * sizeof(hashmap_element));
+    free(order);
+    return new_ids;
+}
+
+/**
+ * @brief Map the ids of some paths to new ids and sort them again
+ *
+ * @param paths The paths
+ * @param new_ids The new id of every old id
+ */
+static void paths_renumber(WeightedItemsetList paths, const int *new_ids) {
+    size_t n_paths = cvector_size(paths), p;
+    for (p = 0; p < n_paths; p++) {
+        int n_keys = cvector_size(paths[p].items), j;
+        for (j = 0; j < n_keys; j++) {
+            paths[p].items[j] = new_ids[paths[p].items[j]];
+        }
+        qsort(paths[p].items, n_keys, sizeof(int), update_key_compare);
+    }
+}
+
+/**
+ * @brief Assign the ids of the items of a tree by decreasing support again,
+ * and rebuild the tree with the new ids from its paths
+ *
+ * @param tree Pointer to the tree, NULL on the processes without a tree, in
+ * which case only the items are reordered
+ * @param items The items of the tree, the i-th one has id i, reordered
+ * @param num_threads The number of threads used to rebuild the tree
+ * @param grain Maximum number of paths inserted by a single task, or 0
+ * to choose it from the number of threads
+ * @param compact Whether to rebuild a compact tree, see @see TreeNode
+ */
+void tree_restructure(Tree *tree, hashmap_element *items, int num_threads,
+                      int grain, bool compact) {
+    int *new_ids = items_sort(items, cvector_size(items));
+    if (tree != NULL && *tree != NULL) {
+        WeightedItemsetList paths = NULL;
+        tree_get_paths(*tree, &paths);
+        tree_free(tree);
+        paths_renumber(paths, new_ids);
+        *tree = tree_build_from_weighted_transactions(paths, num_threads, grain,
+                                                      compact);
+        weighted_itemsets_free(&paths);
+    }
+    free(new_ids);
+}
+
+/**
+ * @brief Assign the ids of the items of a tree by decreasing support again,
+ * and move only the subtrees whose order is broken, as in the branch sorting
+ * of a CP-tree.
+ *
+ * With the new ids, a node whose id is lower than the one of its parent
+ * starts an out-of-order subtree: the items of some adjacent pairs have
+ * swapped, and the paths through it are no longer sorted. Such a subtree is
+ * cut off, the values of its ancestors are decreased by its value, and its
+ * paths are sorted with the new ids and inserted again from the root. The
+ * nodes left keep their position and get their new ids; those whose value
+ * drops to 0 are removed. A compact tree is expanded first into a node per
+ * item, since the new ids can break its chains anywhere.
+ *
+ * @param tree Pointer to the tree, NULL on the processes without a tree, in
+ * which case only the items are reordered
+ * @param items The items of the tree, the i-th one has id i, reordered
+ * @return The number of paths moved
+ */
+uint64_t tree_reorder(Tree *tree, hashmap_element *items) {
+    int *new_ids = items_sort(items, cvector_size(items));
+    if (tree == NULL || *tree == NULL) {
+        free(new_ids);
+        return 0;
+    }
+    size_t num_nodes = cvector_size((*tree)), i;
+    bool ordered = true;
+    for (i = 1; i < num_nodes && ordered; i++) {
+        ordered = (*tree)[i]->chain == NULL && (*tree)[i]->parent < (int)i;
+    }
+    if (!ordered) {
+        cvector_vector_type(TreeNodeToSend) nodes = NULL;
+        tree_get_nodes(*tree, &nodes);
+        tree_free(tree);
+        parse_tree(nodes, cvector_size(nodes), tree);
+        cvector_free(nodes);
+    }
+    Tree old = *tree;
+    num_nodes = cvector_size(old);
+    bool *moved = (bool *)calloc(num_nodes, sizeof(bool));
+    // the value of the moved subtrees below a node that is kept, and the
+    // number of paths that end in a moved node
+    int *lost = (int *)calloc(num_nodes, sizeof(int));
+    int *ends = (int *)calloc(num_nodes, sizeof(int));
+    assert(moved != NULL && lost != NULL && ends != NULL);
+    // a node comes after its parent
+    for (i = 1; i < num_nodes; i++) {
+        int parent = old[i]->parent;
+        moved[i] = moved[parent] ||
+                   (parent != 0 &&
+                    new_ids[old[i]->key] < new_ids[old[parent]->key]);
+        if (moved[i])
+            ends[i] = old[i]->value;
+    }
+    for (i = num_nodes - 1; i > 0; i--) {
+        int parent = old[i]->parent;
+        if (moved[parent])
+            ends[parent] -= old[i]->value;
+        else
+            lost[parent] += moved[i] ? old[i]->value : lost[i];
+    }
+
+    // the paths through the moved nodes, see tree_get_paths()
+    WeightedItemsetList paths = NULL;
+    for (i = 1; i < num_nodes; i++) {
+        if (!moved[i] || ends[i] <= 0)
+            continue;
+        WeightedItemset path;
+        path.items = NULL;
+        path.weight = ends[i];
+        int curr;
+        for (curr = i; curr != 0; curr = old[curr]->parent) {
+            cvector_push_back(path.items, old[curr]->key);
+        }
+        cvector_push_back(paths, path);
+    }
+    paths_renumber(paths, new_ids);
+    free(ends);
+
+    // the nodes left, with the new ids, then the moved paths
+    int *ids = (int *)malloc(num_nodes * sizeof(int));
+    assert(ids != NULL);
+    Tree reordered = tree_new();
+    ids[0] = 0;
+    for (i = 1; i < num_nodes; i++) {
+        int value = old[i]->value - lost[i];
+        // the value of a child is at most the one of its parent
+        if (!moved[i] && value > 0) {
+            ids[i] = tree_add_node(
+                &reordered, tree_node_new(new_ids[old[i]->key], value,
+                                          ids[old[i]->parent]));
+        }
+        tree_node_free(old[i]);
+        old[i] = NULL;
+    }
+    tree_free(&old);
+    free(ids);
+    free(lost);
+    free(moved);
+    size_t n_paths = cvector_size(paths), p;
+    for (p = 0; p < n_paths; p++) {
+        tree_add_transaction(&reordered, paths[p].items,
+                             cvector_size(paths[p].items), paths[p].weight,
+                             false);
+    }
+    weighted_itemsets_free(&paths);
+    free(new_ids);
+    *tree = reordered;
+    return n_paths;
+}
+
+/**
+ * @brief Update the tree of a snapshot with the transactions of a new file.
+ *
+ * The new file is read in parallel, and the supports of its items are
+ * reduced and added to the ones of the snapshot. The minimum support of the
+ * tree, as a fraction, is kept: the items of the snapshot stay in the tree,
+ * and the items whose support reaches it get the next ids. The occurrences
+ * of these in the transactions of the snapshot are lost, as they are not in
+ * the tree, so a warning is printed; they are less than the minimum support
+ * count of the snapshot for every item. The new transactions are
+ * inserted into a tree with the ids of the snapshot, reduced to process 0
+ * and merged into the tree of the snapshot. The items are then sorted by
+ * their current support: if the fraction of pairs of items out of order,
+ * see @see items_order_drift(), is at most max_drift, only the subtrees
+ * whose order is broken are moved, see @see tree_reorder(), otherwise the
+ * whole tree is rebuilt, see @see tree_restructure().
+ *
+ * @param snapshot The snapshot, which can be closed afterwards
+ * @param filename Name of the file with the new transactions
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ * @param grain Maximum number of transactions inserted by a single task, or
+ * 0 to choose it from the number of threads
+ * @param max_drift Maximum fraction of pairs of items out of order
+ * @param compact Whether the new transactions are inserted into compact
+ * trees, see @see TreeNode and @see get_global_tree()
+ * @param updated Where to store the updated tree
+ */
+void tree_update(Snapshot *snapshot, char *filename, int rank, int world_size,
+                 int num_threads, int grain, double max_drift, bool compact,
+                 UpdatedTree *updated) {
+    const SnapshotHeader *header = snapshot->header;
+    updated->min_support = header->min_support;
+    updated->items = NULL;
+    updated->supports = NULL;
+    updated->tree = NULL;
+
+    /*--- READ THE NEW TRANSACTIONS ---*/
+    trace_begin("read transactions");
+    TransactionsList transactions = NULL;
+    SupportMap support_map = hashmap_new();
+    transactions_read(&transactions, filename, rank, world_size, &support_map);
+    memory_log("transactions", transactions_memory(transactions));
+    uint64_t num_transactions = cvector_size(transactions);
+    uint64_t num_new_transactions = 0;
+    MPI_Allreduce(&num_transactions, &num_new_transactions, 1, MPI_UINT64_T,
+                  MPI_SUM, MPI_COMM_WORLD);
+    updated->num_transactions = header->num_transactions + num_new_transactions;
+    updated->min_count = updated->min_support * updated->num_transactions;
+    trace_end();
+
+    /*--- UPDATE THE SUPPORTS ---*/
+    trace_begin("received global map");
+    // all the items of the new transactions, to update the saved supports
+    hashmap_element *new_supports = NULL;
+    int num_new_supports;
+    get_global_map(rank, world_size, &support_map, &new_supports,
+                   &num_new_supports, 0, 0, NULL);
+    hashmap_free(support_map);
+    SupportMap totals = hashmap_new();
+    uint64_t i;
+    for (i = 0; i < header->num_supports; i++) {
+        hashmap_put(totals, snapshot->supports[i].key,
+                    snapshot->supports[i].key_length,
+                    snapshot->supports[i].value);
+    }
+    for (i = 0; i < (uint64_t)num_new_supports; i++) {
+        hashmap_increment(totals, new_supports[i].key,
+                          new_supports[i].key_length, new_supports[i].value);
+    }
+    if (rank != 0)
+        free(new_supports);
+    else
+        cvector_free(new_supports);
+    hashmap_get_elements(totals, &(updated->supports));
+    memory_log("support_map", hashmap_memory(totals));
+
+    // the items of the snapshot keep their ids
+    IndexMap index_map = hashmap_new();
+    for (i = 0; i < header->num_items; i++) {
+        hashmap_element item;
+        memset(&item, 0, sizeof(item));
+        memcpy(item.key, snapshot->items[i].key, snapshot->items[i].key_length);
+        item.key_length = snapshot->items[i].key_length;
+        item.in_use = true;
+        hashmap_get(totals, item.key, item.key_length, &(item.value));
+        cvector_push_back(updated->items, item);
+        hashmap_put(index_map, item.key, item.key_length, i);
+    }
+    // the items that became frequent get the next ids, by decreasing support
+    cvector_vector_type(hashmap_element) frequent = NULL;
+    cvector_vector_type(hashmap_element) added = NULL;
+    hashmap_get_elements_with_support(totals, &frequent, updated->min_count);
+    size_t n_frequent = cvector_size(frequent);
+    int id;
+    for (i = 0; i < n_frequent; i++) {
+        if (hashmap_get(index_map, frequent[i].key, frequent[i].key_length,
+                        &id) != MAP_OK) {
+            cvector_push_back(added, frequent[i]);
+        }
+    }
+    cvector_free(frequent);
+    hashmap_free(totals);
+    size_t n_added = cvector_size(added);
+    if (n_added > 0) {
+        qsort(added, n_added, sizeof(hashmap_element),
+              item_compare_decreasing);
+    }
+    uint64_t lost = 0;
+    for (i = 0; i < n_added; i++) {
+        hashmap_put(index_map, added[i].key, added[i].key_length,
+                    cvector_size(updated->items));
+        cvector_push_back(updated->items, added[i]);
+    }
+    // occurrences of the added items in the transactions of the snapshot
+    for (i = 0; i < header->num_supports && n_added > 0; i++) {
+        const SnapshotItem *item = &(snapshot->supports[i]);
+        int new_id;
+        if (hashmap_get(index_map, (void *)item->key, item->key_length,
+                        &new_id) == MAP_OK &&
+            new_id >= (int)header->num_items) {
+            lost += item->value;
+        }
+    }
+    cvector_free(added);
+    if (rank == 0 && n_added > 0)
+        fprintf(stderr,
+                "%zu items became frequent, their %" PRIu64
+                " occurrences in the "
+                "saved transactions are not in the tree\n",
+                n_added, lost);
+    trace_end();
+
+    /*--- INSERT THE NEW TRANSACTIONS ---*/
+    trace_begin("built local tree");
+    WeightedItemsetList weighted = NULL;
+    transactions_dedup(&transactions, index_map, &weighted, num_threads);
+    hashmap_free(index_map);
+    transactions_free(&transactions);
+    Tree tree = tree_build_from_weighted_transactions(weighted, num_threads,
+                                                      grain, compact);
+    weighted_itemsets_free(&weighted);
+    memory_log("local_tree", tree_memory(tree));
+    trace_end();
+
+    trace_begin("received global tree");
+    get_global_tree(rank, world_size, &tree, num_threads, compact);
+    trace_end();
+
+    trace_begin("updated tree");
+    if (rank == 0) {
+        Tree saved;
+        parse_tree((TreeNodeToSend *)snapshot->nodes, header->num_nodes,
+                   &saved);
+        tree_merge_parallel(&saved, tree, num_threads);
+        tree_free(&tree);
+        updated->tree = saved;
+    } else if (tree != NULL) {
+        tree_free(&tree);
+    }
+    double drift =
+        items_order_drift(updated->items, cvector_size(updated->items));
+    bool restructure = drift > max_drift;
+    uint64_t moved = 0;
+    if (restructure) {
+        tree_restructure(rank == 0 ? &(updated->tree) : NULL, updated->items,
+                         num_threads, grain, compact);
+    } else if (drift > 0) {
+        moved = tree_reorder(rank == 0 ? &(updated->tree) : NULL,
+                             updated->items);
+    }
+    if (rank == 0) {
+        if (restructure)
+            fprintf(stderr, "order_drift: %lf, restructured\n", drift);
+        else if (drift > 0)
+            fprintf(stderr, "order_drift: %lf, reordered %" PRIu64 " paths\n",
+                    drift, moved);
+        else
+            fprintf(stderr, "order_drift: %lf\n", drift);
+        memory_log("global_tree", tree_memory(updated->tree));
+    }
+    trace_end();
+}
+
+/**
+ * @brief Free an updated tree
+ *
+ * @param updated The updated tree
+ */
+void updated_tree_free(UpdatedTree *updated) {
+    if (updated->tree != NULL)
+        tree_free(&(updated->tree));
+    cvector_free(updated->items);
+    cvector_free(updated->supports);
+    updated->items = NULL;
+    updated->supports = NULL;
+}
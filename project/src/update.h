@@ -0,0 +1,137 @@
+/**
+ * @file update.h
+ * @brief Incremental update of a saved global tree with new transactions
+ *
+ */
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include "snapshot.h"
+#include "tree.h"
+#include "types.h"
+
+/**
+ * @brief Default maximum fraction of pairs of items of the tree whose ids
+ * are not in decreasing order of support, above which the tree is rebuilt
+ * instead of reordered in place
+ */
+#define UPDATE_MAX_DRIFT 0.1
+
+/**
+ * @brief A saved tree updated with new transactions
+ */
+typedef struct UpdatedTree {
+    /**
+     * @brief The updated global tree, on process 0 only
+     */
+    Tree tree;
+    /**
+     * @brief The items of the tree with their support, the i-th one has id i
+     */
+    cvector_vector_type(hashmap_element) items;
+    /**
+     * @brief The support of every item read, frequent or not
+     */
+    cvector_vector_type(hashmap_element) supports;
+    /**
+     * @brief Number of transactions the tree has been built from
+     */
+    uint64_t num_transactions;
+    /**
+     * @brief Minimum support count of the items of the tree
+     */
+    int min_count;
+    /**
+     * @brief Minimum support of the items of the tree, as a fraction of the
+     * number of transactions
+     */
+    double min_support;
+} UpdatedTree;
+
+/**
+ * @brief Fraction of the pairs of items whose ids are not in decreasing
+ * order of support, i.e. the normalized number of inversions
+ *
+ * @param items The items, the i-th one has id i
+ * @param num_items Number of items
+ * @return The fraction, 0 if the ids are sorted by decreasing support
+ */
+double items_order_drift(hashmap_element *items, int num_items);
+
+/**
+ * @brief Assign the ids of the items of a tree by decreasing support again,
+ * and rebuild the tree with the new ids from its paths
+ *
+ * @param tree Pointer to the tree, NULL on the processes without a tree, in
+ * which case only the items are reordered
+ * @param items The items of the tree, the i-th one has id i, reordered
+ * @param num_threads The number of threads used to rebuild the tree
+ * @param grain Maximum number of paths inserted by a single task, or 0
+ * to choose it from the number of threads
+ * @param compact Whether to rebuild a compact tree, see @see TreeNode
+ */
+void tree_restructure(Tree *tree, hashmap_element *items, int num_threads,
+                      int grain, bool compact);
+
+/**
+ * @brief Assign the ids of the items of a tree by decreasing support again,
+ * and move only the subtrees whose order is broken, as in the branch sorting
+ * of a CP-tree.
+ *
+ * With the new ids, a node whose id is lower than the one of its parent
+ * starts an out-of-order subtree: the items of some adjacent pairs have
+ * swapped, and the paths through it are no longer sorted. Such a subtree is
+ * cut off, the values of its ancestors are decreased by its value, and its
+ * paths are sorted with the new ids and inserted again from the root. The
+ * nodes left keep their position and get their new ids; those whose value
+ * drops to 0 are removed. A compact tree is expanded first into a node per
+ * item, since the new ids can break its chains anywhere.
+ *
+ * @param tree Pointer to the tree, NULL on the processes without a tree, in
+ * which case only the items are reordered
+ * @param items The items of the tree, the i-th one has id i, reordered
+ * @return The number of paths moved
+ */
+uint64_t tree_reorder(Tree *tree, hashmap_element *items);
+
+/**
+ * @brief Update the tree of a snapshot with the transactions of a new file.
+ *
+ * The new file is read in parallel, and the supports of its items are
+ * reduced and added to the ones of the snapshot. The minimum support of the
+ * tree, as a fraction, is kept: the items of the snapshot stay in the tree,
+ * and the items whose support reaches it get the next ids. The occurrences
+ * of these in the transactions of the snapshot are lost, as they are not in
+ * the tree, so a warning is printed; they are less than the minimum support
+ * count of the snapshot for every item. The new transactions are
+ * inserted into a tree with the ids of the snapshot, reduced to process 0
+ * and merged into the tree of the snapshot. The items are then sorted by
+ * their current support: if the fraction of pairs of items out of order,
+ * see @see items_order_drift(), is at most max_drift, only the subtrees
+ * whose order is broken are moved, see @see tree_reorder(), otherwise the
+ * whole tree is rebuilt, see @see tree_restructure().
+ *
+ * @param snapshot The snapshot, which can be closed afterwards
+ * @param filename Name of the file with the new transactions
+ * @param rank Rank of the current process
+ * @param world_size Number of processes
+ * @param num_threads Number of threads of every process
+ * @param grain Maximum number of transactions inserted by a single task, or
+ * 0 to choose it from the number of threads
+ * @param max_drift Maximum fraction of pairs of items out of order
+ * @param compact Whether the new transactions are inserted into compact
+ * trees, see @see TreeNode and @see get_global_tree()
+ * @param updated Where to store the updated tree
+ */
+void tree_update(Snapshot *snapshot, char *filename, int rank, int world_size,
+                 int num_threads, int grain, double max_drift, bool compact,
+                 UpdatedTree *updated);
+
+/**
+ * @brief Free an updated tree
+ *
+ * @param updated The updated tree
+ */
+void updated_tree_free(UpdatedTree *updated);
+
+#endif
@@ -1,4 +1,5 @@
 #include "types.h"
+#include "utils.h"
 #include <string.h>
 
 /**
@@ -19,6 +20,24 @@ int min(int a, int b) { return a < b ? a : b; }
  */
 int max(int a, int b) { return a < b ? b : a; }
 
+/**
+ * @brief Minimum between two 64-bit integers
+ *
+ * @param a first parameter
+ * @param b second parameter
+ * @return minimum between a and b
+ */
+int64_t min64(int64_t a, int64_t b) { return a < b ? a : b; }
+
+/**
+ * @brief Maximum between two 64-bit integers
+ *
+ * @param a first parameter
+ * @param b second parameter
+ * @return maximum between a and b
+ */
+int64_t max64(int64_t a, int64_t b) { return a < b ? b : a; }
+
 /**
  * @brief Length of an Item
  *
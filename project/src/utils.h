@@ -6,6 +6,8 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
+
 /**
  * @brief Minimum between two integers
  *
@@ -24,6 +26,24 @@ int min(int a, int b);
  */
 int max(int a, int b);
 
+/**
+ * @brief Minimum between two 64-bit integers
+ *
+ * @param a first parameter
+ * @param b second parameter
+ * @return minimum between a and b
+ */
+int64_t min64(int64_t a, int64_t b);
+
+/**
+ * @brief Maximum between two 64-bit integers
+ *
+ * @param a first parameter
+ * @param b second parameter
+ * @return maximum between a and b
+ */
+int64_t max64(int64_t a, int64_t b);
+
 /**
  * @brief Length of an Item
  *